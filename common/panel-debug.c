@@ -23,13 +23,81 @@
 #ifdef HAVE_STRING_H
 #include <string.h>
 #endif
+#ifdef HAVE_SIGNAL_H
+#include <signal.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
 #include <glib.h>
+#include <glib-object.h>
+#ifdef G_OS_UNIX
+#include <glib-unix.h>
+#endif
 #include <common/panel-debug.h>
 #include <common/panel-private.h>
 
 
 
+/* number of events in the flight recorder, power of two */
+#define RECORDER_SIZE        (256)
+#define RECORDER_MAX_ARGS    (16)
+#define RECORDER_STRINGS_LEN (256)
+#define RECORDER_SPEC_LEN    (16)
+#define RECORDER_TYPE_NAME   "PanelDebugRecorder"
+
+
+
+typedef enum
+{
+  RECORDER_LENGTH_NONE,
+  RECORDER_LENGTH_CHAR,
+  RECORDER_LENGTH_SHORT,
+  RECORDER_LENGTH_LONG,
+  RECORDER_LENGTH_LONG_LONG,
+  RECORDER_LENGTH_SIZE
+}
+RecorderLength;
+
+typedef union
+{
+  gint64         v_int;
+  gdouble        v_double;
+  gconstpointer  v_pointer;
+  guint          v_string; /* offset in strings */
+}
+RecorderArg;
+
+typedef struct
+{
+  /* index + 1 once the entry is complete, 0 while it is written */
+  gint            sequence;
+
+  gint64          time;
+  PanelDebugFlag  domain;
+
+  /* arguments are stored in binary form and only formatted when the
+   * recorder is dumped, the format is NULL if the message could not
+   * be captured and was formatted into strings right away. the format
+   * is interned, the one passed in may live in a plugin module that
+   * is unloaded before the recorder is dumped */
+  const gchar    *format;
+  guint           n_args;
+  RecorderArg     args[RECORDER_MAX_ARGS];
+  gchar           strings[RECORDER_STRINGS_LEN];
+}
+RecorderEntry;
+
+typedef struct
+{
+  gint          head;
+  RecorderEntry entries[RECORDER_SIZE];
+}
+PanelDebugRecorder;
+
+
+
 static PanelDebugFlag panel_debug_flags = 0;
 
 
@@ -57,6 +125,9 @@ static const GDebugKey panel_debug_keys[] =
   { "pager", PANEL_DEBUG_PAGER },
   { "itembar", PANEL_DEBUG_ITEMBAR },
   { "clock", PANEL_DEBUG_CLOCK },
+  { "launch", PANEL_DEBUG_LAUNCH },
+  { "watchdog", PANEL_DEBUG_WATCHDOG },
+  { "windowmenu", PANEL_DEBUG_WINDOWMENU },
 };
 
 
@@ -91,25 +162,398 @@ panel_debug_init (void)
 
 
 
-static void
-panel_debug_print (PanelDebugFlag  domain,
-                   const gchar    *message,
-                   va_list         args)
+static const gchar *
+panel_debug_domain_name (PanelDebugFlag domain)
 {
-  gchar       *string;
-  const gchar *domain_name = NULL;
-  guint        i;
+  guint i;
 
   /* lookup domain name */
   for (i = 0; i < G_N_ELEMENTS (panel_debug_keys); i++)
+    if (panel_debug_keys[i].value == domain)
+      return panel_debug_keys[i].key;
+
+  return NULL;
+}
+
+
+
+static PanelDebugRecorder *
+panel_debug_recorder_get (void)
+{
+  static gsize               inited__volatile = 0;
+  static PanelDebugRecorder *recorder = NULL;
+  static GQuark              quark = 0;
+  GType                      type;
+
+  if (g_once_init_enter (&inited__volatile))
+    {
+      /* every module linking this library has its own copy of this
+       * file, so the ring is attached to a named type to have one
+       * recorder per process */
+      quark = g_quark_from_static_string ("panel-debug-recorder");
+      type = g_type_from_name (RECORDER_TYPE_NAME);
+      if (type == G_TYPE_INVALID)
+        type = g_pointer_type_register_static (RECORDER_TYPE_NAME);
+
+      recorder = g_type_get_qdata (type, quark);
+      if (recorder == NULL)
+        {
+          recorder = g_new0 (PanelDebugRecorder, 1);
+          g_type_set_qdata (type, quark, recorder);
+        }
+
+      g_once_init_leave (&inited__volatile, 1);
+    }
+
+  return recorder;
+}
+
+
+
+static const gchar *
+panel_debug_recorder_parse (const gchar    *p,
+                            gchar          *spec,
+                            RecorderLength *length,
+                            gchar          *conversion)
+{
+  guint n = 0;
+
+  panel_assert (*p == '%');
+
+  /* flags, width and precision are kept in the spec, a '*' would
+   * need an extra argument and is not supported */
+  spec[n++] = *p++;
+  while (*p != '\0' && strchr ("-+ #0'.0123456789", *p) != NULL)
+    {
+      if (n >= RECORDER_SPEC_LEN - 1)
+        return NULL;
+      spec[n++] = *p++;
+    }
+  spec[n] = '\0';
+
+  *length = RECORDER_LENGTH_NONE;
+  if (p[0] == 'h' && p[1] == 'h')
+    *length = RECORDER_LENGTH_CHAR, p += 2;
+  else if (p[0] == 'h')
+    *length = RECORDER_LENGTH_SHORT, p += 1;
+  else if (p[0] == 'l' && p[1] == 'l')
+    *length = RECORDER_LENGTH_LONG_LONG, p += 2;
+  else if (p[0] == 'l')
+    *length = RECORDER_LENGTH_LONG, p += 1;
+  else if (p[0] == 'z')
+    *length = RECORDER_LENGTH_SIZE, p += 1;
+
+  if (*p == '\0' || strchr ("diouxXcsp" "eEfFgGaA", *p) == NULL)
+    return NULL;
+
+  /* only plain strings and doubles */
+  if (*length != RECORDER_LENGTH_NONE && strchr ("csp" "eEfFgGaA", *p) != NULL)
+    return NULL;
+
+  *conversion = *p;
+
+  return p + 1;
+}
+
+
+
+static gboolean
+panel_debug_recorder_capture (RecorderEntry *entry,
+                              const gchar   *format,
+                              va_list        args)
+{
+  const gchar    *p;
+  gchar           spec[RECORDER_SPEC_LEN];
+  gchar           conversion;
+  RecorderLength  length;
+  RecorderArg    *arg;
+  const gchar    *str;
+  guint           offset = 0;
+  gboolean        is_signed;
+
+  entry->n_args = 0;
+
+  for (p = format; *p != '\0';)
+    {
+      if (*p != '%')
+        {
+          p++;
+          continue;
+        }
+
+      if (p[1] == '%')
+        {
+          p += 2;
+          continue;
+        }
+
+      p = panel_debug_recorder_parse (p, spec, &length, &conversion);
+      if (p == NULL || entry->n_args >= RECORDER_MAX_ARGS)
+        return FALSE;
+
+      arg = &entry->args[entry->n_args++];
+      is_signed = conversion == 'd' || conversion == 'i';
+
+      switch (conversion)
+        {
+        case 's':
+          str = va_arg (args, const gchar *);
+          if (str == NULL)
+            str = "(null)";
+
+          /* copy the string, the last byte is always a nul */
+          arg->v_string = MIN (offset, RECORDER_STRINGS_LEN - 1);
+          if (offset < RECORDER_STRINGS_LEN - 1)
+            offset += g_strlcpy (entry->strings + offset, str,
+                                 RECORDER_STRINGS_LEN - 1 - offset) + 1;
+          break;
+
+        case 'p':
+          arg->v_pointer = va_arg (args, gconstpointer);
+          break;
+
+        case 'c':
+          arg->v_int = va_arg (args, gint);
+          break;
+
+        case 'e': case 'E': case 'f': case 'F':
+        case 'g': case 'G': case 'a': case 'A':
+          arg->v_double = va_arg (args, gdouble);
+          break;
+
+        default:
+          switch (length)
+            {
+            case RECORDER_LENGTH_LONG:
+              arg->v_int = is_signed ? (gint64) va_arg (args, glong)
+                                     : (gint64) va_arg (args, gulong);
+              break;
+
+            case RECORDER_LENGTH_LONG_LONG:
+              arg->v_int = is_signed ? (gint64) va_arg (args, long long)
+                                     : (gint64) va_arg (args, unsigned long long);
+              break;
+
+            case RECORDER_LENGTH_SIZE:
+              arg->v_int = is_signed ? (gint64) va_arg (args, gssize)
+                                     : (gint64) va_arg (args, gsize);
+              break;
+
+            default:
+              /* char and short are promoted to int */
+              arg->v_int = is_signed ? (gint64) va_arg (args, gint)
+                                     : (gint64) va_arg (args, guint);
+              break;
+            }
+          break;
+        }
+    }
+
+  entry->strings[RECORDER_STRINGS_LEN - 1] = '\0';
+
+  return TRUE;
+}
+
+
+
+static void
+panel_debug_recorder_record (PanelDebugFlag  domain,
+                             const gchar    *message,
+                             va_list         args)
+{
+  PanelDebugRecorder *recorder = panel_debug_recorder_get ();
+  RecorderEntry      *entry;
+  guint               index;
+  va_list             args_copy;
+
+  /* claim a slot, writers never wait on each other */
+  index = (guint) g_atomic_int_add (&recorder->head, 1);
+  entry = &recorder->entries[index % RECORDER_SIZE];
+
+  g_atomic_int_set (&entry->sequence, 0);
+
+  entry->time = g_get_monotonic_time ();
+  entry->domain = domain;
+  entry->format = g_intern_string (message);
+
+  G_VA_COPY (args_copy, args);
+  if (!panel_debug_recorder_capture (entry, message, args_copy))
     {
-      if (panel_debug_keys[i].value == domain)
+      entry->format = NULL;
+      g_vsnprintf (entry->strings, sizeof (entry->strings), message, args);
+    }
+  va_end (args_copy);
+
+  g_atomic_int_set (&entry->sequence, index + 1);
+}
+
+
+
+static void
+panel_debug_recorder_format (GString             *string,
+                             const RecorderEntry *entry)
+{
+  const gchar       *p;
+  const gchar       *start;
+  gchar              spec[RECORDER_SPEC_LEN + 8];
+  gchar              conversion;
+  RecorderLength     length;
+  const RecorderArg *arg;
+  guint              n = 0;
+  gsize              len;
+
+  if (entry->format == NULL)
+    {
+      g_string_append (string, entry->strings);
+      return;
+    }
+
+  for (p = entry->format; *p != '\0';)
+    {
+      if (*p != '%')
+        {
+          start = p;
+          while (*p != '\0' && *p != '%')
+            p++;
+          g_string_append_len (string, start, p - start);
+          continue;
+        }
+
+      if (p[1] == '%')
         {
-          domain_name = panel_debug_keys[i].key;
+          g_string_append_c (string, '%');
+          p += 2;
+          continue;
+        }
+
+      /* same parse as during capture, so this cannot fail */
+      p = panel_debug_recorder_parse (p, spec, &length, &conversion);
+      panel_assert (p != NULL && n < entry->n_args);
+      arg = &entry->args[n++];
+
+      /* all integers were widened to 64 bits */
+      if (strchr ("diouxX", conversion) != NULL)
+        g_strlcat (spec, G_GINT64_MODIFIER, sizeof (spec));
+      len = strlen (spec);
+      spec[len] = conversion;
+      spec[len + 1] = '\0';
+
+      switch (conversion)
+        {
+        case 's':
+          g_string_append_printf (string, spec, entry->strings + arg->v_string);
+          break;
+
+        case 'p':
+          g_string_append_printf (string, spec, arg->v_pointer);
+          break;
+
+        case 'c':
+          g_string_append_printf (string, spec, (gint) arg->v_int);
+          break;
+
+        case 'd':
+        case 'i':
+          g_string_append_printf (string, spec, arg->v_int);
+          break;
+
+        case 'o': case 'u': case 'x': case 'X':
+          g_string_append_printf (string, spec, (guint64) arg->v_int);
+          break;
+
+        default:
+          g_string_append_printf (string, spec, arg->v_double);
           break;
         }
     }
+}
+
+
 
+gchar *
+panel_debug_recorder_dump (void)
+{
+  PanelDebugRecorder *recorder = panel_debug_recorder_get ();
+  RecorderEntry       entry;
+  GString            *string;
+  guint               head;
+  guint               index;
+  guint               n_entries;
+  gint64              now;
+  const gchar        *domain_name;
+
+  string = g_string_sized_new (RECORDER_SIZE * 80);
+  now = g_get_monotonic_time ();
+
+  head = (guint) g_atomic_int_get (&recorder->head);
+  n_entries = MIN (head, RECORDER_SIZE);
+
+  for (index = head - n_entries; index != head; index++)
+    {
+      /* copy the entry and skip it if a writer touched it meanwhile */
+      if ((guint) g_atomic_int_get (&recorder->entries[index % RECORDER_SIZE].sequence) != index + 1)
+        continue;
+      entry = recorder->entries[index % RECORDER_SIZE];
+      if ((guint) g_atomic_int_get (&recorder->entries[index % RECORDER_SIZE].sequence) != index + 1)
+        continue;
+
+      domain_name = panel_debug_domain_name (entry.domain);
+      g_string_append_printf (string, "[%10.6f] %s: ",
+                              (entry.time - now) / (gdouble) G_USEC_PER_SEC,
+                              domain_name != NULL ? domain_name : "?");
+      panel_debug_recorder_format (string, &entry);
+      g_string_append_c (string, '\n');
+    }
+
+  return g_string_free (string, FALSE);
+}
+
+
+
+void
+panel_debug_recorder_print (const gchar *reason)
+{
+  gchar *dump;
+
+  dump = panel_debug_recorder_dump ();
+  g_printerr (PACKAGE_NAME "(%s): flight recorder of pid %d:\n%s",
+              reason, (gint) getpid (), dump);
+  g_free (dump);
+}
+
+
+
+#ifdef G_OS_UNIX
+static gboolean
+panel_debug_recorder_signal (gpointer user_data)
+{
+  panel_debug_recorder_print ("SIGUSR2");
+
+  return G_SOURCE_CONTINUE;
+}
+#endif
+
+
+
+void
+panel_debug_recorder_watch_signal (void)
+{
+#ifdef G_OS_UNIX
+  g_unix_signal_add (SIGUSR2, panel_debug_recorder_signal, NULL);
+#endif
+}
+
+
+
+static void
+panel_debug_print (PanelDebugFlag  domain,
+                   const gchar    *message,
+                   va_list         args)
+{
+  gchar       *string;
+  const gchar *domain_name;
+
+  domain_name = panel_debug_domain_name (domain);
   panel_assert (domain_name != NULL);
 
   string = g_strdup_vprintf (message, args);
@@ -122,7 +566,7 @@ panel_debug_print (PanelDebugFlag  domain,
 gboolean
 panel_debug_has_domain (PanelDebugFlag domain)
 {
-  return PANEL_HAS_FLAG (panel_debug_flags, domain);
+  return PANEL_HAS_FLAG (panel_debug_init (), domain);
 }
 
 
@@ -137,6 +581,11 @@ panel_debug (PanelDebugFlag  domain,
   panel_return_if_fail (domain > 0);
   panel_return_if_fail (message != NULL);
 
+  /* always keep the event in the flight recorder */
+  va_start (args, message);
+  panel_debug_recorder_record (domain, message, args);
+  va_end (args);
+
   /* leave when debug is disabled */
   if (panel_debug_init () == 0)
     return;
@@ -158,6 +607,11 @@ panel_debug_filtered (PanelDebugFlag  domain,
   panel_return_if_fail (domain > 0);
   panel_return_if_fail (message != NULL);
 
+  /* always keep the event in the flight recorder */
+  va_start (args, message);
+  panel_debug_recorder_record (domain, message, args);
+  va_end (args);
+
   /* leave when the filter does not match */
   if (!PANEL_HAS_FLAG (panel_debug_init (), domain))
     return;
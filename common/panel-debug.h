@@ -45,17 +45,26 @@ typedef enum
   PANEL_DEBUG_PAGER            = 1 << 15,
   PANEL_DEBUG_ITEMBAR          = 1 << 16,
   PANEL_DEBUG_CLOCK            = 1 << 17,
+  PANEL_DEBUG_LAUNCH           = 1 << 18,
+  PANEL_DEBUG_WATCHDOG         = 1 << 19,
+  PANEL_DEBUG_WINDOWMENU       = 1 << 20,
 }
 PanelDebugFlag;
 
-gboolean panel_debug_has_domain   (PanelDebugFlag  domain);
+gboolean panel_debug_has_domain            (PanelDebugFlag  domain);
 
-void     panel_debug              (PanelDebugFlag  domain,
-                                   const gchar    *message,
-                                   ...) G_GNUC_PRINTF (2, 3);
+void     panel_debug                       (PanelDebugFlag  domain,
+                                            const gchar    *message,
+                                            ...) G_GNUC_PRINTF (2, 3);
 
-void     panel_debug_filtered     (PanelDebugFlag  domain,
-                                   const gchar    *message,
-                                   ...) G_GNUC_PRINTF (2, 3);
+void     panel_debug_filtered              (PanelDebugFlag  domain,
+                                            const gchar    *message,
+                                            ...) G_GNUC_PRINTF (2, 3);
+
+gchar   *panel_debug_recorder_dump         (void) G_GNUC_MALLOC;
+
+void     panel_debug_recorder_print        (const gchar    *reason);
+
+void     panel_debug_recorder_watch_signal (void);
 
 #endif /* !__PANEL_DEBUG_H__ */
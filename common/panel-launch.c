@@ -0,0 +1,546 @@
+/*
+ * Copyright (C) 2024 The Xfce development team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Launch latency instrumentation. A launch is started when the plugin
+ * begins handling the click and is marked spawned when the command has
+ * been started. If the launch uses startup notification, we follow the
+ * _NET_STARTUP_INFO messages on the root window: the "new:" message sent
+ * by our own process gives us the startup id and the "remove:" message
+ * sent by the application is the moment its first window is mapped.
+ * The result is send to the ring buffer of the panel's D-Bus service.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <gdk/gdkx.h>
+
+#include <common/panel-private.h>
+#include <common/panel-debug.h>
+#include <common/panel-dbus.h>
+#include <common/panel-launch.h>
+
+
+
+/* time to wait for the "new:" message, which is send by ourselves */
+#define PANEL_LAUNCH_MATCH_TIMEOUT   (2)
+
+/* time to wait for the first window, same as libstartup-notification */
+#define PANEL_LAUNCH_MAPPED_TIMEOUT  (30)
+
+/* size of a client message chunk */
+#define PANEL_LAUNCH_CHUNK_SIZE      (20)
+
+
+
+struct _PanelLaunch
+{
+  gchar  *desktop_id;
+  gchar  *startup_id;
+
+  /* real time of the click and monotonic times of the launch steps */
+  gint64  time;
+  gint64  begin;
+  gint64  spawned;
+
+  guint   timeout_id;
+};
+
+
+
+static void     panel_launch_free     (PanelLaunch *launch);
+static void     panel_launch_report   (PanelLaunch *launch,
+                                       gint64       mapped);
+
+
+
+/* launches waiting for their "new:" message, in launch order */
+static GQueue      launches_unmatched = G_QUEUE_INIT;
+
+/* launches waiting for the "remove:" message, by startup id */
+static GHashTable *launches_pending = NULL;
+
+/* partial startup messages, by sender window */
+static GHashTable *startup_messages = NULL;
+
+static Atom        atom_startup_info_begin = None;
+static Atom        atom_startup_info = None;
+
+
+
+static gchar *
+panel_launch_message_get (const gchar *message,
+                          const gchar *key)
+{
+  const gchar *p;
+  const gchar *key_start;
+  gsize        key_len;
+  GString     *value;
+  gboolean     quoted;
+
+  /* skip the message type */
+  p = strchr (message, ':');
+  if (p == NULL)
+    return NULL;
+
+  for (p++; *p != '\0';)
+    {
+      /* skip whitespace */
+      while (*p == ' ')
+        p++;
+
+      /* read the key */
+      key_start = p;
+      while (*p != '\0' && *p != '=' && *p != ' ')
+        p++;
+      if (*p != '=')
+        return NULL;
+      key_len = p - key_start;
+      p++;
+
+      /* read the (quoted) value */
+      value = g_string_new (NULL);
+      quoted = FALSE;
+      for (; *p != '\0'; p++)
+        {
+          if (*p == '\\' && p[1] != '\0')
+            {
+              /* escaped character */
+              p++;
+              g_string_append_c (value, *p);
+            }
+          else if (*p == '"')
+            quoted = !quoted;
+          else if (*p == ' ' && !quoted)
+            break;
+          else
+            g_string_append_c (value, *p);
+        }
+
+      if (strlen (key) == key_len && strncmp (key_start, key, key_len) == 0)
+        return g_string_free (value, FALSE);
+
+      g_string_free (value, TRUE);
+    }
+
+  return NULL;
+}
+
+
+
+static gboolean
+panel_launch_startup_id_is_ours (const gchar *startup_id)
+{
+  gchar token[32];
+
+  /* libstartup-notification uses "launcher/launchee/pid-seq-host_TIMEnnn",
+   * the gdk launch context uses "prgname-pid-host-id-seq_TIMEnnn" */
+  g_snprintf (token, sizeof (token), "/%d-", (gint) getpid ());
+  if (strstr (startup_id, token) != NULL)
+    return TRUE;
+
+  g_snprintf (token, sizeof (token), "-%d-", (gint) getpid ());
+  return strstr (startup_id, token) != NULL;
+}
+
+
+
+static gboolean
+panel_launch_timeout (gpointer user_data)
+{
+  PanelLaunch *launch = user_data;
+
+  launch->timeout_id = 0;
+
+  if (launch->startup_id == NULL)
+    g_queue_remove (&launches_unmatched, launch);
+  else
+    g_hash_table_steal (launches_pending, launch->startup_id);
+
+  /* launches without a desktop id are only recorded if we see a
+   * startup message, without it we don't know what was started */
+  if (launch->desktop_id != NULL)
+    panel_launch_report (launch, -1);
+
+  panel_launch_free (launch);
+
+  return FALSE;
+}
+
+
+
+static void
+panel_launch_wait_for_window (PanelLaunch *launch)
+{
+  panel_return_if_fail (launch->startup_id != NULL);
+
+  if (launches_pending == NULL)
+    launches_pending = g_hash_table_new (g_str_hash, g_str_equal);
+
+  g_hash_table_insert (launches_pending, launch->startup_id, launch);
+
+  if (launch->timeout_id != 0)
+    g_source_remove (launch->timeout_id);
+  launch->timeout_id = g_timeout_add_seconds (PANEL_LAUNCH_MAPPED_TIMEOUT,
+                                              panel_launch_timeout, launch);
+}
+
+
+
+static void
+panel_launch_startup_message (const gchar *message)
+{
+  gchar       *startup_id;
+  gchar       *name;
+  PanelLaunch *launch;
+
+  startup_id = panel_launch_message_get (message, "ID");
+  if (startup_id == NULL)
+    return;
+
+  if (g_str_has_prefix (message, "new:"))
+    {
+      /* the oldest unmatched launch of this process owns the sequence */
+      if (!panel_launch_startup_id_is_ours (startup_id)
+          || (launches_pending != NULL && g_hash_table_contains (launches_pending, startup_id))
+          || (launch = g_queue_pop_head (&launches_unmatched)) == NULL)
+        {
+          g_free (startup_id);
+          return;
+        }
+
+      /* take the name from the message if the caller did not know it */
+      if (launch->desktop_id == NULL)
+        {
+          name = panel_launch_message_get (message, "APPLICATION_ID");
+          if (name != NULL)
+            {
+              launch->desktop_id = g_path_get_basename (name);
+              g_free (name);
+            }
+          else
+            {
+              launch->desktop_id = panel_launch_message_get (message, "BIN");
+            }
+        }
+
+      launch->startup_id = startup_id;
+      panel_launch_wait_for_window (launch);
+    }
+  else if (g_str_has_prefix (message, "remove:"))
+    {
+      if (launches_pending != NULL
+          && (launch = g_hash_table_lookup (launches_pending, startup_id)) != NULL)
+        {
+          g_hash_table_remove (launches_pending, startup_id);
+          panel_launch_report (launch, g_get_monotonic_time ());
+          panel_launch_free (launch);
+        }
+
+      g_free (startup_id);
+    }
+  else
+    {
+      g_free (startup_id);
+    }
+}
+
+
+
+static GdkFilterReturn
+panel_launch_event_filter (GdkXEvent *gdk_xevent,
+                           GdkEvent  *event,
+                           gpointer   user_data)
+{
+  XEvent  *xevent = gdk_xevent;
+  GString *message;
+  gpointer window;
+  gint     i;
+
+  if (xevent->type != ClientMessage
+      || xevent->xclient.format != 8)
+    return GDK_FILTER_CONTINUE;
+
+  /* messages are send in chunks of 20 bytes and can be interleaved
+   * with messages of other senders */
+  window = GUINT_TO_POINTER (xevent->xclient.window);
+  if (xevent->xclient.message_type == atom_startup_info_begin)
+    {
+      message = g_string_new (NULL);
+      g_hash_table_replace (startup_messages, window, message);
+    }
+  else if (xevent->xclient.message_type == atom_startup_info)
+    {
+      message = g_hash_table_lookup (startup_messages, window);
+      if (message == NULL)
+        return GDK_FILTER_CONTINUE;
+    }
+  else
+    {
+      return GDK_FILTER_CONTINUE;
+    }
+
+  for (i = 0; i < PANEL_LAUNCH_CHUNK_SIZE; i++)
+    {
+      if (xevent->xclient.data.b[i] == '\0')
+        {
+          panel_launch_startup_message (message->str);
+          g_hash_table_remove (startup_messages, window);
+          break;
+        }
+
+      g_string_append_c (message, xevent->xclient.data.b[i]);
+    }
+
+  return GDK_FILTER_CONTINUE;
+}
+
+
+
+static void
+panel_launch_string_free (gpointer data)
+{
+  g_string_free (data, TRUE);
+}
+
+
+
+static void
+panel_launch_init (void)
+{
+  GdkDisplay *display;
+  GdkWindow  *root;
+
+  if (G_LIKELY (startup_messages != NULL))
+    return;
+
+  display = gdk_display_get_default ();
+  if (!GDK_IS_X11_DISPLAY (display))
+    return;
+
+  startup_messages = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                            NULL, panel_launch_string_free);
+
+  atom_startup_info_begin = gdk_x11_get_xatom_by_name_for_display (display, "_NET_STARTUP_INFO_BEGIN");
+  atom_startup_info = gdk_x11_get_xatom_by_name_for_display (display, "_NET_STARTUP_INFO");
+
+  /* startup messages are send to the root window with the property
+   * change mask */
+  root = gdk_screen_get_root_window (gdk_display_get_default_screen (display));
+  gdk_window_set_events (root, gdk_window_get_events (root) | GDK_PROPERTY_CHANGE_MASK);
+  gdk_window_add_filter (root, panel_launch_event_filter, NULL);
+}
+
+
+
+static void
+panel_launch_free (PanelLaunch *launch)
+{
+  if (launch->timeout_id != 0)
+    g_source_remove (launch->timeout_id);
+
+  g_free (launch->desktop_id);
+  g_free (launch->startup_id);
+  g_slice_free (PanelLaunch, launch);
+}
+
+
+
+static void
+panel_launch_report (PanelLaunch *launch,
+                     gint64       mapped)
+{
+  GDBusConnection *connection;
+  gint64           spawn_latency;
+  gint64           mapped_latency;
+
+  spawn_latency = launch->spawned - launch->begin;
+  mapped_latency = mapped >= 0 ? mapped - launch->spawned : -1;
+
+  panel_debug (PANEL_DEBUG_LAUNCH,
+               "%s: click to spawn %" G_GINT64_FORMAT " us, spawn to mapped %" G_GINT64_FORMAT " us",
+               launch->desktop_id != NULL ? launch->desktop_id : "(unknown)",
+               spawn_latency, mapped_latency);
+
+  /* the connection is shared with the panel or wrapper, so this
+   * does not block */
+  connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, NULL);
+  if (G_UNLIKELY (connection == NULL))
+    return;
+
+  g_dbus_connection_call (connection,
+                          PANEL_DBUS_NAME,
+                          PANEL_DBUS_PATH,
+                          PANEL_DBUS_INTERFACE,
+                          "RecordLaunch",
+                          g_variant_new ("(sxxx)",
+                                         launch->desktop_id != NULL ? launch->desktop_id : "",
+                                         launch->time, spawn_latency, mapped_latency),
+                          NULL, G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                          -1, NULL, NULL, NULL);
+
+  g_object_unref (G_OBJECT (connection));
+}
+
+
+
+/**
+ * panel_launch_begin:
+ * @desktop_id : the desktop id of the application or %NULL if it is
+ *               not known, it is then taken from the startup message.
+ *
+ * Start measuring a launch, call this as early as possible in the
+ * click handler.
+ *
+ * Returns: the launch, finish it with panel_launch_spawned() or
+ *          panel_launch_cancel().
+ **/
+PanelLaunch *
+panel_launch_begin (const gchar *desktop_id)
+{
+  PanelLaunch *launch;
+
+  panel_launch_init ();
+
+  launch = g_slice_new0 (PanelLaunch);
+  launch->desktop_id = g_strdup (desktop_id);
+  launch->time = g_get_real_time ();
+  launch->begin = g_get_monotonic_time ();
+
+  return launch;
+}
+
+
+
+/**
+ * panel_launch_set_desktop_id:
+ * @launch     : a #PanelLaunch.
+ * @desktop_id : the desktop id of the application.
+ *
+ * Set the desktop id if it was not known when the launch began.
+ **/
+void
+panel_launch_set_desktop_id (PanelLaunch *launch,
+                             const gchar *desktop_id)
+{
+  panel_return_if_fail (launch != NULL);
+
+  g_free (launch->desktop_id);
+  launch->desktop_id = g_strdup (desktop_id);
+}
+
+
+
+static void
+panel_launch_context_launched (GAppLaunchContext *context,
+                               GAppInfo          *info,
+                               GVariant          *platform_data,
+                               PanelLaunch       *launch)
+{
+  if (launch->startup_id == NULL)
+    g_variant_lookup (platform_data, "startup-notification-id", "s", &launch->startup_id);
+}
+
+
+
+/**
+ * panel_launch_set_context:
+ * @launch  : a #PanelLaunch.
+ * @context : the launch context passed to g_app_info_launch().
+ *
+ * Take the startup id of @launch from @context, which makes matching
+ * the startup messages more reliable. The context must not outlive
+ * the launch.
+ **/
+void
+panel_launch_set_context (PanelLaunch       *launch,
+                          GAppLaunchContext *context)
+{
+  panel_return_if_fail (launch != NULL);
+  panel_return_if_fail (G_IS_APP_LAUNCH_CONTEXT (context));
+
+  g_signal_connect (G_OBJECT (context), "launched",
+      G_CALLBACK (panel_launch_context_launched), launch);
+}
+
+
+
+/**
+ * panel_launch_spawned:
+ * @launch         : a #PanelLaunch.
+ * @startup_notify : whether the command was spawned with startup
+ *                   notification.
+ *
+ * Mark @launch as spawned. Without startup notification the launch is
+ * recorded right away, else when the first window of the application
+ * is mapped. This takes ownership of @launch.
+ **/
+void
+panel_launch_spawned (PanelLaunch *launch,
+                      gboolean     startup_notify)
+{
+  panel_return_if_fail (launch != NULL);
+
+  launch->spawned = g_get_monotonic_time ();
+
+  if (launch->startup_id != NULL)
+    {
+      /* the id is known from the launch context */
+      panel_launch_wait_for_window (launch);
+    }
+  else if (startup_notify && startup_messages != NULL)
+    {
+      /* wait for our own "new:" message */
+      g_queue_push_tail (&launches_unmatched, launch);
+      launch->timeout_id = g_timeout_add_seconds (PANEL_LAUNCH_MATCH_TIMEOUT,
+                                                  panel_launch_timeout, launch);
+    }
+  else
+    {
+      if (launch->desktop_id != NULL)
+        panel_launch_report (launch, -1);
+      panel_launch_free (launch);
+    }
+}
+
+
+
+/**
+ * panel_launch_cancel:
+ * @launch : a #PanelLaunch.
+ *
+ * Drop @launch without recording it, for example when spawning failed.
+ **/
+void
+panel_launch_cancel (PanelLaunch *launch)
+{
+  panel_return_if_fail (launch != NULL);
+  panel_return_if_fail (launch->timeout_id == 0);
+
+  panel_launch_free (launch);
+}
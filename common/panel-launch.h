@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2024 The Xfce development team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef __PANEL_LAUNCH_H__
+#define __PANEL_LAUNCH_H__
+
+#include <gtk/gtk.h>
+
+typedef struct _PanelLaunch PanelLaunch;
+
+PanelLaunch *panel_launch_begin          (const gchar       *desktop_id);
+
+void         panel_launch_set_desktop_id (PanelLaunch       *launch,
+                                          const gchar       *desktop_id);
+
+void         panel_launch_set_context    (PanelLaunch       *launch,
+                                          GAppLaunchContext *context);
+
+void         panel_launch_spawned        (PanelLaunch       *launch,
+                                          gboolean           startup_notify);
+
+void         panel_launch_cancel         (PanelLaunch       *launch);
+
+#endif /* !__PANEL_LAUNCH_H__ */
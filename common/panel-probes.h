@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2024 The Xfce development team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef __PANEL_PROBES_H__
+#define __PANEL_PROBES_H__
+
+#include <glib.h>
+
+/* Static tracepoints for perf and bpftrace, compiled in with
+ * --enable-usdt. A probe is a single nop until a tracer attaches,
+ * keep the arguments cheap to compute. Without USDT support the
+ * arguments are not evaluated at all. All probes use the provider
+ * xfce4_panel, see docs/tracing for examples. */
+#ifdef HAVE_USDT
+#include <sys/sdt.h>
+
+#define PANEL_PROBE(name) \
+  DTRACE_PROBE (xfce4_panel, name)
+#define PANEL_PROBE1(name, arg1) \
+  DTRACE_PROBE1 (xfce4_panel, name, arg1)
+#define PANEL_PROBE2(name, arg1, arg2) \
+  DTRACE_PROBE2 (xfce4_panel, name, arg1, arg2)
+#define PANEL_PROBE3(name, arg1, arg2, arg3) \
+  DTRACE_PROBE3 (xfce4_panel, name, arg1, arg2, arg3)
+#define PANEL_PROBE4(name, arg1, arg2, arg3, arg4) \
+  DTRACE_PROBE4 (xfce4_panel, name, arg1, arg2, arg3, arg4)
+
+#else
+
+#define PANEL_PROBE(name)                          G_STMT_START{ }G_STMT_END
+#define PANEL_PROBE1(name, arg1)                   G_STMT_START{ }G_STMT_END
+#define PANEL_PROBE2(name, arg1, arg2)             G_STMT_START{ }G_STMT_END
+#define PANEL_PROBE3(name, arg1, arg2, arg3)       G_STMT_START{ }G_STMT_END
+#define PANEL_PROBE4(name, arg1, arg2, arg3, arg4) G_STMT_START{ }G_STMT_END
+
+#endif
+
+#endif /* !__PANEL_PROBES_H__ */
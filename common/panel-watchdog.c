@@ -0,0 +1,525 @@
+/*
+ * Copyright (C) 2024 The Xfce development team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef HAVE_SIGNAL_H
+#include <signal.h>
+#endif
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#ifdef HAVE_EXECINFO_H
+#include <execinfo.h>
+#endif
+#ifdef HAVE_DLFCN_H
+#include <dlfcn.h>
+#endif
+
+#include <glib.h>
+#include <common/panel-debug.h>
+#include <common/panel-private.h>
+#include <common/panel-watchdog.h>
+
+
+
+/* time between two heartbeats and the time a heartbeat may take
+ * before the main loop is considered stalled, in milliseconds */
+#define WATCHDOG_INTERVAL   (1000)
+#define WATCHDOG_THRESHOLD  (250)
+
+/* number of stack frames in a sample */
+#define WATCHDOG_MAX_FRAMES (64)
+
+/* SIGURG is ignored by default and unused by the panel and gtk, so a
+ * late sample request can never terminate the process */
+#if defined (HAVE_SIGNAL_H) && defined (HAVE_PTHREAD_H) && defined (SIGURG)
+#define WATCHDOG_SAMPLING
+#define WATCHDOG_SIGNAL     SIGURG
+#endif
+
+/* histogram buckets, stalls are counted in the first bucket their
+ * duration (in milliseconds) is smaller than, or in the last one */
+#define WATCHDOG_N_BUCKETS  (G_N_ELEMENTS (watchdog_buckets) + 1)
+
+
+
+static const gint64 watchdog_buckets[] = { 500, 1000, 2000, 5000, 10000 };
+
+
+
+typedef struct
+{
+  gchar  *name;
+
+  guint   n_stalls;
+  gint64  total;
+  gint64  max;
+  guint   buckets[WATCHDOG_N_BUCKETS];
+}
+WatchdogStalls;
+
+typedef struct
+{
+  GThread     *thread;
+
+  /* protects everything below, except the sample */
+  GMutex       lock;
+  GCond        cond;
+  gboolean     quit;
+
+  /* pending heartbeat in the main context */
+  GSource     *heartbeat;
+  gboolean     pong;
+  gint64       pong_time;
+
+  /* module filename -> plugin name */
+  GHashTable  *modules;
+
+  /* name -> WatchdogStalls */
+  GHashTable  *stalls;
+
+  /* called from the watchdog thread for every stall, without the lock */
+  PanelWatchdogStallFunc  stall_func;
+  gpointer                stall_data;
+
+#ifdef WATCHDOG_SAMPLING
+  pthread_t    main_thread;
+
+  /* written by the signal handler in the main thread */
+  gint         sampled;
+  gpointer     frames[WATCHDOG_MAX_FRAMES];
+  gint         n_frames;
+  gchar        source_name[64];
+#endif
+}
+PanelWatchdog;
+
+
+
+static PanelWatchdog *
+panel_watchdog_get (void)
+{
+  static gsize          inited__volatile = 0;
+  static PanelWatchdog *watchdog = NULL;
+
+  if (g_once_init_enter (&inited__volatile))
+    {
+      watchdog = g_new0 (PanelWatchdog, 1);
+      g_mutex_init (&watchdog->lock);
+      g_cond_init (&watchdog->cond);
+      watchdog->modules = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+      watchdog->stalls = g_hash_table_new (g_str_hash, g_str_equal);
+
+      g_once_init_leave (&inited__volatile, 1);
+    }
+
+  return watchdog;
+}
+
+
+
+#ifdef WATCHDOG_SAMPLING
+static void
+panel_watchdog_sample_handler (gint signum)
+{
+  PanelWatchdog *watchdog = panel_watchdog_get ();
+  GSource       *source;
+  const gchar   *name = NULL;
+  gint           saved_errno = errno;
+  guint          i;
+
+#ifdef HAVE_EXECINFO_H
+  watchdog->n_frames = backtrace (watchdog->frames, WATCHDOG_MAX_FRAMES);
+#endif
+
+  /* the source that is dispatched while the main loop is stuck */
+  source = g_main_current_source ();
+  if (source != NULL)
+    name = g_source_get_name (source);
+
+  for (i = 0; name != NULL && name[i] != '\0' && i < sizeof (watchdog->source_name) - 1; i++)
+    watchdog->source_name[i] = name[i];
+  watchdog->source_name[i] = '\0';
+
+  g_atomic_int_set (&watchdog->sampled, 1);
+
+  errno = saved_errno;
+}
+#endif
+
+
+
+/* called without the lock held, the main thread needs it to answer the
+ * heartbeat and a sample can take up to 100 ms */
+static void
+panel_watchdog_sample (PanelWatchdog *watchdog,
+                       gchar         *name,
+                       gsize          name_len,
+                       gchar         *location,
+                       gsize          location_len,
+                       gchar         *source_name,
+                       gsize          source_name_len)
+{
+#ifdef WATCHDOG_SAMPLING
+  guint        i;
+#if defined (HAVE_EXECINFO_H) && defined (HAVE_DLFCN_H)
+  const gchar *module;
+  Dl_info      info;
+  gint         n;
+#endif
+
+  /* interrupt the main thread to take a stack sample */
+  g_atomic_int_set (&watchdog->sampled, 0);
+  if (pthread_kill (watchdog->main_thread, WATCHDOG_SIGNAL) != 0)
+    return;
+
+  for (i = 0; i < 100 && !g_atomic_int_get (&watchdog->sampled); i++)
+    g_usleep (G_USEC_PER_SEC / 1000);
+  if (!g_atomic_int_get (&watchdog->sampled))
+    return;
+
+  g_strlcpy (source_name, watchdog->source_name, source_name_len);
+
+#if defined (HAVE_EXECINFO_H) && defined (HAVE_DLFCN_H)
+  /* the innermost frame in a plugin module is the one to blame, frames
+   * in glib, gtk or the panel itself are only on behalf of the plugin */
+  for (n = 0; n < watchdog->n_frames; n++)
+    {
+      if (dladdr (watchdog->frames[n], &info) == 0
+          || info.dli_fname == NULL)
+        continue;
+
+      g_mutex_lock (&watchdog->lock);
+      module = g_hash_table_lookup (watchdog->modules, info.dli_fname);
+      if (module != NULL)
+        g_strlcpy (name, module, name_len);
+      g_mutex_unlock (&watchdog->lock);
+      if (module == NULL)
+        continue;
+
+      /* static callbacks have no symbol, so fall back to the offset
+       * in the module, which can be resolved with addr2line */
+      if (info.dli_sname != NULL)
+        g_snprintf (location, location_len, "%s+0x%lx", info.dli_sname,
+                    (gulong) ((guint8 *) watchdog->frames[n] - (guint8 *) info.dli_saddr));
+      else
+        g_snprintf (location, location_len, "%s+0x%lx", info.dli_fname,
+                    (gulong) ((guint8 *) watchdog->frames[n] - (guint8 *) info.dli_fbase));
+      break;
+    }
+#endif
+#endif
+}
+
+
+
+static void
+panel_watchdog_record (PanelWatchdog *watchdog,
+                       const gchar   *name,
+                       gint64         duration)
+{
+  WatchdogStalls *stalls;
+  guint           i;
+
+  stalls = g_hash_table_lookup (watchdog->stalls, name);
+  if (stalls == NULL)
+    {
+      stalls = g_slice_new0 (WatchdogStalls);
+      stalls->name = g_strdup (name);
+      g_hash_table_insert (watchdog->stalls, stalls->name, stalls);
+    }
+
+  stalls->n_stalls++;
+  stalls->total += duration;
+  stalls->max = MAX (stalls->max, duration);
+
+  for (i = 0; i < G_N_ELEMENTS (watchdog_buckets); i++)
+    if (duration < watchdog_buckets[i] * G_TIME_SPAN_MILLISECOND)
+      break;
+  stalls->buckets[i]++;
+
+  panel_debug_filtered (PANEL_DEBUG_WATCHDOG,
+                        "%s: stalled the main loop for %d ms; "
+                        "stalls <0.5s=%u <1s=%u <2s=%u <5s=%u <10s=%u >=10s=%u",
+                        name, (gint) (duration / G_TIME_SPAN_MILLISECOND),
+                        stalls->buckets[0], stalls->buckets[1], stalls->buckets[2],
+                        stalls->buckets[3], stalls->buckets[4], stalls->buckets[5]);
+}
+
+
+
+static gboolean
+panel_watchdog_heartbeat (gpointer user_data)
+{
+  PanelWatchdog *watchdog = user_data;
+  gint64         pong_time;
+
+  /* before taking the lock, the thread may hold it for a moment */
+  pong_time = g_get_monotonic_time ();
+
+  g_mutex_lock (&watchdog->lock);
+  watchdog->pong = TRUE;
+  watchdog->pong_time = pong_time;
+  watchdog->heartbeat = NULL;
+  g_cond_signal (&watchdog->cond);
+  g_mutex_unlock (&watchdog->lock);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static gpointer
+panel_watchdog_thread (gpointer user_data)
+{
+  PanelWatchdog *watchdog = user_data;
+  GSource       *source;
+  gint64         ping_time;
+  gint64         deadline;
+  gchar          name[64];
+  gchar          location[128];
+  gchar          source_name[64];
+  gint64         duration;
+
+  g_mutex_lock (&watchdog->lock);
+
+  while (!watchdog->quit)
+    {
+      /* send a heartbeat through the main context, it is dispatched
+       * right after the source that is currently running */
+      source = g_idle_source_new ();
+      g_source_set_priority (source, G_PRIORITY_HIGH);
+      g_source_set_name (source, "panel-watchdog-heartbeat");
+      g_source_set_callback (source, panel_watchdog_heartbeat, watchdog, NULL);
+
+      ping_time = g_get_monotonic_time ();
+      watchdog->pong = FALSE;
+      watchdog->heartbeat = source;
+      g_source_attach (source, NULL);
+      g_source_unref (source);
+
+      deadline = ping_time + WATCHDOG_THRESHOLD * G_TIME_SPAN_MILLISECOND;
+      while (!watchdog->pong && !watchdog->quit)
+        if (!g_cond_wait_until (&watchdog->cond, &watchdog->lock, deadline))
+          break;
+
+      if (!watchdog->pong && !watchdog->quit)
+        {
+          /* the main loop is stuck, find out who is to blame */
+          *name = '\0';
+          *location = '\0';
+          *source_name = '\0';
+          g_mutex_unlock (&watchdog->lock);
+          panel_watchdog_sample (watchdog, name, sizeof (name), location, sizeof (location),
+                                 source_name, sizeof (source_name));
+          g_mutex_lock (&watchdog->lock);
+
+          panel_debug_filtered (PANEL_DEBUG_WATCHDOG,
+                                "main loop blocked for more than %d ms in %s at %s, source \"%s\"",
+                                WATCHDOG_THRESHOLD, *name != '\0' ? name : "unknown",
+                                *location != '\0' ? location : "?", source_name);
+
+          while (!watchdog->pong && !watchdog->quit)
+            g_cond_wait (&watchdog->cond, &watchdog->lock);
+
+          if (watchdog->pong)
+            {
+              /* unattributed stalls are grouped by their source name */
+              if (*name == '\0')
+                g_strlcpy (name, *source_name != '\0' ? source_name : "unknown", sizeof (name));
+              duration = watchdog->pong_time - ping_time;
+              panel_watchdog_record (watchdog, name, duration);
+
+              if (watchdog->stall_func != NULL)
+                {
+                  g_mutex_unlock (&watchdog->lock);
+                  watchdog->stall_func (name, duration, watchdog->stall_data);
+                  g_mutex_lock (&watchdog->lock);
+                }
+            }
+        }
+
+      /* wait for the next heartbeat */
+      deadline = g_get_monotonic_time () + WATCHDOG_INTERVAL * G_TIME_SPAN_MILLISECOND;
+      while (!watchdog->quit)
+        if (!g_cond_wait_until (&watchdog->cond, &watchdog->lock, deadline))
+          break;
+    }
+
+  g_mutex_unlock (&watchdog->lock);
+
+  return NULL;
+}
+
+
+
+void
+panel_watchdog_start (void)
+{
+  PanelWatchdog    *watchdog = panel_watchdog_get ();
+#ifdef WATCHDOG_SAMPLING
+  struct sigaction  sa;
+#endif
+
+  panel_return_if_fail (watchdog->thread == NULL);
+
+#ifdef WATCHDOG_SAMPLING
+  /* samples are taken in the thread running the main loop */
+  watchdog->main_thread = pthread_self ();
+
+#ifdef HAVE_EXECINFO_H
+  /* the first backtrace() call loads libgcc, which is not safe in
+   * a signal handler */
+  watchdog->n_frames = backtrace (watchdog->frames, WATCHDOG_MAX_FRAMES);
+#endif
+
+  sa.sa_handler = panel_watchdog_sample_handler;
+  sigemptyset (&sa.sa_mask);
+  sa.sa_flags = SA_RESTART;
+  if (sigaction (WATCHDOG_SIGNAL, &sa, NULL) == -1)
+    g_warning ("Failed to install the watchdog signal handler");
+#endif
+
+  watchdog->quit = FALSE;
+  watchdog->thread = g_thread_new ("panel-watchdog", panel_watchdog_thread, watchdog);
+}
+
+
+
+void
+panel_watchdog_stop (void)
+{
+  PanelWatchdog *watchdog = panel_watchdog_get ();
+
+  if (watchdog->thread == NULL)
+    return;
+
+  g_mutex_lock (&watchdog->lock);
+  watchdog->quit = TRUE;
+  g_cond_signal (&watchdog->cond);
+  g_mutex_unlock (&watchdog->lock);
+
+  g_thread_join (watchdog->thread);
+  watchdog->thread = NULL;
+
+  /* the heartbeat should not fire after the watchdog is gone */
+  if (watchdog->heartbeat != NULL)
+    {
+      g_source_destroy (watchdog->heartbeat);
+      watchdog->heartbeat = NULL;
+    }
+}
+
+
+
+void
+panel_watchdog_add_module (const gchar *filename,
+                           const gchar *name)
+{
+  PanelWatchdog *watchdog = panel_watchdog_get ();
+
+  panel_return_if_fail (filename != NULL);
+  panel_return_if_fail (name != NULL);
+
+  g_mutex_lock (&watchdog->lock);
+  g_hash_table_insert (watchdog->modules, g_strdup (filename), g_strdup (name));
+  g_mutex_unlock (&watchdog->lock);
+}
+
+
+
+void
+panel_watchdog_remove_module (const gchar *filename)
+{
+  PanelWatchdog *watchdog = panel_watchdog_get ();
+
+  panel_return_if_fail (filename != NULL);
+
+  g_mutex_lock (&watchdog->lock);
+  g_hash_table_remove (watchdog->modules, filename);
+  g_mutex_unlock (&watchdog->lock);
+}
+
+
+
+void
+panel_watchdog_set_stall_func (PanelWatchdogStallFunc func,
+                               gpointer               user_data)
+{
+  PanelWatchdog *watchdog = panel_watchdog_get ();
+
+  g_mutex_lock (&watchdog->lock);
+  watchdog->stall_func = func;
+  watchdog->stall_data = user_data;
+  g_mutex_unlock (&watchdog->lock);
+}
+
+
+
+void
+panel_watchdog_add_stall (const gchar *name,
+                          gint64       duration)
+{
+  PanelWatchdog *watchdog = panel_watchdog_get ();
+
+  panel_return_if_fail (name != NULL);
+  panel_return_if_fail (duration >= 0);
+
+  g_mutex_lock (&watchdog->lock);
+  panel_watchdog_record (watchdog, name, duration);
+  g_mutex_unlock (&watchdog->lock);
+}
+
+
+
+GVariant *
+panel_watchdog_get_stalls (void)
+{
+  PanelWatchdog   *watchdog = panel_watchdog_get ();
+  GVariantBuilder  builder;
+  GVariantBuilder  buckets;
+  GHashTableIter   iter;
+  WatchdogStalls  *stalls;
+  guint            i;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(suxxau)"));
+
+  g_mutex_lock (&watchdog->lock);
+
+  g_hash_table_iter_init (&iter, watchdog->stalls);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &stalls))
+    {
+      g_variant_builder_init (&buckets, G_VARIANT_TYPE ("au"));
+      for (i = 0; i < WATCHDOG_N_BUCKETS; i++)
+        g_variant_builder_add (&buckets, "u", stalls->buckets[i]);
+
+      g_variant_builder_add (&builder, "(suxxau)", stalls->name,
+                             stalls->n_stalls, stalls->total, stalls->max,
+                             &buckets);
+    }
+
+  g_mutex_unlock (&watchdog->lock);
+
+  return g_variant_builder_end (&builder);
+}
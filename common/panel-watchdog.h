@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2024 The Xfce development team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef __PANEL_WATCHDOG_H__
+#define __PANEL_WATCHDOG_H__
+
+#include <glib.h>
+
+typedef void (*PanelWatchdogStallFunc) (const gchar *name,
+                                        gint64       duration,
+                                        gpointer     user_data);
+
+void      panel_watchdog_start          (void);
+
+void      panel_watchdog_stop           (void);
+
+void      panel_watchdog_add_module     (const gchar            *filename,
+                                         const gchar            *name);
+
+void      panel_watchdog_remove_module  (const gchar            *filename);
+
+void      panel_watchdog_set_stall_func (PanelWatchdogStallFunc  func,
+                                         gpointer                user_data);
+
+void      panel_watchdog_add_stall      (const gchar            *name,
+                                         gint64                  duration);
+
+GVariant *panel_watchdog_get_stalls     (void);
+
+#endif /* !__PANEL_WATCHDOG_H__ */
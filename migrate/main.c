@@ -39,6 +39,7 @@
 
 #include <migrate/migrate-config.h>
 #include <migrate/migrate-default.h>
+#include <migrate/migrate-properties.h>
 
 
 
@@ -46,6 +47,74 @@
 #define DEFAULT_CONFIG_PATH     XDGCONFIGDIR G_DIR_SEPARATOR_S DEFAULT_CONFIG_FILENAME
 
 
+
+static gboolean opt_dry_run = FALSE;
+static gboolean opt_stats = FALSE;
+
+
+
+static GOptionEntry option_entries[] =
+{
+  { "dry-run", 'n', 0, G_OPTION_ARG_NONE, &opt_dry_run, N_("Do not write the migrated configuration"), NULL },
+  { "stats", 's', 0, G_OPTION_ARG_NONE, &opt_stats, N_("Print the number of migrated properties, Xfconf round-trips and the elapsed time"), NULL },
+  { NULL }
+};
+
+
+
+static void
+migrate_show_error (const GError *error,
+                    const gchar  *primary_text)
+{
+  /* no dialogs when only testing the migration */
+  if (opt_dry_run)
+    g_printerr ("%s: %s: %s\n", G_LOG_DOMAIN, primary_text, error->message);
+  else
+    xfce_dialog_show_error (NULL, error, "%s", primary_text);
+}
+
+
+
+static gboolean
+migrate_apply (GHashTable    *properties,
+               XfconfChannel *channel,
+               const gchar   *name,
+               GTimer        *timer,
+               gint           configver)
+{
+  guint    n_properties;
+  guint    n_round_trips;
+  gboolean succeed = TRUE;
+
+  n_properties = g_hash_table_size (properties);
+  n_round_trips = n_properties;
+
+  if (!opt_dry_run)
+    {
+      succeed = migrate_properties_apply (properties, channel, &n_round_trips);
+      if (!succeed)
+        g_warning ("Failed to write the %s configuration to Xfconf", name);
+    }
+
+  /* only mark the configuration as migrated once all its properties are
+   * written, so an interrupted or failed migration is retried */
+  if (succeed && configver >= 0)
+    {
+      if (!opt_dry_run)
+        xfconf_channel_set_int (channel, "/configver", configver);
+      n_round_trips++;
+    }
+
+  if (opt_stats)
+    g_print ("%s: %u properties, %u round-trips, %.3f ms%s\n", name,
+             n_properties, n_round_trips, g_timer_elapsed (timer, NULL) * 1000.0,
+             opt_dry_run ? " (dry run)" : "");
+
+  return succeed;
+}
+
+
+
 gint
 main (gint argc, gchar **argv)
 {
@@ -55,11 +124,28 @@ main (gint argc, gchar **argv)
   gint           configver;
   gchar         *filename_default;
   gboolean       migrate_vendor_default;
+  GHashTable    *properties;
+  GTimer        *timer;
 
   /* set translation domain */
   xfce_textdomain (GETTEXT_PACKAGE, PACKAGE_LOCALE_DIR, "UTF-8");
 
-  gtk_init (&argc, &argv);
+  if (!gtk_init_with_args (&argc, &argv, NULL, option_entries, GETTEXT_PACKAGE, &error))
+    {
+      if (error != NULL)
+        {
+          g_printerr ("%s: %s.\n", G_LOG_DOMAIN, error->message);
+          g_error_free (error);
+          return EXIT_FAILURE;
+        }
+
+      /* a dry run never shows a dialog, so it works without a display */
+      if (!opt_dry_run)
+        {
+          g_printerr ("%s: %s.\n", G_LOG_DOMAIN, _("Unable to open display"));
+          return EXIT_FAILURE;
+        }
+    }
 
   if (!xfconf_init (&error))
     {
@@ -68,6 +154,9 @@ main (gint argc, gchar **argv)
       return EXIT_FAILURE;
     }
 
+  timer = g_timer_new ();
+  configver = -1;
+
   channel = xfconf_channel_get (XFCE_PANEL_CHANNEL_NAME);
   if (!xfconf_channel_has_property (channel, PANELS_PROPERTY_PREFIX))
     {
@@ -100,26 +189,43 @@ main (gint argc, gchar **argv)
         {
           migrate_default:
 
-          /* apply default config */
-          if (!migrate_default (filename_default, &error))
+          /* apply default config, the version is written last */
+          properties = migrate_properties_new ();
+          if (migrate_default (filename_default, properties, &error))
             {
-              xfce_dialog_show_error (NULL, error, _("Failed to load the default configuration"));
+              configver = migrate_properties_get_int (properties, "/configver", -1);
+              g_hash_table_remove (properties, "/configver");
+
+              if (!migrate_apply (properties, channel, "default", timer, configver))
+                {
+                  configver = -1;
+                  retval = EXIT_FAILURE;
+                }
+            }
+          else
+            {
+              migrate_show_error (error, _("Failed to load the default configuration"));
               g_error_free (error);
               retval = EXIT_FAILURE;
             }
+          g_hash_table_destroy (properties);
         }
 
       g_free (filename_default);
     }
 
-  configver = xfconf_channel_get_int (channel, "/configver", -1);
+  if (configver < 0)
+    configver = xfconf_channel_get_int (channel, "/configver", -1);
   if (configver < XFCE4_PANEL_CONFIG_VERSION)
     {
       g_message (_("Panel config needs migration..."));
 
-      if (!migrate_config (channel, configver, &error))
+      g_timer_start (timer);
+      properties = migrate_properties_new ();
+
+      if (!migrate_config (channel, configver, properties, &error))
         {
-          xfce_dialog_show_error (NULL, error, _("Failed to migrate the existing configuration"));
+          migrate_show_error (error, _("Failed to migrate the existing configuration"));
           g_error_free (error);
           retval = EXIT_FAILURE;
         }
@@ -128,10 +234,14 @@ main (gint argc, gchar **argv)
           g_message (_("Panel configuration has been updated."));
         }
 
-      /* migration complete, set new version */
-      xfconf_channel_set_int (channel, "/configver", XFCE4_PANEL_CONFIG_VERSION);
+      /* migration complete, set new version after the other changes */
+      if (!migrate_apply (properties, channel, "config", timer, XFCE4_PANEL_CONFIG_VERSION))
+        retval = EXIT_FAILURE;
+      g_hash_table_destroy (properties);
     }
 
+  g_timer_destroy (timer);
+
   xfconf_shutdown ();
 
   return retval;
@@ -31,6 +31,7 @@
 #include <xfconf/xfconf.h>
 #include <common/panel-private.h>
 #include <migrate/migrate-config.h>
+#include <migrate/migrate-properties.h>
 
 
 
@@ -54,13 +55,10 @@ migrate_config_strchr_count (const gchar *haystack,
 
 
 static void
-migrate_config_session_menu (gpointer key,
-                             gpointer value,
-                             gpointer channel)
+migrate_config_session_menu (const gchar  *prop,
+                             const GValue *gvalue,
+                             GHashTable   *properties)
 {
-  const GValue *gvalue = value;
-  const gchar  *prop = key;
-
   /* skip non root plugin properties */
   if (!G_VALUE_HOLDS_STRING (gvalue)
       || migrate_config_strchr_count (prop, G_DIR_SEPARATOR) != 2
@@ -69,7 +67,7 @@ migrate_config_session_menu (gpointer key,
 
   /* this plugin never had any properties and matches the default
    * settings of the new actions plugin */
-  xfconf_channel_set_string (XFCONF_CHANNEL (channel), prop, "actions");
+  migrate_properties_set_string (properties, prop, "actions");
 }
 
 
@@ -111,17 +109,18 @@ migrate_config_action_48_convert (gint action)
 
 
 static void
-migrate_config_action_48 (gpointer key,
-                          gpointer value,
-                          gpointer channel)
+migrate_config_action_48 (const gchar  *prop,
+                          const GValue *gvalue,
+                          GHashTable   *plugins,
+                          GHashTable   *properties)
 {
-  const GValue *gvalue = value;
-  const gchar  *prop = key;
   gchar         str[64];
   gint          first_action_int;
   gint          second_action_int;
   const gchar  *first_action;
   const gchar  *second_action;
+  GPtrArray    *items;
+  GValue       *value;
 
   /* skip non root plugin properties */
   if (!G_VALUE_HOLDS_STRING (gvalue)
@@ -132,20 +131,20 @@ migrate_config_action_48 (gpointer key,
   /* this is a bug that affects pre users: don't try to migrate
    * when the appearance property is already set */
   g_snprintf (str, sizeof (str), "%s/appearance", prop);
-  if (xfconf_channel_has_property (channel, str))
+  if (g_hash_table_contains (plugins, str))
     return;
 
   /* set appearance to button mode */
-  xfconf_channel_set_uint (channel, str, 0);
+  migrate_properties_set_uint (properties, str, 0);
 
   /* read and remove the old properties */
   g_snprintf (str, sizeof (str), "%s/first-action", prop);
-  first_action_int = xfconf_channel_get_uint (channel, str, 0) + 1;
-  xfconf_channel_reset_property (channel, str, FALSE);
+  first_action_int = migrate_properties_get_uint (plugins, str, 0) + 1;
+  migrate_properties_reset (properties, str);
 
   g_snprintf (str, sizeof (str), "%s/second-action", prop);
-  second_action_int = xfconf_channel_get_uint (channel, str, 0);
-  xfconf_channel_reset_property (channel, str, FALSE);
+  second_action_int = migrate_properties_get_uint (plugins, str, 0);
+  migrate_properties_reset (properties, str);
 
   /* corrections for new plugin */
   if (first_action_int == 0)
@@ -155,18 +154,31 @@ migrate_config_action_48 (gpointer key,
 
   /* set orientation */
   g_snprintf (str, sizeof (str), "%s/invert-orientation", prop);
-  xfconf_channel_set_bool (channel, str, second_action_int > 0);
+  migrate_properties_set_bool (properties, str, second_action_int > 0);
 
   /* convert the old value to new ones */
   first_action = migrate_config_action_48_convert (first_action_int);
   second_action = migrate_config_action_48_convert (second_action_int);
 
   /* set the visible properties */
+  items = g_ptr_array_new_with_free_func (migrate_properties_value_free);
+
+  value = g_new0 (GValue, 1);
+  g_value_init (value, G_TYPE_STRING);
+  g_value_set_static_string (value, first_action);
+  g_ptr_array_add (items, value);
+
+  value = g_new0 (GValue, 1);
+  g_value_init (value, G_TYPE_STRING);
+  g_value_set_static_string (value, second_action);
+  g_ptr_array_add (items, value);
+
+  value = g_new0 (GValue, 1);
+  g_value_init (value, G_TYPE_PTR_ARRAY);
+  g_value_take_boxed (value, items);
+
   g_snprintf (str, sizeof (str), "%s/items", prop);
-  xfconf_channel_set_array (channel, str,
-                            G_TYPE_STRING, first_action,
-                            G_TYPE_STRING, second_action,
-                            G_TYPE_INVALID);
+  migrate_properties_take (properties, str, value);
 }
 
 
@@ -174,43 +186,62 @@ migrate_config_action_48 (gpointer key,
 gboolean
 migrate_config (XfconfChannel  *channel,
                 gint            configver,
+                GHashTable     *properties,
                 GError        **error)
 {
-  GHashTable *plugins;
-  guint       n, n_panels;
-  gchar       buf[50];
-  gboolean    horizontal;
+  GHashTable     *plugins;
+  GHashTable     *panels;
+  GHashTableIter  iter;
+  gpointer        key, value;
+  guint           n, n_panels;
+  gchar           buf[50];
+  gboolean        horizontal;
 
-  plugins = xfconf_channel_get_properties (channel, PLUGINS_PROPERTY_PREFIX);
+  /* the existing properties are read in one call, changes are
+   * collected in properties and written by the caller */
 
   /* migrate plugins to the new actions plugin */
   if (configver < 1)
     {
-      /* migrate xfsm-logout-plugin */
-      g_hash_table_foreach (plugins, migrate_config_session_menu, channel);
+      plugins = xfconf_channel_get_properties (channel, PLUGINS_PROPERTY_PREFIX);
+      if (plugins != NULL)
+        {
+          g_hash_table_iter_init (&iter, plugins);
+          while (g_hash_table_iter_next (&iter, &key, &value))
+            {
+              /* migrate xfsm-logout-plugin */
+              migrate_config_session_menu (key, value, properties);
+
+              /* migrate old action plugins */
+              migrate_config_action_48 (key, value, plugins, properties);
+            }
 
-      /* migrate old action plugins */
-      g_hash_table_foreach (plugins, migrate_config_action_48, channel);
+          g_hash_table_destroy (plugins);
+        }
     }
 
   /* migrate horizontal to mode property */
   if (configver < 2)
     {
-      n_panels = xfconf_channel_get_uint (channel, PANELS_PROPERTY_PREFIX, 0);
-      for (n = 0; n < n_panels; n++)
+      panels = xfconf_channel_get_properties (channel, PANELS_PROPERTY_PREFIX);
+      if (panels != NULL)
         {
-          /* read and remove old property */
-          g_snprintf (buf, sizeof (buf), PANELS_PROPERTY_BASE "/horizontal", n);
-          horizontal = xfconf_channel_get_bool (channel, buf, TRUE);
-          xfconf_channel_reset_property (channel, buf, FALSE);
-
-          /* set new mode */
-          g_snprintf (buf, sizeof (buf), PANELS_PROPERTY_BASE "/mode", n);
-          xfconf_channel_set_uint (channel, buf, horizontal ? 0 : 1);
+          n_panels = migrate_properties_get_uint (panels, PANELS_PROPERTY_PREFIX, 0);
+          for (n = 0; n < n_panels; n++)
+            {
+              /* read and remove old property */
+              g_snprintf (buf, sizeof (buf), PANELS_PROPERTY_BASE "/horizontal", n);
+              horizontal = migrate_properties_get_bool (panels, buf, TRUE);
+              migrate_properties_reset (properties, buf);
+
+              /* set new mode */
+              g_snprintf (buf, sizeof (buf), PANELS_PROPERTY_BASE "/mode", n);
+              migrate_properties_set_uint (properties, buf, horizontal ? 0 : 1);
+            }
+
+          g_hash_table_destroy (panels);
         }
     }
 
-  g_hash_table_destroy (plugins);
-
   return TRUE;
 }
@@ -25,6 +25,7 @@ G_BEGIN_DECLS
 
 gboolean migrate_config (XfconfChannel  *channel,
                          gint            configver,
+                         GHashTable     *properties,
                          GError        **error);
 
 G_END_DECLS
@@ -31,15 +31,16 @@
 #include <xfconf/xfconf.h>
 #include <libxfce4util/libxfce4util.h>
 #include <migrate/migrate-default.h>
+#include <migrate/migrate-properties.h>
 #include <libxfce4panel/xfce-panel-macros.h>
 
 
 
 typedef struct
 {
-  XfconfChannel *channel;
-  GSList        *path;
-  GPtrArray     *array;
+  GHashTable *properties;
+  GSList     *path;
+  GPtrArray  *array;
 }
 ConfigParser;
 
@@ -118,6 +119,24 @@ migrate_default_property_path (ConfigParser *parser)
 
 
 
+static void
+migrate_default_flush_array (ConfigParser *parser)
+{
+  GValue *value;
+  gchar  *prop_path;
+
+  value = g_new0 (GValue, 1);
+  g_value_init (value, G_TYPE_PTR_ARRAY);
+  g_value_take_boxed (value, parser->array);
+  parser->array = NULL;
+
+  prop_path = migrate_default_property_path (parser);
+  migrate_properties_take (parser->properties, prop_path, value);
+  g_free (prop_path);
+}
+
+
+
 static void
 migrate_default_start_element_handler (GMarkupParseContext  *context,
                                        const gchar          *element_name,
@@ -132,9 +151,8 @@ migrate_default_start_element_handler (GMarkupParseContext  *context,
   const gchar  *prop_name, *prop_value, *prop_type;
   GType         type;
   gchar        *prop_path;
-  GValue        value = { 0, };
+  GValue       *value;
   const gchar  *value_value, *value_type;
-  GValue       *value2;
 
   if (strcmp (element_name, "channel") == 0)
     {
@@ -154,12 +172,9 @@ migrate_default_start_element_handler (GMarkupParseContext  *context,
             }
         }
 
-      if (channel_name != NULL)
-        {
-          /* open the xfconf channel */
-          parser->channel = xfconf_channel_get (channel_name);
-        }
-      else
+      /* the properties are collected in a table and written to
+       * the channel by the caller */
+      if (channel_name == NULL)
         {
           g_set_error_literal (error, G_MARKUP_ERROR_INVALID_CONTENT, G_MARKUP_ERROR,
                                "The channel element has no name attribute");
@@ -173,14 +188,7 @@ migrate_default_start_element_handler (GMarkupParseContext  *context,
 
       /* check if we need to flush an array */
       if (parser->array != NULL)
-        {
-          prop_path = migrate_default_property_path (parser);
-          xfconf_channel_set_arrayv (parser->channel, prop_path, parser->array);
-          g_free (prop_path);
-
-          xfconf_array_free (parser->array);
-          parser->array = NULL;
-        }
+        migrate_default_flush_array (parser);
 
       if (G_LIKELY (attribute_names != NULL))
         {
@@ -209,18 +217,17 @@ migrate_default_start_element_handler (GMarkupParseContext  *context,
             }
           if (type == G_TYPE_BOXED)
             {
-              parser->array = g_ptr_array_new ();
+              parser->array = g_ptr_array_new_with_free_func (migrate_properties_value_free);
             }
           else if (type != G_TYPE_NONE && prop_value != NULL)
             {
-              g_value_init (&value, type);
-              migrate_default_set_value (&value, prop_value);
+              value = g_new0 (GValue, 1);
+              g_value_init (value, type);
+              migrate_default_set_value (value, prop_value);
 
               prop_path = migrate_default_property_path (parser);
-              xfconf_channel_set_property (parser->channel, prop_path, &value);
+              migrate_properties_take (parser->properties, prop_path, value);
               g_free (prop_path);
-
-              g_value_unset (&value);
             }
         }
       else
@@ -254,12 +261,12 @@ migrate_default_start_element_handler (GMarkupParseContext  *context,
 
               if (type != G_TYPE_INVALID && type != G_TYPE_NONE && type != G_TYPE_BOXED)
                 {
-                  value2 = g_new0 (GValue, 1);
-                  g_value_init (value2, type);
+                  value = g_new0 (GValue, 1);
+                  g_value_init (value, type);
 
-                  migrate_default_set_value (value2, value_value);
+                  migrate_default_set_value (value, value_value);
 
-                  g_ptr_array_add (parser->array, value2);
+                  g_ptr_array_add (parser->array, value);
                 }
               else
                 {
@@ -297,13 +304,9 @@ migrate_default_end_element_handler (GMarkupParseContext  *context,
 {
   ConfigParser *parser = user_data;
   GSList       *li;
-  gchar        *prop_path;
 
   if (strcmp (element_name, "channel") == 0)
     {
-      if (G_LIKELY (parser->channel != NULL))
-        parser->channel = NULL;
-
      if (parser->path != NULL)
        {
          g_set_error_literal (error, G_MARKUP_ERROR_UNKNOWN_ELEMENT, G_MARKUP_ERROR,
@@ -313,14 +316,7 @@ migrate_default_end_element_handler (GMarkupParseContext  *context,
   else if (strcmp (element_name, "property") == 0)
     {
       if (parser->array != NULL)
-        {
-          prop_path = migrate_default_property_path (parser);
-          xfconf_channel_set_arrayv (parser->channel, prop_path, parser->array);
-          g_free (prop_path);
-
-          xfconf_array_free (parser->array);
-          parser->array = NULL;
-        }
+        migrate_default_flush_array (parser);
 
       li = g_slist_last (parser->path);
       if (li != NULL)
@@ -360,6 +356,7 @@ static GMarkupParser markup_parser =
 
 gboolean
 migrate_default (const gchar    *filename,
+                 GHashTable     *properties,
                  GError        **error)
 {
   gsize                length;
@@ -369,6 +366,7 @@ migrate_default (const gchar    *filename,
   gboolean             succeed = FALSE;
 
   g_return_val_if_fail (filename != NULL, FALSE);
+  g_return_val_if_fail (properties != NULL, FALSE);
   g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
   if (!g_file_get_contents (filename, &contents, &length, error))
@@ -376,6 +374,7 @@ migrate_default (const gchar    *filename,
 
   parser = g_slice_new0 (ConfigParser);
   parser->path = NULL;
+  parser->properties = properties;
 
   context = g_markup_parse_context_new (&markup_parser, 0, parser, NULL);
 
@@ -388,6 +387,11 @@ migrate_default (const gchar    *filename,
 
   g_free (contents);
   g_markup_parse_context_free (context);
+
+  /* leftovers of a failed parse */
+  if (parser->array != NULL)
+    g_ptr_array_unref (parser->array);
+  g_slist_free_full (parser->path, g_free);
   g_slice_free (ConfigParser, parser);
 
   return succeed;
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2024 The Xfce development team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <gtk/gtk.h>
+#include <xfconf/xfconf.h>
+#include <migrate/migrate-properties.h>
+
+
+
+/* the migrators collect their changes in a table of property path
+ * to GValue, a NULL value resets the property; the table is written
+ * to xfconf by migrate_properties_apply() once everything is known */
+GHashTable *
+migrate_properties_new (void)
+{
+  return g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                migrate_properties_value_free);
+}
+
+
+
+void
+migrate_properties_value_free (gpointer data)
+{
+  GValue *value = data;
+
+  if (value != NULL)
+    {
+      g_value_unset (value);
+      g_free (value);
+    }
+}
+
+
+
+void
+migrate_properties_take (GHashTable  *properties,
+                         const gchar *property,
+                         GValue      *value)
+{
+  g_return_if_fail (properties != NULL);
+  g_return_if_fail (property != NULL && *property == '/');
+
+  g_hash_table_replace (properties, g_strdup (property), value);
+}
+
+
+
+void
+migrate_properties_set_int (GHashTable  *properties,
+                            const gchar *property,
+                            gint         int_value)
+{
+  GValue *value;
+
+  value = g_new0 (GValue, 1);
+  g_value_init (value, G_TYPE_INT);
+  g_value_set_int (value, int_value);
+  migrate_properties_take (properties, property, value);
+}
+
+
+
+void
+migrate_properties_set_uint (GHashTable  *properties,
+                             const gchar *property,
+                             guint        uint_value)
+{
+  GValue *value;
+
+  value = g_new0 (GValue, 1);
+  g_value_init (value, G_TYPE_UINT);
+  g_value_set_uint (value, uint_value);
+  migrate_properties_take (properties, property, value);
+}
+
+
+
+void
+migrate_properties_set_bool (GHashTable  *properties,
+                             const gchar *property,
+                             gboolean     bool_value)
+{
+  GValue *value;
+
+  value = g_new0 (GValue, 1);
+  g_value_init (value, G_TYPE_BOOLEAN);
+  g_value_set_boolean (value, bool_value);
+  migrate_properties_take (properties, property, value);
+}
+
+
+
+void
+migrate_properties_set_string (GHashTable  *properties,
+                               const gchar *property,
+                               const gchar *string_value)
+{
+  GValue *value;
+
+  value = g_new0 (GValue, 1);
+  g_value_init (value, G_TYPE_STRING);
+  g_value_set_string (value, string_value);
+  migrate_properties_take (properties, property, value);
+}
+
+
+
+void
+migrate_properties_reset (GHashTable  *properties,
+                          const gchar *property)
+{
+  migrate_properties_take (properties, property, NULL);
+}
+
+
+
+static gboolean
+migrate_properties_lookup (GHashTable  *properties,
+                           const gchar *property,
+                           GValue      *value)
+{
+  const GValue *stored;
+
+  g_return_val_if_fail (properties != NULL, FALSE);
+  g_return_val_if_fail (property != NULL, FALSE);
+
+  stored = g_hash_table_lookup (properties, property);
+  if (stored == NULL)
+    return FALSE;
+
+  /* same conversion xfconf_channel_get_*() would do */
+  return g_value_type_transformable (G_VALUE_TYPE (stored), G_VALUE_TYPE (value))
+         && g_value_transform (stored, value);
+}
+
+
+
+gint
+migrate_properties_get_int (GHashTable  *properties,
+                            const gchar *property,
+                            gint         default_value)
+{
+  GValue value = G_VALUE_INIT;
+  gint   result = default_value;
+
+  g_value_init (&value, G_TYPE_INT);
+  if (migrate_properties_lookup (properties, property, &value))
+    result = g_value_get_int (&value);
+  g_value_unset (&value);
+
+  return result;
+}
+
+
+
+guint
+migrate_properties_get_uint (GHashTable  *properties,
+                             const gchar *property,
+                             guint        default_value)
+{
+  GValue value = G_VALUE_INIT;
+  guint  result = default_value;
+
+  g_value_init (&value, G_TYPE_UINT);
+  if (migrate_properties_lookup (properties, property, &value))
+    result = g_value_get_uint (&value);
+  g_value_unset (&value);
+
+  return result;
+}
+
+
+
+gboolean
+migrate_properties_get_bool (GHashTable  *properties,
+                             const gchar *property,
+                             gboolean     default_value)
+{
+  GValue   value = G_VALUE_INIT;
+  gboolean result = default_value;
+
+  g_value_init (&value, G_TYPE_BOOLEAN);
+  if (migrate_properties_lookup (properties, property, &value))
+    result = g_value_get_boolean (&value);
+  g_value_unset (&value);
+
+  return result;
+}
+
+
+
+gboolean
+migrate_properties_apply (GHashTable    *properties,
+                          XfconfChannel *channel,
+                          guint         *n_round_trips)
+{
+  GHashTableIter  iter;
+  gpointer        key;
+  gpointer        value;
+  guint           n_failed = 0;
+
+  g_return_val_if_fail (properties != NULL, FALSE);
+  g_return_val_if_fail (XFCONF_IS_CHANNEL (channel), FALSE);
+
+  /* xfconfd has no batched method, every reset and set is a round-trip;
+   * keep going on a failure so a single bad value does not drop the
+   * rest of the configuration */
+  g_hash_table_iter_init (&iter, properties);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      if (value == NULL)
+        xfconf_channel_reset_property (channel, key, FALSE);
+      else if (!xfconf_channel_set_property (channel, key, value))
+        n_failed++;
+    }
+
+  if (n_round_trips != NULL)
+    *n_round_trips = g_hash_table_size (properties);
+
+  return n_failed == 0;
+}
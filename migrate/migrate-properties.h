@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2024 The Xfce development team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __MIGRATE_PROPERTIES_H__
+#define __MIGRATE_PROPERTIES_H__
+
+#include <gtk/gtk.h>
+#include <xfconf/xfconf.h>
+
+G_BEGIN_DECLS
+
+GHashTable *migrate_properties_new          (void);
+
+void        migrate_properties_value_free   (gpointer       data);
+
+void        migrate_properties_take         (GHashTable    *properties,
+                                             const gchar   *property,
+                                             GValue        *value);
+
+void        migrate_properties_set_int      (GHashTable    *properties,
+                                             const gchar   *property,
+                                             gint           int_value);
+
+void        migrate_properties_set_uint     (GHashTable    *properties,
+                                             const gchar   *property,
+                                             guint          uint_value);
+
+void        migrate_properties_set_bool     (GHashTable    *properties,
+                                             const gchar   *property,
+                                             gboolean       bool_value);
+
+void        migrate_properties_set_string   (GHashTable    *properties,
+                                             const gchar   *property,
+                                             const gchar   *string_value);
+
+void        migrate_properties_reset        (GHashTable    *properties,
+                                             const gchar   *property);
+
+gint        migrate_properties_get_int      (GHashTable    *properties,
+                                             const gchar   *property,
+                                             gint           default_value);
+
+guint       migrate_properties_get_uint     (GHashTable    *properties,
+                                             const gchar   *property,
+                                             guint          default_value);
+
+gboolean    migrate_properties_get_bool     (GHashTable    *properties,
+                                             const gchar   *property,
+                                             gboolean       default_value);
+
+gboolean    migrate_properties_apply        (GHashTable    *properties,
+                                             XfconfChannel *channel,
+                                             guint         *n_round_trips);
+
+G_END_DECLS
+
+#endif /* !__MIGRATE_PROPERTIES_H__ */
@@ -45,6 +45,7 @@
 
 #include <common/panel-private.h>
 #include <common/panel-debug.h>
+#include <common/panel-watchdog.h>
 #include <libxfce4panel/libxfce4panel.h>
 #include <panel/panel-application.h>
 #include <panel/panel-dbus-service.h>
@@ -144,6 +145,16 @@ panel_signal_handler (gint signum)
 
 
 
+static gboolean
+panel_start_watchdog (gpointer user_data)
+{
+  panel_watchdog_start ();
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
 static void
 panel_sm_client_quit (XfceSMClient *sm_client)
 {
@@ -368,6 +379,12 @@ main (gint argc, gchar **argv)
   for (i = 0; i < G_N_ELEMENTS (signums); i++)
     signal (signums[i], panel_signal_handler);
 
+  /* dump the debug flight recorder on SIGUSR2 */
+  panel_debug_recorder_watch_signal ();
+
+  /* detect and attribute stalls of the main loop once it runs */
+  g_idle_add (panel_start_watchdog, NULL);
+
   /* set EWMH source indication */
 G_GNUC_BEGIN_IGNORE_DEPRECATIONS
   wnck_set_client_type (WNCK_CLIENT_TYPE_PAGER);
@@ -375,6 +392,8 @@ G_GNUC_END_IGNORE_DEPRECATIONS
 
   gtk_main ();
 
+  panel_watchdog_stop ();
+
   /* make sure there are no incomming events when we close */
   g_object_unref (G_OBJECT (dbus_service));
 
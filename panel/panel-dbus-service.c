@@ -28,6 +28,8 @@
 #include <gio/gio.h>
 #include <common/panel-private.h>
 #include <common/panel-dbus.h>
+#include <common/panel-debug.h>
+#include <common/panel-watchdog.h>
 #include <libxfce4util/libxfce4util.h>
 #include <libxfce4ui/libxfce4ui.h>
 #include <libxfce4panel/libxfce4panel.h>
@@ -74,9 +76,56 @@ static gboolean  panel_dbus_service_terminate                  (XfcePanelExporte
                                                                 GDBusMethodInvocation    *invocation,
                                                                 gboolean                  restart,
                                                                 PanelDBusService         *service);
+static gboolean  panel_dbus_service_record_launch              (XfcePanelExportedService *skeleton,
+                                                                GDBusMethodInvocation    *invocation,
+                                                                const gchar              *desktop_id,
+                                                                gint64                    time,
+                                                                gint64                    spawn_latency,
+                                                                gint64                    mapped_latency,
+                                                                PanelDBusService         *service);
+static gboolean  panel_dbus_service_get_launches               (XfcePanelExportedService *skeleton,
+                                                                GDBusMethodInvocation    *invocation,
+                                                                PanelDBusService         *service);
+static gboolean  panel_dbus_service_get_launch_summary         (XfcePanelExportedService *skeleton,
+                                                                GDBusMethodInvocation    *invocation,
+                                                                PanelDBusService         *service);
+static gboolean  panel_dbus_service_dump_debug_recorder        (XfcePanelExportedService *skeleton,
+                                                                GDBusMethodInvocation    *invocation,
+                                                                PanelDBusService         *service);
+static gboolean  panel_dbus_service_get_stall_summary          (XfcePanelExportedService *skeleton,
+                                                                GDBusMethodInvocation    *invocation,
+                                                                PanelDBusService         *service);
+
 
 
 
+/* number of launches kept in the ring buffer */
+#define LAUNCH_RING_SIZE (256)
+
+
+
+typedef struct
+{
+  gchar  *desktop_id;
+  gint64  time;
+  gint64  spawn_latency;
+  gint64  mapped_latency;
+}
+LaunchEvent;
+
+typedef struct
+{
+  const gchar *desktop_id;
+  guint        n_launches;
+  gint64       spawn_total;
+  gint64       spawn_max;
+  guint        n_mapped;
+  gint64       mapped_total;
+  gint64       mapped_max;
+}
+LaunchSummary;
+
+
 
 struct _PanelDBusServiceClass
 {
@@ -92,6 +141,11 @@ struct _PanelDBusService
 
   /* queue for remote-events */
   GHashTable      *remote_events;
+
+  /* ring buffer of recent launches */
+  LaunchEvent      launches[LAUNCH_RING_SIZE];
+  guint            launches_head;
+  guint            n_launches;
 };
 
 typedef struct
@@ -132,6 +186,8 @@ panel_dbus_service_init (PanelDBusService *service)
   GError *error = NULL;
 
   service->remote_events = NULL;
+  service->launches_head = 0;
+  service->n_launches = 0;
 
   service->connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
   if (G_LIKELY (service->connection != NULL))
@@ -153,6 +209,16 @@ panel_dbus_service_init (PanelDBusService *service)
                             G_CALLBACK(panel_dbus_service_save), service);
           g_signal_connect (service, "handle_terminate",
                             G_CALLBACK(panel_dbus_service_terminate), service);
+          g_signal_connect (service, "handle_record_launch",
+                            G_CALLBACK(panel_dbus_service_record_launch), service);
+          g_signal_connect (service, "handle_get_launches",
+                            G_CALLBACK(panel_dbus_service_get_launches), service);
+          g_signal_connect (service, "handle_get_launch_summary",
+                            G_CALLBACK(panel_dbus_service_get_launch_summary), service);
+          g_signal_connect (service, "handle_dump_debug_recorder",
+                            G_CALLBACK(panel_dbus_service_dump_debug_recorder), service);
+          g_signal_connect (service, "handle_get_stall_summary",
+                            G_CALLBACK(panel_dbus_service_get_stall_summary), service);
         }
       else
         {
@@ -173,6 +239,7 @@ static void
 panel_dbus_service_finalize (GObject *object)
 {
   PanelDBusService *service = PANEL_DBUS_SERVICE (object);
+  guint             i;
 
   if (service->remote_events != NULL)
     {
@@ -180,6 +247,9 @@ panel_dbus_service_finalize (GObject *object)
       g_hash_table_destroy (service->remote_events);
     }
 
+  for (i = 0; i < LAUNCH_RING_SIZE; i++)
+    g_free (service->launches[i].desktop_id);
+
   (*G_OBJECT_CLASS (panel_dbus_service_parent_class)->finalize) (object);
 }
 
@@ -376,6 +446,185 @@ panel_dbus_service_terminate (XfcePanelExportedService *skeleton,
 
 
 
+static gboolean
+panel_dbus_service_record_launch (XfcePanelExportedService *skeleton,
+                                  GDBusMethodInvocation    *invocation,
+                                  const gchar              *desktop_id,
+                                  gint64                    time,
+                                  gint64                    spawn_latency,
+                                  gint64                    mapped_latency,
+                                  PanelDBusService         *service)
+{
+  LaunchEvent *event;
+
+  panel_return_val_if_fail (PANEL_IS_DBUS_SERVICE (service), FALSE);
+
+  /* overwrite the oldest launch if the buffer is full */
+  event = &service->launches[service->launches_head];
+  g_free (event->desktop_id);
+  event->desktop_id = g_strdup (desktop_id);
+  event->time = time;
+  event->spawn_latency = spawn_latency;
+  event->mapped_latency = mapped_latency;
+
+  service->launches_head = (service->launches_head + 1) % LAUNCH_RING_SIZE;
+  if (service->n_launches < LAUNCH_RING_SIZE)
+    service->n_launches++;
+
+  xfce_panel_exported_service_complete_record_launch (skeleton, invocation);
+
+  return TRUE;
+}
+
+
+
+static LaunchEvent *
+panel_dbus_service_get_launch (PanelDBusService *service,
+                               guint             n)
+{
+  guint first;
+
+  panel_return_val_if_fail (n < service->n_launches, NULL);
+
+  /* nth launch, oldest first */
+  first = (service->launches_head + LAUNCH_RING_SIZE - service->n_launches) % LAUNCH_RING_SIZE;
+
+  return &service->launches[(first + n) % LAUNCH_RING_SIZE];
+}
+
+
+
+static gboolean
+panel_dbus_service_get_launches (XfcePanelExportedService *skeleton,
+                                 GDBusMethodInvocation    *invocation,
+                                 PanelDBusService         *service)
+{
+  GVariantBuilder  builder;
+  LaunchEvent     *event;
+  guint            n;
+
+  panel_return_val_if_fail (PANEL_IS_DBUS_SERVICE (service), FALSE);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sxxx)"));
+  for (n = 0; n < service->n_launches; n++)
+    {
+      event = panel_dbus_service_get_launch (service, n);
+      g_variant_builder_add (&builder, "(sxxx)", event->desktop_id, event->time,
+                             event->spawn_latency, event->mapped_latency);
+    }
+
+  xfce_panel_exported_service_complete_get_launches (skeleton, invocation,
+                                                     g_variant_builder_end (&builder));
+
+  return TRUE;
+}
+
+
+
+static gboolean
+panel_dbus_service_get_launch_summary (XfcePanelExportedService *skeleton,
+                                       GDBusMethodInvocation    *invocation,
+                                       PanelDBusService         *service)
+{
+  GVariantBuilder  builder;
+  GHashTable      *table;
+  GPtrArray       *summaries;
+  LaunchSummary   *summary;
+  LaunchEvent     *event;
+  guint            n;
+
+  panel_return_val_if_fail (PANEL_IS_DBUS_SERVICE (service), FALSE);
+
+  /* accumulate per desktop id, in order of the first launch */
+  table = g_hash_table_new (g_str_hash, g_str_equal);
+  summaries = g_ptr_array_new_with_free_func (g_free);
+  for (n = 0; n < service->n_launches; n++)
+    {
+      event = panel_dbus_service_get_launch (service, n);
+      summary = g_hash_table_lookup (table, event->desktop_id);
+      if (summary == NULL)
+        {
+          summary = g_new0 (LaunchSummary, 1);
+          summary->desktop_id = event->desktop_id;
+          g_hash_table_insert (table, event->desktop_id, summary);
+          g_ptr_array_add (summaries, summary);
+        }
+
+      summary->n_launches++;
+      summary->spawn_total += event->spawn_latency;
+      summary->spawn_max = MAX (summary->spawn_max, event->spawn_latency);
+
+      if (event->mapped_latency >= 0)
+        {
+          summary->n_mapped++;
+          summary->mapped_total += event->mapped_latency;
+          summary->mapped_max = MAX (summary->mapped_max, event->mapped_latency);
+        }
+    }
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(suxxuxx)"));
+  for (n = 0; n < summaries->len; n++)
+    {
+      summary = g_ptr_array_index (summaries, n);
+      g_variant_builder_add (&builder, "(suxxuxx)", summary->desktop_id,
+                             summary->n_launches,
+                             summary->spawn_total / summary->n_launches,
+                             summary->spawn_max,
+                             summary->n_mapped,
+                             summary->n_mapped > 0 ? summary->mapped_total / summary->n_mapped : -1,
+                             summary->n_mapped > 0 ? summary->mapped_max : -1);
+    }
+
+  g_hash_table_destroy (table);
+  g_ptr_array_unref (summaries);
+
+  xfce_panel_exported_service_complete_get_launch_summary (skeleton, invocation,
+                                                           g_variant_builder_end (&builder));
+
+  return TRUE;
+}
+
+
+
+static gboolean
+panel_dbus_service_dump_debug_recorder (XfcePanelExportedService *skeleton,
+                                        GDBusMethodInvocation    *invocation,
+                                        PanelDBusService         *service)
+{
+  gchar *dump;
+  gchar *events;
+
+  panel_return_val_if_fail (PANEL_IS_DBUS_SERVICE (service), FALSE);
+
+  /* recorded strings are truncated on a byte boundary and can contain
+   * file names or window titles, a dbus string must be valid utf-8 */
+  dump = panel_debug_recorder_dump ();
+  events = g_utf8_make_valid (dump, -1);
+  g_free (dump);
+
+  xfce_panel_exported_service_complete_dump_debug_recorder (skeleton, invocation, events);
+  g_free (events);
+
+  return TRUE;
+}
+
+
+
+static gboolean
+panel_dbus_service_get_stall_summary (XfcePanelExportedService *skeleton,
+                                      GDBusMethodInvocation    *invocation,
+                                      PanelDBusService         *service)
+{
+  panel_return_val_if_fail (PANEL_IS_DBUS_SERVICE (service), FALSE);
+
+  xfce_panel_exported_service_complete_get_stall_summary (skeleton, invocation,
+                                                          panel_watchdog_get_stalls ());
+
+  return TRUE;
+}
+
+
+
 static void
 panel_dbus_service_plugin_event_free (gpointer data)
 {
@@ -42,6 +42,7 @@
 
 #define BORDER         (6)
 #define ITEMS_HELP_URL "http://www.xfce.org"
+#define SEARCH_DELAY   (150)
 
 
 
@@ -82,6 +83,8 @@ static void         panel_item_dialog_drag_data_received     (GtkWidget
                                                               guint               info,
                                                               guint               drag_time,
                                                               PanelItemDialog    *dialog);
+static void         panel_item_dialog_search_changed         (GtkEntry           *entry,
+                                                              PanelItemDialog    *dialog);
 static void         panel_item_dialog_populate_store         (PanelItemDialog    *dialog);
 static gint         panel_item_dialog_compare_func           (GtkTreeModel       *model,
                                                               GtkTreeIter        *a,
@@ -117,6 +120,11 @@ struct _PanelItemDialog
   GtkListStore       *store;
   GtkTreeView        *treeview;
   GtkWidget          *add_button;
+
+  /* search entry and the normalized query the rows are filtered on */
+  GtkWidget          *search_entry;
+  gchar              *search_query;
+  guint               search_timeout_id;
 };
 
 enum
@@ -124,6 +132,8 @@ enum
   COLUMN_ICON_NAME,
   COLUMN_MODULE,
   COLUMN_SENSITIVE,
+  COLUMN_SEARCH_KEY,
+  COLUMN_VISIBLE,
   N_COLUMNS
 };
 
@@ -228,6 +238,7 @@ panel_item_dialog_init (PanelItemDialog *dialog)
   gtk_widget_show (label);
 
   entry = gtk_entry_new ();
+  dialog->search_entry = entry;
   gtk_box_pack_start (GTK_BOX (hbox), entry, FALSE, FALSE, 0);
   gtk_label_set_mnemonic_widget (GTK_LABEL (label), entry);
   gtk_widget_set_tooltip_text (entry, _("Enter search phrase here"));
@@ -243,14 +254,15 @@ panel_item_dialog_init (PanelItemDialog *dialog)
   gtk_widget_show (scroll);
 
   /* create the store and automatically sort it */
-  dialog->store = gtk_list_store_new (N_COLUMNS, G_TYPE_STRING, G_TYPE_OBJECT, G_TYPE_BOOLEAN);
+  dialog->store = gtk_list_store_new (N_COLUMNS, G_TYPE_STRING, G_TYPE_OBJECT, G_TYPE_BOOLEAN,
+                                      G_TYPE_STRING, G_TYPE_BOOLEAN);
   gtk_tree_sortable_set_sort_func (GTK_TREE_SORTABLE (dialog->store), COLUMN_MODULE, panel_item_dialog_compare_func, NULL, NULL);
   gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (dialog->store), COLUMN_MODULE, GTK_SORT_ASCENDING);
 
   /* create treemodel with filter */
   filter = gtk_tree_model_filter_new (GTK_TREE_MODEL (dialog->store), NULL);
-  gtk_tree_model_filter_set_visible_func (GTK_TREE_MODEL_FILTER (filter), panel_item_dialog_visible_func, entry, NULL);
-  g_signal_connect_swapped (G_OBJECT (entry), "changed", G_CALLBACK (gtk_tree_model_filter_refilter), filter);
+  gtk_tree_model_filter_set_visible_func (GTK_TREE_MODEL_FILTER (filter), panel_item_dialog_visible_func, NULL, NULL);
+  g_signal_connect (G_OBJECT (entry), "changed", G_CALLBACK (panel_item_dialog_search_changed), dialog);
 
   /* treeview */
   treeview = gtk_tree_view_new_with_model (filter);
@@ -301,6 +313,11 @@ panel_item_dialog_finalize (GObject *object)
 {
   PanelItemDialog *dialog = PANEL_ITEM_DIALOG (object);
 
+  if (dialog->search_timeout_id != 0)
+    g_source_remove (dialog->search_timeout_id);
+
+  g_free (dialog->search_query);
+
   /* disconnect unique-changed signal */
   g_signal_handlers_disconnect_by_func (G_OBJECT (dialog->factory),
       panel_item_dialog_unique_changed, dialog);
@@ -600,6 +617,142 @@ panel_item_dialog_drag_data_received (GtkWidget        *treeview,
 
 
 
+static gchar *
+panel_item_dialog_search_key (const gchar *text)
+{
+  gchar       *casefolded;
+  gchar       *normalized;
+  const gchar *p;
+  gunichar     c;
+  GString     *key;
+
+  if (panel_str_is_empty (text))
+    return NULL;
+
+  /* casefold and decompose, so accents end up as separate marks */
+  casefolded = g_utf8_casefold (text, -1);
+  normalized = g_utf8_normalize (casefolded, -1, G_NORMALIZE_ALL);
+  g_free (casefolded);
+  if (G_UNLIKELY (normalized == NULL))
+    return NULL;
+
+  /* strip the marks */
+  key = g_string_sized_new (strlen (normalized));
+  for (p = normalized; *p != '\0'; p = g_utf8_next_char (p))
+    {
+      c = g_utf8_get_char (p);
+      if (!g_unichar_ismark (c))
+        g_string_append_unichar (key, c);
+    }
+  g_free (normalized);
+
+  return g_string_free (key, FALSE);
+}
+
+
+
+static gboolean
+panel_item_dialog_search_matches (const gchar *key,
+                                  const gchar *query)
+{
+  /* the separator has no key and is hidden when searching */
+  if (query == NULL)
+    return TRUE;
+  else if (key == NULL)
+    return FALSE;
+
+  return strstr (key, query) != NULL;
+}
+
+
+
+static void
+panel_item_dialog_search_update (PanelItemDialog *dialog)
+{
+  gchar       *query;
+  gboolean     narrow;
+  gboolean     valid;
+  gboolean     visible;
+  gboolean     was_visible;
+  gchar       *key;
+  GtkTreeIter  iter;
+
+  panel_return_if_fail (PANEL_IS_ITEM_DIALOG (dialog));
+  panel_return_if_fail (GTK_IS_ENTRY (dialog->search_entry));
+
+  query = panel_item_dialog_search_key (gtk_entry_get_text (GTK_ENTRY (dialog->search_entry)));
+  if (g_strcmp0 (query, dialog->search_query) == 0)
+    {
+      g_free (query);
+      return;
+    }
+
+  /* if the query only grew, rows that are hidden stay hidden */
+  narrow = dialog->search_query != NULL && query != NULL
+           && strstr (query, dialog->search_query) != NULL;
+
+  g_free (dialog->search_query);
+  dialog->search_query = query;
+
+  /* only touch the rows that change, the filter model picks up
+   * the row-changed signals and updates its visible rows */
+  for (valid = gtk_tree_model_get_iter_first (GTK_TREE_MODEL (dialog->store), &iter);
+       valid;
+       valid = gtk_tree_model_iter_next (GTK_TREE_MODEL (dialog->store), &iter))
+    {
+      gtk_tree_model_get (GTK_TREE_MODEL (dialog->store), &iter,
+                          COLUMN_VISIBLE, &was_visible, -1);
+      if (narrow && !was_visible)
+        continue;
+
+      gtk_tree_model_get (GTK_TREE_MODEL (dialog->store), &iter,
+                          COLUMN_SEARCH_KEY, &key, -1);
+      visible = panel_item_dialog_search_matches (key, query);
+      g_free (key);
+
+      if (visible != was_visible)
+        gtk_list_store_set (dialog->store, &iter, COLUMN_VISIBLE, visible, -1);
+    }
+}
+
+
+
+static gboolean
+panel_item_dialog_search_timeout (gpointer user_data)
+{
+  panel_item_dialog_search_update (PANEL_ITEM_DIALOG (user_data));
+
+  return FALSE;
+}
+
+
+
+static void
+panel_item_dialog_search_timeout_destroyed (gpointer user_data)
+{
+  PANEL_ITEM_DIALOG (user_data)->search_timeout_id = 0;
+}
+
+
+
+static void
+panel_item_dialog_search_changed (GtkEntry        *entry,
+                                  PanelItemDialog *dialog)
+{
+  panel_return_if_fail (PANEL_IS_ITEM_DIALOG (dialog));
+
+  /* wait until the user stops typing */
+  if (dialog->search_timeout_id != 0)
+    g_source_remove (dialog->search_timeout_id);
+
+  dialog->search_timeout_id =
+      g_timeout_add_full (G_PRIORITY_DEFAULT, SEARCH_DELAY,
+                          panel_item_dialog_search_timeout, dialog,
+                          panel_item_dialog_search_timeout_destroyed);
+}
+
+
+
 static void
 panel_item_dialog_populate_store (PanelItemDialog *dialog)
 {
@@ -607,6 +760,9 @@ panel_item_dialog_populate_store (PanelItemDialog *dialog)
   gint         n;
   GtkTreeIter  iter;
   PanelModule *module;
+  const gchar *name, *comment;
+  gchar       *text;
+  gchar       *key;
 
   panel_return_if_fail (PANEL_IS_ITEM_DIALOG (dialog));
   panel_return_if_fail (PANEL_IS_MODULE_FACTORY (dialog->factory));
@@ -621,11 +777,23 @@ panel_item_dialog_populate_store (PanelItemDialog *dialog)
     {
       module = PANEL_MODULE (li->data);
 
+      /* normalize the searchable text once */
+      name = panel_module_get_display_name (module);
+      comment = panel_module_get_comment (module);
+      text = g_strconcat (name != NULL ? name : "", "\n",
+                          comment != NULL ? comment : "", NULL);
+      key = panel_item_dialog_search_key (text);
+      g_free (text);
+
       gtk_list_store_insert_with_values (dialog->store, &iter, n,
           COLUMN_MODULE, module,
           COLUMN_ICON_NAME, panel_module_get_icon_name (module),
           COLUMN_SENSITIVE, panel_module_is_usable (module,
-              gtk_widget_get_screen (GTK_WIDGET (dialog))), -1);
+              gtk_widget_get_screen (GTK_WIDGET (dialog))),
+          COLUMN_SEARCH_KEY, key,
+          COLUMN_VISIBLE, panel_item_dialog_search_matches (key, dialog->search_query), -1);
+
+      g_free (key);
     }
 
   g_list_free (modules);
@@ -633,7 +801,8 @@ panel_item_dialog_populate_store (PanelItemDialog *dialog)
   /* add an empty item for separator in 2nd position */
   if (panel_module_factory_has_launcher (dialog->factory))
     gtk_list_store_insert_with_values (dialog->store, &iter, 2,
-                                       COLUMN_MODULE, NULL, -1);
+                                       COLUMN_MODULE, NULL,
+                                       COLUMN_VISIBLE, dialog->search_query == NULL, -1);
 }
 
 
@@ -713,65 +882,10 @@ panel_item_dialog_visible_func (GtkTreeModel *model,
                                 GtkTreeIter  *iter,
                                 gpointer      user_data)
 {
+  gboolean visible;
 
-  GtkEntry    *entry = GTK_ENTRY (user_data);
-  const gchar *text, *name, *comment;
-  PanelModule *module;
-  gchar       *normalized;
-  gchar       *text_casefolded;
-  gchar       *name_casefolded;
-  gchar       *comment_casefolded;
-  gboolean     visible = FALSE;
-
-  /* search string from dialog */
-  text = gtk_entry_get_text (entry);
-  if (G_UNLIKELY (panel_str_is_empty (text)))
-    return TRUE;
-
-  gtk_tree_model_get (model, iter, COLUMN_MODULE, &module, -1);
-
-  /* hide separator when searching */
-  if (G_UNLIKELY (module == NULL))
-    return FALSE;
-
-  /* casefold the search text */
-  normalized = g_utf8_normalize (text, -1, G_NORMALIZE_ALL);
-  text_casefolded = g_utf8_casefold (normalized, -1);
-  g_free (normalized);
-
-  name = panel_module_get_display_name (module);
-  if (G_LIKELY (name != NULL))
-    {
-      /* casefold the name */
-      normalized = g_utf8_normalize (name, -1, G_NORMALIZE_ALL);
-      name_casefolded = g_utf8_casefold (normalized, -1);
-      g_free (normalized);
-
-      /* search */
-      visible = (strstr (name_casefolded, text_casefolded) != NULL);
-
-      g_free (name_casefolded);
-    }
-
-  if (!visible)
-    {
-      comment = panel_module_get_comment (module);
-      if (comment != NULL)
-        {
-          /* casefold the comment */
-          normalized = g_utf8_normalize (comment, -1, G_NORMALIZE_ALL);
-          comment_casefolded = g_utf8_casefold (normalized, -1);
-          g_free (normalized);
-
-          /* search */
-          visible = (strstr (comment_casefolded, text_casefolded) != NULL);
-
-          g_free (comment_casefolded);
-        }
-    }
-
-  g_free (text_casefolded);
-  g_object_unref (G_OBJECT (module));
+  /* matched in panel_item_dialog_search_update() */
+  gtk_tree_model_get (model, iter, COLUMN_VISIBLE, &visible, -1);
 
   return visible;
 }
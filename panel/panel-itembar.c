@@ -27,6 +27,7 @@
 #include <common/panel-private.h>
 #include <libxfce4panel/libxfce4panel.h>
 #include <common/panel-debug.h>
+#include <common/panel-probes.h>
 #include <libxfce4panel/xfce-panel-plugin-provider.h>
 
 #include <panel/panel-itembar.h>
@@ -508,6 +509,8 @@ panel_itembar_size_allocate (GtkWidget     *widget,
     if (G_UNLIKELY ((child_len) < 1)) \
       (child_len) = 1;
 
+  PANEL_PROBE2 (itembar_allocate_start, allocation->width, allocation->height);
+
   /* the maximum allocation is limited by that of the
    * panel window, so take over the assigned allocation */
   gtk_widget_set_allocation (widget, allocation);
@@ -787,6 +790,8 @@ panel_itembar_size_allocate (GtkWidget     *widget,
 
       gtk_widget_size_allocate (child->widget, &child_alloc);
     }
+
+  PANEL_PROBE2 (itembar_allocate_end, allocation->width, allocation->height);
 }
 
 
@@ -26,6 +26,8 @@
 
 #include <common/panel-private.h>
 #include <common/panel-debug.h>
+#include <common/panel-watchdog.h>
+#include <common/panel-probes.h>
 #include <libxfce4panel/libxfce4panel.h>
 #include <libxfce4panel/xfce-panel-plugin-provider.h>
 
@@ -188,6 +190,8 @@ panel_module_load (GTypeModule *type_module)
   panel_return_val_if_fail (module->plugin_type == G_TYPE_NONE, FALSE);
   panel_return_val_if_fail (module->construct_func == NULL, FALSE);
 
+  PANEL_PROBE1 (module_load_start, module->filename);
+
   /* open the module */
   module->library = g_module_open (module->filename, G_MODULE_BIND_LOCAL);
   if (G_UNLIKELY (module->library == NULL))
@@ -195,6 +199,7 @@ panel_module_load (GTypeModule *type_module)
       g_critical ("Failed to load module \"%s\": %s.",
                   module->filename,
                   g_module_error ());
+      PANEL_PROBE2 (module_load_end, module->filename, FALSE);
       return FALSE;
     }
 
@@ -214,6 +219,8 @@ panel_module_load (GTypeModule *type_module)
       g_free (module->api);
       module->api = g_strdup (LIBXFCE4PANEL_VERSION_API);
 
+      PANEL_PROBE2 (module_load_end, module->filename, FALSE);
+
       return FALSE;
     }
 
@@ -235,9 +242,16 @@ panel_module_load (GTypeModule *type_module)
 
       panel_module_unload (type_module);
 
+      PANEL_PROBE2 (module_load_end, module->filename, FALSE);
+
       return FALSE;
     }
 
+  /* blame stalls of the main loop in this library on the plugin */
+  panel_watchdog_add_module (module->filename, panel_module_get_name (module));
+
+  PANEL_PROBE2 (module_load_end, module->filename, TRUE);
+
   return TRUE;
 }
 
@@ -255,6 +269,8 @@ panel_module_unload (GTypeModule *type_module)
   panel_return_if_fail (module->plugin_type != G_TYPE_NONE
                         || module->construct_func != NULL);
 
+  panel_watchdog_remove_module (module->filename);
+
   g_module_close (module->library);
 
   /* reset plugin state */
@@ -38,6 +38,8 @@
 #include <common/panel-private.h>
 #include <common/panel-dbus.h>
 #include <common/panel-debug.h>
+#include <common/panel-probes.h>
+#include <common/panel-watchdog.h>
 
 #include <libxfce4panel/libxfce4panel.h>
 #include <libxfce4panel/xfce-panel-plugin-provider.h>
@@ -75,6 +77,11 @@ static gboolean   panel_plugin_external_wrapper_dbus_remote_event_result (XfcePa
                                                                           guint                           handle,
                                                                           gboolean                        result,
                                                                           PanelPluginExternalWrapper     *wrapper);
+static gboolean   panel_plugin_external_wrapper_dbus_stall_record        (XfcePanelPluginWrapperExported *skeleton,
+                                                                          GDBusMethodInvocation          *invocation,
+                                                                          const gchar                    *name,
+                                                                          gint64                          duration,
+                                                                          PanelPluginExternalWrapper     *wrapper);
 
 
 
@@ -180,6 +187,8 @@ panel_plugin_external_wrapper_constructed (GObject *object)
                             G_CALLBACK (panel_plugin_external_wrapper_dbus_provider_signal), wrapper);
           g_signal_connect (wrapper->skeleton, "handle_remote_event_result",
                             G_CALLBACK (panel_plugin_external_wrapper_dbus_remote_event_result), wrapper);
+          g_signal_connect (wrapper->skeleton, "handle_stall_record",
+                            G_CALLBACK (panel_plugin_external_wrapper_dbus_stall_record), wrapper);
           panel_debug (PANEL_DEBUG_EXTERNAL, "register dbus path %s", path);
 
           wrapper->exported = TRUE;
@@ -386,6 +395,8 @@ panel_plugin_external_wrapper_remote_event (PanelPluginExternal *external,
                                                 *handle),
                                  NULL);
 
+  PANEL_PROBE3 (remote_event_send, external->unique_id, name, *handle);
+
   return TRUE;
 }
 
@@ -432,6 +443,8 @@ panel_plugin_external_wrapper_dbus_remote_event_result (XfcePanelPluginWrapperEx
 {
   panel_return_val_if_fail (PANEL_IS_PLUGIN_EXTERNAL (wrapper), FALSE);
 
+  PANEL_PROBE3 (remote_event_result, PANEL_PLUGIN_EXTERNAL (wrapper)->unique_id, handle, result);
+
   g_signal_emit (G_OBJECT (wrapper), external_signals[REMOTE_EVENT_RESULT], 0,
                  handle, result);
 
@@ -442,6 +455,31 @@ panel_plugin_external_wrapper_dbus_remote_event_result (XfcePanelPluginWrapperEx
 
 
 
+static gboolean
+panel_plugin_external_wrapper_dbus_stall_record (XfcePanelPluginWrapperExported *skeleton,
+                                                 GDBusMethodInvocation          *invocation,
+                                                 const gchar                    *name,
+                                                 gint64                          duration,
+                                                 PanelPluginExternalWrapper     *wrapper)
+{
+  PanelPluginExternal *external = PANEL_PLUGIN_EXTERNAL (wrapper);
+
+  panel_return_val_if_fail (PANEL_IS_PLUGIN_EXTERNAL (wrapper), FALSE);
+
+  panel_debug_filtered (PANEL_DEBUG_WATCHDOG, "%s-%d: wrapper blamed %s for a stall",
+                        panel_module_get_name (external->module), external->unique_id, name);
+
+  /* the wrapper only runs this plugin, so also stalls it could not
+   * attribute to the module are on its account */
+  panel_watchdog_add_stall (panel_module_get_name (external->module), duration);
+
+  xfce_panel_plugin_wrapper_exported_complete_stall_record (skeleton, invocation);
+
+  return TRUE;
+}
+
+
+
 GtkWidget *
 panel_plugin_external_wrapper_new (PanelModule  *module,
                                    gint          unique_id,
@@ -39,6 +39,7 @@
 #include <common/panel-private.h>
 #include <common/panel-dbus.h>
 #include <common/panel-debug.h>
+#include <common/panel-probes.h>
 #include <common/panel-utils.h>
 
 #include <libxfce4panel/libxfce4panel.h>
@@ -467,6 +468,9 @@ panel_plugin_external_plug_added (GtkSocket *socket)
   PanelPluginExternal *external = PANEL_PLUGIN_EXTERNAL (socket);
 
   external->priv->embedded = TRUE;
+
+  PANEL_PROBE2 (plugin_embed, panel_module_get_name (external->module), external->unique_id);
+
   external->priv->resize_timeout_id =
     g_timeout_add_seconds (1, panel_plugin_external_queue_resize_timeout, external);
   global_resize_timeout_id += external->priv->resize_timeout_id;
@@ -706,6 +710,9 @@ panel_plugin_external_child_spawn (PanelPluginExternal *external)
                            panel_plugin_external_child_spawn_child_setup,
                            external, &pid, &error);
 
+  PANEL_PROBE3 (plugin_spawn, panel_module_get_name (external->module),
+                external->unique_id, succeed ? pid : -1);
+
   panel_debug (PANEL_DEBUG_EXTERNAL,
                "%s-%d: child spawned; pid=%d, argc=%d",
                panel_module_get_name (external->module),
@@ -801,6 +808,7 @@ panel_plugin_external_child_watch (GPid     pid,
 {
   PanelPluginExternal *external = PANEL_PLUGIN_EXTERNAL (user_data);
   gboolean             auto_restart = FALSE;
+  gchar               *reason;
 
   panel_return_if_fail (PANEL_IS_PLUGIN_EXTERNAL (external));
   panel_return_if_fail (external->priv->pid == pid);
@@ -809,6 +817,9 @@ panel_plugin_external_child_watch (GPid     pid,
   external->priv->pid = 0;
   external->priv->embedded = FALSE;
 
+  PANEL_PROBE3 (plugin_exit, panel_module_get_name (external->module),
+                external->unique_id, status);
+
   panel_debug (PANEL_DEBUG_EXTERNAL,
                "%s-%d: child exited with status %d",
                panel_module_get_name (external->module),
@@ -858,6 +869,17 @@ panel_plugin_external_child_watch (GPid     pid,
         }
     }
 
+  if (!auto_restart)
+    {
+      /* the history of the wrapper died with it, but the panel side
+       * of the conversation may tell what happened */
+      reason = g_strdup_printf ("%s-%d crashed",
+                                panel_module_get_name (external->module),
+                                external->unique_id);
+      panel_debug_recorder_print (reason);
+      g_free (reason);
+    }
+
   if (gtk_widget_get_realized (GTK_WIDGET (external))
       && (auto_restart || panel_plugin_external_child_ask_restart (external)))
     {
@@ -906,11 +928,17 @@ panel_plugin_external_queue_send_to_child (PanelPluginExternal *external)
 
   if (external->priv->queue != NULL)
     {
+      PANEL_PROBE2 (queue_flush_start, panel_module_get_name (external->module),
+                    external->unique_id);
+
       external->priv->queue = g_slist_reverse (external->priv->queue);
 
       (*PANEL_PLUGIN_EXTERNAL_GET_CLASS (external)->set_properties) (external, external->priv->queue);
 
       panel_plugin_external_queue_free (external);
+
+      PANEL_PROBE2 (queue_flush_end, panel_module_get_name (external->module),
+                    external->unique_id);
     }
 }
 
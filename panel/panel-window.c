@@ -40,6 +40,7 @@
 #include <xfconf/xfconf.h>
 #include <common/panel-private.h>
 #include <common/panel-debug.h>
+#include <common/panel-probes.h>
 #include <common/panel-utils.h>
 #include <libxfce4panel/libxfce4panel.h>
 #include <libxfce4panel/xfce-panel-plugin-provider.h>
@@ -2502,6 +2503,8 @@ panel_window_autohide_timeout (gpointer user_data)
   panel_return_val_if_fail (window->autohide_behavior != AUTOHIDE_BEHAVIOR_NEVER, FALSE);
   panel_return_val_if_fail (window->autohide_block == 0, FALSE);
 
+  PANEL_PROBE2 (autohide_timeout, window->id, window->autohide_state);
+
   /* update the status */
   if (window->autohide_state == AUTOHIDE_POPDOWN
       || window->autohide_state == AUTOHIDE_POPDOWN_SLOW)
@@ -2631,6 +2634,8 @@ panel_window_autohide_queue (PanelWindow   *window,
   if (window->autohide_ease_out_id != 0)
     g_source_remove (window->autohide_ease_out_id);
 
+  PANEL_PROBE3 (autohide_transition, window->id, window->autohide_state, new_state);
+
   /* set new autohide state */
   window->autohide_state = new_state;
 
@@ -61,6 +61,9 @@ static void       actions_plugin_mode_changed        (XfcePanelPlugin       *pan
 static void       actions_plugin_nrows_changed       (XfcePanelPlugin       *panel_plugin,
                                                       guint                  rows);
 static void       actions_plugin_pack                (ActionsPlugin         *plugin);
+static void       actions_plugin_session_proxy_ready (GObject               *source_object,
+                                                      GAsyncResult          *res,
+                                                      gpointer               user_data);
 static GPtrArray *actions_plugin_default_array       (void);
 static void       actions_plugin_menu                (GtkWidget             *button,
                                                       ActionsPlugin         *plugin);
@@ -117,6 +120,15 @@ struct _ActionsPlugin
   GtkWidget      *menu;
   guint           ask_confirmation : 1;
   guint           pack_idle_id;
+
+  /* cached capabilities, so building the menu never blocks */
+  gchar          *probed_path;
+  guint           program_types;
+  guint           session_types;
+  guint           session_pending_types;
+  guint           session_n_calls;
+  GDBusProxy     *session_proxy;
+  GCancellable   *session_cancellable;
 };
 
 typedef enum
@@ -156,6 +168,14 @@ typedef struct
 }
 ActionTimeout;
 
+typedef struct
+{
+  ActionsPlugin *plugin;
+  const gchar   *method;
+  ActionType     type;
+}
+SessionCanCall;
+
 static ActionEntry action_entries[] =
 {
   { ACTION_TYPE_SEPARATOR,
@@ -242,6 +262,20 @@ static ActionEntry action_entries[] =
   }
 };
 
+static const struct
+{
+  const gchar *method;
+  ActionType   type;
+}
+session_can_methods[] =
+{
+  { "CanShutdown", ACTION_TYPE_SHUTDOWN },
+  { "CanRestart", ACTION_TYPE_RESTART },
+  { "CanSuspend", ACTION_TYPE_SUSPEND },
+  { "CanHibernate", ACTION_TYPE_HIBERNATE },
+  { "CanHybridSleep", ACTION_TYPE_HYBRID_SLEEP }
+};
+
 
 
 /* define the plugin */
@@ -443,6 +477,20 @@ actions_plugin_construct (XfcePanelPlugin *panel_plugin)
                          xfce_panel_plugin_get_property_base (panel_plugin),
                          properties, FALSE);
 
+  /* query the session manager in the background, the buttons and
+   * menu are repacked once the answers arrive */
+  plugin->session_cancellable = g_cancellable_new ();
+  g_dbus_proxy_new_for_bus (G_BUS_TYPE_SESSION,
+                            G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES
+                            | G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+                            NULL,
+                            "org.xfce.SessionManager",
+                            "/org/xfce/SessionManager",
+                            "org.xfce.Session.Manager",
+                            plugin->session_cancellable,
+                            actions_plugin_session_proxy_ready,
+                            plugin);
+
   actions_plugin_pack (plugin);
 
   /* set orientation and size */
@@ -460,6 +508,21 @@ actions_plugin_free_data (XfcePanelPlugin *panel_plugin)
   if (plugin->pack_idle_id != 0)
     g_source_remove (plugin->pack_idle_id);
 
+  /* pending calls return cancelled and leave the plugin alone */
+  if (plugin->session_cancellable != NULL)
+    {
+      g_cancellable_cancel (plugin->session_cancellable);
+      g_object_unref (G_OBJECT (plugin->session_cancellable));
+    }
+
+  if (plugin->session_proxy != NULL)
+    {
+      g_signal_handlers_disconnect_by_data (G_OBJECT (plugin->session_proxy), plugin);
+      g_object_unref (G_OBJECT (plugin->session_proxy));
+    }
+
+  g_free (plugin->probed_path);
+
   if (plugin->items != NULL)
     g_ptr_array_unref (plugin->items);
 
@@ -936,45 +999,156 @@ actions_plugin_action_dbus_xfsm (const gchar  *method,
 
 
 
-static gboolean
-actions_plugin_action_dbus_can (GDBusProxy  *proxy,
-                                const gchar *method)
+static void
+actions_plugin_session_types_changed (ActionsPlugin *plugin,
+                                      ActionType     session_types)
 {
-  GVariant *retval;
-  gboolean allowed = FALSE;
-  GError *error = NULL;
+  if (plugin->session_types != session_types)
+    {
+      plugin->session_types = session_types;
+      actions_plugin_pack (plugin);
+    }
+}
+
 
-  retval = g_dbus_proxy_call_sync (proxy, method,
-                                   NULL,
-                                   G_DBUS_CALL_FLAGS_NONE,
-                                   -1,
-                                   NULL,
-                                   &error);
 
+static void
+actions_plugin_session_can_finished (GObject      *source_object,
+                                     GAsyncResult *res,
+                                     gpointer      user_data)
+{
+  SessionCanCall *call = user_data;
+  ActionsPlugin  *plugin = call->plugin;
+  GVariant       *retval;
+  gboolean        allowed = FALSE;
+  GError         *error = NULL;
+
+  retval = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
   if (G_LIKELY (retval))
     {
       g_variant_get (retval, "(b)", &allowed);
       g_variant_unref (retval);
     }
-  else if (error)
+  else if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      /* superseded by a newer probe or the plugin is gone */
+      g_error_free (error);
+      g_slice_free (SessionCanCall, call);
+      return;
+    }
+  else
+    {
+      g_warning ("Calling %s failed %s", call->method, error->message);
+      g_error_free (error);
+    }
+
+  if (allowed)
+    PANEL_SET_FLAG (plugin->session_pending_types, call->type);
+
+  g_slice_free (SessionCanCall, call);
+
+  panel_return_if_fail (plugin->session_n_calls > 0);
+  if (--plugin->session_n_calls == 0)
+    actions_plugin_session_types_changed (plugin, plugin->session_pending_types);
+}
+
+
+
+static void
+actions_plugin_session_probe (ActionsPlugin *plugin)
+{
+  SessionCanCall *call;
+  gchar          *owner;
+  guint           i;
+
+  panel_return_if_fail (G_IS_DBUS_PROXY (plugin->session_proxy));
+
+  /* drop the answers of a probe that is still running */
+  if (plugin->session_cancellable != NULL)
+    {
+      g_cancellable_cancel (plugin->session_cancellable);
+      g_object_unref (G_OBJECT (plugin->session_cancellable));
+    }
+  plugin->session_cancellable = g_cancellable_new ();
+
+  /* when xfce4-session is connected, we can logout */
+  plugin->session_pending_types = ACTION_TYPE_LOGOUT | ACTION_TYPE_LOGOUT_DIALOG;
+  plugin->session_n_calls = 0;
+
+  owner = g_dbus_proxy_get_name_owner (plugin->session_proxy);
+  if (owner == NULL)
+    {
+      actions_plugin_session_types_changed (plugin, plugin->session_pending_types);
+      return;
+    }
+  g_free (owner);
+
+  for (i = 0; i < G_N_ELEMENTS (session_can_methods); i++)
     {
-      g_warning ("Calling %s failed %s", method, error->message);
+      call = g_slice_new0 (SessionCanCall);
+      call->plugin = plugin;
+      call->method = session_can_methods[i].method;
+      call->type = session_can_methods[i].type;
+
+      g_dbus_proxy_call (plugin->session_proxy, call->method,
+                         NULL,
+                         G_DBUS_CALL_FLAGS_NONE,
+                         -1,
+                         plugin->session_cancellable,
+                         actions_plugin_session_can_finished,
+                         call);
+
+      plugin->session_n_calls++;
+    }
+}
+
+
+
+static void
+actions_plugin_session_owner_changed (GDBusProxy    *proxy,
+                                      GParamSpec    *pspec,
+                                      ActionsPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_ACTIONS_PLUGIN (plugin));
+
+  /* xfce4-session restarted or went away, ask again */
+  actions_plugin_session_probe (plugin);
+}
+
+
+
+static void
+actions_plugin_session_proxy_ready (GObject      *source_object,
+                                    GAsyncResult *res,
+                                    gpointer      user_data)
+{
+  ActionsPlugin *plugin = user_data;
+  GDBusProxy    *proxy;
+  GError        *error = NULL;
+
+  proxy = g_dbus_proxy_new_for_bus_finish (res, &error);
+  if (proxy == NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_critical ("Unable to open DBus session bus: %s", error->message);
       g_error_free (error);
+      return;
     }
 
-  return allowed;
+  plugin->session_proxy = proxy;
+  g_signal_connect (G_OBJECT (proxy), "notify::g-name-owner",
+      G_CALLBACK (actions_plugin_session_owner_changed), plugin);
+
+  actions_plugin_session_probe (plugin);
 }
 
 
 
 static ActionType
-actions_plugin_actions_allowed (void)
+actions_plugin_programs_allowed (void)
 {
-  GDBusConnection *conn;
-  ActionType       allow_mask = ACTION_TYPE_SEPARATOR;
-  gchar           *path;
-  GDBusProxy      *proxy;
-  GError          *error = NULL;
+  ActionType  allow_mask = 0;
+  gchar      *path;
 
   /* check for commands we use */
   path = g_find_program_in_path ("dm-tool");
@@ -995,42 +1169,29 @@ actions_plugin_actions_allowed (void)
     PANEL_SET_FLAG (allow_mask, ACTION_TYPE_LOCK_SCREEN);
   g_free (path);
 
-  /* session bus for querying the managers */
-  conn = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
-  if (conn != NULL)
-    {
-      /* xfce4-session */
-      proxy = actions_plugin_action_dbus_proxy_session (conn);
-      if (G_LIKELY (proxy != NULL))
-        {
-          /* when xfce4-session is connected, we can logout */
-          PANEL_SET_FLAG (allow_mask, ACTION_TYPE_LOGOUT | ACTION_TYPE_LOGOUT_DIALOG);
-
-          if (actions_plugin_action_dbus_can (proxy, "CanShutdown"))
-            PANEL_SET_FLAG (allow_mask, ACTION_TYPE_SHUTDOWN);
+  return allow_mask;
+}
 
-          if (actions_plugin_action_dbus_can (proxy, "CanRestart"))
-            PANEL_SET_FLAG (allow_mask, ACTION_TYPE_RESTART);
 
-          if (actions_plugin_action_dbus_can (proxy, "CanSuspend"))
-            PANEL_SET_FLAG (allow_mask, ACTION_TYPE_SUSPEND);
 
-          if (actions_plugin_action_dbus_can (proxy, "CanHibernate"))
-            PANEL_SET_FLAG (allow_mask, ACTION_TYPE_HIBERNATE);
+static ActionType
+actions_plugin_actions_allowed (ActionsPlugin *plugin)
+{
+  const gchar *path;
 
-          if (actions_plugin_action_dbus_can (proxy, "CanHybridSleep"))
-            PANEL_SET_FLAG (allow_mask, ACTION_TYPE_HYBRID_SLEEP);
+  /* only search for the commands again if the PATH changed */
+  path = g_getenv ("PATH");
+  if (path == NULL)
+    path = "";
 
-          g_object_unref (G_OBJECT (proxy));
-        }
-    }
-  else
+  if (g_strcmp0 (path, plugin->probed_path) != 0)
     {
-      g_critical ("Unable to open DBus session bus: %s", error->message);
-      g_error_free (error);
+      g_free (plugin->probed_path);
+      plugin->probed_path = g_strdup (path);
+      plugin->program_types = actions_plugin_programs_allowed ();
     }
 
-  return allow_mask;
+  return ACTION_TYPE_SEPARATOR | plugin->program_types | plugin->session_types;
 }
 
 
@@ -1242,7 +1403,7 @@ actions_plugin_pack_idle (gpointer data)
   if (plugin->items == NULL)
     plugin->items = actions_plugin_default_array ();
 
-  allowed_types = actions_plugin_actions_allowed ();
+  allowed_types = actions_plugin_actions_allowed (plugin);
 
   if (plugin->type == APPEARANCE_TYPE_BUTTONS)
     {
@@ -1471,7 +1632,7 @@ actions_plugin_menu (GtkWidget     *button,
           G_CALLBACK (actions_plugin_menu_deactivate), plugin);
       g_object_add_weak_pointer (G_OBJECT (plugin->menu), (gpointer) &plugin->menu);
 
-      allowed_types = actions_plugin_actions_allowed ();
+      allowed_types = actions_plugin_actions_allowed (plugin);
 
       for (i = 0; i < plugin->items->len; i++)
         {
@@ -30,6 +30,7 @@
 #include <common/panel-utils.h>
 #include <common/panel-private.h>
 #include <common/panel-debug.h>
+#include <common/panel-launch.h>
 
 #include "applicationsmenu.h"
 #include "applicationsmenu-dialog_ui.h"
@@ -71,6 +72,10 @@ struct _ApplicationsMenuPlugin
   gulong           style_updated_id;
   gulong           screen_changed_id;
   gulong           theme_changed_id;
+
+  /* launch started by activating a menu item */
+  PanelLaunch     *launch;
+  gulong           activate_hook_id;
 };
 
 enum
@@ -111,6 +116,10 @@ static gboolean  applications_menu_plugin_remote_event         (XfcePanelPlugin
 static gboolean  applications_menu_plugin_menu                 (GtkWidget              *button,
                                                                 GdkEventButton         *event,
                                                                 ApplicationsMenuPlugin *plugin);
+static gboolean  applications_menu_plugin_menu_item_activate   (GSignalInvocationHint  *ihint,
+                                                                guint                   n_param_values,
+                                                                const GValue           *param_values,
+                                                                gpointer                user_data);
 static void      applications_menu_plugin_menu_selection_done  (GtkMenuShell           *menu,
                                                                 ApplicationsMenuPlugin *plugin);
 static void      applications_menu_plugin_set_garcon_menu      (ApplicationsMenuPlugin *plugin);
@@ -253,6 +262,12 @@ applications_menu_plugin_init (ApplicationsMenuPlugin *plugin)
   g_signal_connect (G_OBJECT (plugin->menu), "selection-done",
       G_CALLBACK (applications_menu_plugin_menu_selection_done), plugin);
 
+  /* garcon-gtk connects the items itself, so watch for activated items
+   * to record the launches started from our menu */
+  plugin->activate_hook_id =
+      g_signal_add_emission_hook (g_signal_lookup ("activate", GTK_TYPE_MENU_ITEM), 0,
+                                  applications_menu_plugin_menu_item_activate, plugin, NULL);
+
   plugin->style_updated_id = g_signal_connect_swapped (G_OBJECT (plugin->button), "style-updated",
                                                        G_CALLBACK (applications_menu_button_theme_changed), plugin);
   plugin->screen_changed_id = g_signal_connect_swapped (G_OBJECT (plugin->button), "screen-changed",
@@ -473,9 +488,22 @@ applications_menu_plugin_free_data (XfcePanelPlugin *panel_plugin)
   ApplicationsMenuPlugin *plugin = XFCE_APPLICATIONS_MENU_PLUGIN (panel_plugin);
   GtkIconTheme           *icon_theme;
 
+  if (plugin->activate_hook_id != 0)
+    {
+      g_signal_remove_emission_hook (g_signal_lookup ("activate", GTK_TYPE_MENU_ITEM),
+                                     plugin->activate_hook_id);
+      plugin->activate_hook_id = 0;
+    }
+
   if (plugin->menu != NULL)
     gtk_widget_destroy (plugin->menu);
 
+  if (plugin->launch != NULL)
+    {
+      panel_launch_cancel (plugin->launch);
+      plugin->launch = NULL;
+    }
+
   if (plugin->style_updated_id != 0)
     {
       g_signal_handler_disconnect (plugin->button, plugin->style_updated_id);
@@ -797,6 +825,45 @@ applications_menu_plugin_remote_event (XfcePanelPlugin *panel_plugin,
 
 
 
+static gboolean
+applications_menu_plugin_menu_item_activate (GSignalInvocationHint *ihint,
+                                             guint                  n_param_values,
+                                             const GValue          *param_values,
+                                             gpointer               user_data)
+{
+  ApplicationsMenuPlugin *plugin = XFCE_APPLICATIONS_MENU_PLUGIN (user_data);
+  GtkWidget              *widget;
+
+  widget = g_value_get_object (param_values);
+
+  /* submenu items only open their menu */
+  if (gtk_menu_item_get_submenu (GTK_MENU_ITEM (widget)) != NULL)
+    return TRUE;
+
+  /* check if the item is (a descendant of) our menu */
+  while (widget != NULL && widget != plugin->menu)
+    {
+      if (GTK_IS_MENU (widget))
+        widget = gtk_menu_get_attach_widget (GTK_MENU (widget));
+      else
+        widget = gtk_widget_get_parent (widget);
+    }
+  if (widget == NULL)
+    return TRUE;
+
+  /* garcon-gtk spawns the item, so we don't know what is started (or if
+   * anything is started at all), this is taken from the startup
+   * notification */
+  if (plugin->launch != NULL)
+    panel_launch_cancel (plugin->launch);
+  plugin->launch = panel_launch_begin (NULL);
+
+  /* keep the hook */
+  return TRUE;
+}
+
+
+
 static void
 applications_menu_plugin_menu_selection_done (GtkMenuShell           *menu,
                                               ApplicationsMenuPlugin *plugin)
@@ -804,6 +871,14 @@ applications_menu_plugin_menu_selection_done (GtkMenuShell           *menu,
   panel_return_if_fail (plugin->button == NULL || GTK_IS_TOGGLE_BUTTON (plugin->button));
   panel_return_if_fail (GTK_IS_MENU (menu));
 
+  /* emitted after the item is activated, or when the menu is dismissed,
+   * in which case no launch was started */
+  if (plugin->launch != NULL)
+    {
+      panel_launch_spawned (plugin->launch, TRUE);
+      plugin->launch = NULL;
+    }
+
   /* button is NULL when we popup the menu under the cursor position */
   if (plugin->button != NULL)
     gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (plugin->button), FALSE);
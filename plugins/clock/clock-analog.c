@@ -87,6 +87,13 @@ struct _XfceClockAnalog
 
   guint               show_seconds : 1;
   ClockTime          *time;
+
+  /* the ticks, rendered once for the current size and color */
+  cairo_surface_t    *face;
+  gint                face_width;
+  gint                face_height;
+  gint                face_scale;
+  GdkRGBA             face_rgba;
 };
 
 
@@ -201,14 +208,63 @@ xfce_clock_analog_get_property (GObject    *object,
 static void
 xfce_clock_analog_finalize (GObject *object)
 {
+  XfceClockAnalog *analog = XFCE_CLOCK_ANALOG (object);
+
   /* stop the timeout */
-  clock_time_timeout_free (XFCE_CLOCK_ANALOG (object)->timeout);
+  clock_time_timeout_free (analog->timeout);
+
+  if (analog->face != NULL)
+    cairo_surface_destroy (analog->face);
 
   (*G_OBJECT_CLASS (xfce_clock_analog_parent_class)->finalize) (object);
 }
 
 
 
+static cairo_surface_t *
+xfce_clock_analog_get_face (XfceClockAnalog *analog,
+                            gint             width,
+                            gint             height,
+                            const GdkRGBA   *rgba)
+{
+  GtkWidget *widget = GTK_WIDGET (analog);
+  cairo_t   *cr;
+  gint       scale_factor;
+  gdouble    xc, yc;
+
+  /* the ticks only change with the size, scale factor or theme color */
+  scale_factor = gtk_widget_get_scale_factor (widget);
+  if (analog->face != NULL
+      && analog->face_width == width
+      && analog->face_height == height
+      && analog->face_scale == scale_factor
+      && gdk_rgba_equal (&analog->face_rgba, rgba))
+    return analog->face;
+
+  if (analog->face != NULL)
+    cairo_surface_destroy (analog->face);
+
+  analog->face = gdk_window_create_similar_surface (gtk_widget_get_window (widget),
+                                                    CAIRO_CONTENT_COLOR_ALPHA,
+                                                    width, height);
+  analog->face_width = width;
+  analog->face_height = height;
+  analog->face_scale = scale_factor;
+  analog->face_rgba = *rgba;
+
+  xc = (width / 2.0);
+  yc = (height / 2.0);
+
+  cr = cairo_create (analog->face);
+  gdk_cairo_set_source_rgba (cr, rgba);
+  xfce_clock_analog_draw_ticks (cr, xc, yc, MIN (xc, yc));
+  cairo_destroy (cr);
+
+  return analog->face;
+}
+
+
+
 static gboolean
 xfce_clock_analog_draw (GtkWidget *widget,
                         cairo_t   *cr)
@@ -237,10 +293,13 @@ xfce_clock_analog_draw (GtkWidget *widget,
   cairo_set_line_width (cr, 1);
   ctx = gtk_widget_get_style_context (widget);
   gtk_style_context_get_color (ctx, gtk_widget_get_state_flags (widget), &fg_rgba);
-  gdk_cairo_set_source_rgba (cr, &fg_rgba);
 
-  /* draw the ticks */
-  xfce_clock_analog_draw_ticks (cr, xc, yc, radius);
+  /* paint the cached ticks */
+  cairo_set_source_surface (cr, xfce_clock_analog_get_face (analog, allocation.width,
+                                                            allocation.height, &fg_rgba), 0, 0);
+  cairo_paint (cr);
+
+  gdk_cairo_set_source_rgba (cr, &fg_rgba);
 
   if (analog->show_seconds)
     {
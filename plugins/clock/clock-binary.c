@@ -86,6 +86,14 @@ struct _XfceClockBinary
   guint     show_grid : 1;
 
   ClockTime *time;
+
+  /* grid and inactive dots, only rendered again when the layout changes */
+  cairo_surface_t *layer;
+  GtkAllocation    layer_area;
+  gint             layer_width;
+  gint             layer_height;
+  gint             layer_scale;
+  GdkRGBA          layer_rgba;
 };
 
 
@@ -202,6 +210,13 @@ xfce_clock_binary_set_property (GObject      *object,
       break;
     }
 
+  /* the grid or dots in the cached layer changed */
+  if (binary->layer != NULL)
+    {
+      cairo_surface_destroy (binary->layer);
+      binary->layer = NULL;
+    }
+
   /* reschedule the timeout and resize */
   clock_time_timeout_set_interval (binary->timeout,
       binary->show_seconds ? CLOCK_INTERVAL_SECOND : CLOCK_INTERVAL_MINUTE);
@@ -266,8 +281,13 @@ xfce_clock_binary_get_property (GObject    *object,
 static void
 xfce_clock_binary_finalize (GObject *object)
 {
+  XfceClockBinary *binary = XFCE_CLOCK_BINARY (object);
+
   /* stop the timeout */
-  clock_time_timeout_free (XFCE_CLOCK_BINARY (object)->timeout);
+  clock_time_timeout_free (binary->timeout);
+
+  if (binary->layer != NULL)
+    cairo_surface_destroy (binary->layer);
 
   (*G_OBJECT_CLASS (xfce_clock_binary_parent_class)->finalize) (object);
 }
@@ -352,6 +372,71 @@ xfce_clock_binary_draw_binary_time (gulong    *table,
 
 
 
+static void
+xfce_clock_binary_draw_layer (XfceClockBinary *binary,
+                              cairo_t         *cr,
+                              GtkAllocation   *alloc,
+                              gint             cols,
+                              gint             rows,
+                              const GdkRGBA   *rgba)
+{
+  gint    col, row;
+  gint    w, h;
+  gdouble x, y;
+  GdkRGBA grid_rgba, inactive_rgba;
+
+  w = alloc->width / cols;
+  h = alloc->height / rows;
+
+  grid_rgba = inactive_rgba = *rgba;
+
+  if (binary->show_grid)
+    {
+      grid_rgba.alpha = 0.4;
+      gdk_cairo_set_source_rgba (cr, &grid_rgba);
+      cairo_set_line_width (cr, 1);
+
+      x = alloc->x - 0.5;
+      y = alloc->y - 0.5;
+
+      for (col = 0; col <= cols; col++)
+        {
+          cairo_move_to (cr, x + col * w, alloc->y - 1);
+          cairo_rel_line_to (cr, 0, alloc->height + 1);
+          cairo_stroke (cr);
+        }
+
+      for (row = 0; row <= rows; row++)
+        {
+          cairo_move_to (cr, alloc->x - 1, y + row * h);
+          cairo_rel_line_to (cr, alloc->width + 1, 0);
+          cairo_stroke (cr);
+        }
+    }
+
+  if (binary->show_inactive)
+    {
+      /* all dots, the active dots are painted over them opaque */
+      inactive_rgba.alpha = 0.2;
+      gdk_cairo_set_source_rgba (cr, &inactive_rgba);
+
+      for (col = 0; col < cols; col++)
+        {
+          for (row = 0; row < rows; row++)
+            {
+              cairo_rectangle (cr,
+                               alloc->x + (cols - 1 - col) * w,
+                               alloc->y + (rows - 1 - row) * h,
+                               w - 1, h - 1);
+
+              cairo_fill (cr);
+            }
+        }
+    }
+}
+
+
+
 static gboolean
 xfce_clock_binary_draw (GtkWidget *widget,
                         cairo_t   *cr)
@@ -359,15 +444,15 @@ xfce_clock_binary_draw (GtkWidget *widget,
   XfceClockBinary  *binary = XFCE_CLOCK_BINARY (widget);
   gint              col, cols;
   gint              row, rows;
-  GtkAllocation     alloc;
-  gdouble           x;
-  gdouble           y;
+  GtkAllocation     alloc, widget_alloc;
   gint              w, h;
   gint              pad_x, pad_y;
   gint              diff;
+  gint              scale_factor;
   GtkStyleContext  *ctx;
   GtkStateFlags     state_flags;
-  GdkRGBA           active_rgba, inactive_rgba, grid_rgba;
+  GdkRGBA           active_rgba;
+  cairo_t          *layer_cr;
   GtkBorder         padding;
   gulong            table = 0;
   GDateTime        *time;
@@ -420,32 +505,41 @@ xfce_clock_binary_draw (GtkWidget *widget,
   h = alloc.height / rows;
 
   gtk_style_context_get_color (ctx, state_flags, &active_rgba);
-  grid_rgba = inactive_rgba = active_rgba;
 
-  if (binary->show_grid)
+  /* render the grid and inactive dots again if the layout changed */
+  scale_factor = gtk_widget_get_scale_factor (widget);
+  gtk_widget_get_allocation (widget, &widget_alloc);
+  if (binary->layer == NULL
+      || binary->layer_width != widget_alloc.width
+      || binary->layer_height != widget_alloc.height
+      || binary->layer_scale != scale_factor
+      || binary->layer_area.x != alloc.x
+      || binary->layer_area.y != alloc.y
+      || binary->layer_area.width != alloc.width
+      || binary->layer_area.height != alloc.height
+      || !gdk_rgba_equal (&binary->layer_rgba, &active_rgba))
     {
-      grid_rgba.alpha = 0.4;
-      gdk_cairo_set_source_rgba (cr, &grid_rgba);
-      cairo_set_line_width (cr, 1);
-
-      x = alloc.x - 0.5;
-      y = alloc.y - 0.5;
-
-      for (col = 0; col <= cols; col++)
-        {
-          cairo_move_to (cr, x + col * w, alloc.y - 1);
-          cairo_rel_line_to (cr, 0, alloc.height + 1);
-          cairo_stroke (cr);
-        }
-
-      for (row = 0; row <= rows; row++)
-        {
-          cairo_move_to (cr, alloc.x - 1, y + row * h);
-          cairo_rel_line_to (cr, alloc.width + 1, 0);
-          cairo_stroke (cr);
-        }
+      if (binary->layer != NULL)
+        cairo_surface_destroy (binary->layer);
+
+      binary->layer = gdk_window_create_similar_surface (gtk_widget_get_window (widget),
+                                                         CAIRO_CONTENT_COLOR_ALPHA,
+                                                         widget_alloc.width,
+                                                         widget_alloc.height);
+      binary->layer_width = widget_alloc.width;
+      binary->layer_height = widget_alloc.height;
+      binary->layer_scale = scale_factor;
+      binary->layer_area = alloc;
+      binary->layer_rgba = active_rgba;
+
+      layer_cr = cairo_create (binary->layer);
+      xfce_clock_binary_draw_layer (binary, layer_cr, &alloc, cols, rows, &active_rgba);
+      cairo_destroy (layer_cr);
     }
 
+  cairo_set_source_surface (cr, binary->layer, 0, 0);
+  cairo_paint (cr);
+
   time = clock_time_get_time (binary->time);
 
   switch (binary->mode)
@@ -463,25 +557,15 @@ xfce_clock_binary_draw (GtkWidget *widget,
 
   g_date_time_unref (time);
 
-  inactive_rgba.alpha = 0.2;
   active_rgba.alpha = 1.0;
+  gdk_cairo_set_source_rgba (cr, &active_rgba);
 
   for (col = 0; col < cols; col++)
     {
       for (row = 0; row < rows; row++)
         {
-          if (table & (1 << (row * cols + col)))
-            {
-              gdk_cairo_set_source_rgba (cr, &active_rgba);
-            }
-          else if (binary->show_inactive)
-            {
-              gdk_cairo_set_source_rgba (cr, &inactive_rgba);
-            }
-          else
-            {
-              continue;
-            }
+          if (!(table & (1 << (row * cols + col))))
+            continue;
 
           /* draw the dot */
           cairo_rectangle (cr,
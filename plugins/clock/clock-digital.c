@@ -41,6 +41,11 @@ static void     xfce_clock_digital_get_property  (GObject               *object,
 static void     xfce_clock_digital_finalize      (GObject               *object);
 static void     xfce_clock_digital_update        (XfceClockDigital      *digital,
                                                   ClockTime             *time);
+static void     xfce_clock_digital_update_label  (GtkWidget             *label,
+                                                  ClockTimeFormat      **parsed,
+                                                  const gchar           *format,
+                                                  const gchar           *font,
+                                                  ClockTime             *time);
 static void     xfce_clock_digital_update_layout (XfceClockDigital      *digital);
 
 
@@ -80,6 +85,10 @@ struct _XfceClockDigital
   gchar *date_font;
   gchar *time_format;
   gchar *time_font;
+
+  /* parsed formats, reset when the format or font changes */
+  ClockTimeFormat *date_parsed;
+  ClockTimeFormat *time_parsed;
 };
 
 
@@ -210,21 +219,29 @@ xfce_clock_digital_set_property (GObject      *object,
     case PROP_DIGITAL_DATE_FONT:
       g_free (digital->date_font);
       digital->date_font = g_value_dup_string (value);
+      clock_time_format_free (digital->date_parsed);
+      digital->date_parsed = NULL;
       break;
 
     case PROP_DIGITAL_DATE_FORMAT:
       g_free (digital->date_format);
       digital->date_format = g_value_dup_string (value);
+      clock_time_format_free (digital->date_parsed);
+      digital->date_parsed = NULL;
       break;
 
     case PROP_DIGITAL_TIME_FONT:
       g_free (digital->time_font);
       digital->time_font = g_value_dup_string (value);
+      clock_time_format_free (digital->time_parsed);
+      digital->time_parsed = NULL;
       break;
 
     case PROP_DIGITAL_TIME_FORMAT:
       g_free (digital->time_format);
       digital->time_format = g_value_dup_string (value);
+      clock_time_format_free (digital->time_parsed);
+      digital->time_parsed = NULL;
       break;
 
     default:
@@ -290,6 +307,9 @@ xfce_clock_digital_finalize (GObject *object)
   /* stop the timeout */
   clock_time_timeout_free (digital->timeout);
 
+  clock_time_format_free (digital->date_parsed);
+  clock_time_format_free (digital->time_parsed);
+
   g_free (digital->date_font);
   g_free (digital->date_format);
   g_free (digital->time_font);
@@ -301,46 +321,64 @@ xfce_clock_digital_finalize (GObject *object)
 
 
 static void
-xfce_clock_digital_update (XfceClockDigital *digital,
-                           ClockTime        *time)
+xfce_clock_digital_update_label (GtkWidget        *label,
+                                 ClockTimeFormat **parsed,
+                                 const gchar      *format,
+                                 const gchar      *font,
+                                 ClockTime        *time)
 {
   PangoAttrList *attr_list;
   PangoAttribute *attr;
   PangoFontDescription *font_desc;
-  gchar *markup, *stripped;
+  const gchar *markup;
+  gchar *stripped;
 
-  panel_return_if_fail (XFCE_CLOCK_IS_DIGITAL (digital));
-  panel_return_if_fail (XFCE_IS_CLOCK_TIME (time));
+  if (*parsed == NULL)
+    *parsed = clock_time_format_new (format);
 
-  /* set time label */
-  markup = clock_time_strdup_strftime (digital->time, digital->time_format);
+  /* leave the label alone if none of the shown fields changed, this
+   * avoids the resize gtk_label_set_text() always queues */
+  if (!clock_time_format_update (*parsed, time))
+    return;
+
+  markup = clock_time_format_get_string (*parsed);
   if (markup != NULL && pango_parse_markup (markup, -1, 0, &attr_list, &stripped, NULL, NULL))
     {
-      font_desc = pango_font_description_from_string (digital->time_font);
+      font_desc = pango_font_description_from_string (font);
       attr = pango_attr_font_desc_new (font_desc);
       pango_attr_list_insert_before (attr_list, attr);
-      gtk_label_set_text (GTK_LABEL (digital->time_label), stripped);
-      gtk_label_set_attributes (GTK_LABEL (digital->time_label), attr_list);
-      pango_font_description_free (font_desc);
-      pango_attr_list_unref (attr_list);
-      g_free (stripped);
-    }
-  g_free (markup);
 
-  /* set date label */
-  markup = clock_time_strdup_strftime (digital->time, digital->date_format);
-  if (markup != NULL && pango_parse_markup (markup, -1, 0, &attr_list, &stripped, NULL, NULL))
-    {
-      font_desc = pango_font_description_from_string (digital->date_font);
-      attr = pango_attr_font_desc_new (font_desc);
+      /* tabular figures keep the width of numeric fields constant, so
+       * a tick does not change the size the label requests */
+      attr = pango_attr_font_features_new ("tnum 1");
       pango_attr_list_insert_before (attr_list, attr);
-      gtk_label_set_text (GTK_LABEL (digital->date_label), stripped);
-      gtk_label_set_attributes (GTK_LABEL (digital->date_label), attr_list);
+
+      gtk_label_set_text (GTK_LABEL (label), stripped);
+      gtk_label_set_attributes (GTK_LABEL (label), attr_list);
       pango_font_description_free (font_desc);
       pango_attr_list_unref (attr_list);
       g_free (stripped);
     }
-  g_free (markup);
+}
+
+
+
+static void
+xfce_clock_digital_update (XfceClockDigital *digital,
+                           ClockTime        *time)
+{
+  panel_return_if_fail (XFCE_CLOCK_IS_DIGITAL (digital));
+  panel_return_if_fail (XFCE_IS_CLOCK_TIME (time));
+
+  /* set time label */
+  xfce_clock_digital_update_label (digital->time_label, &digital->time_parsed,
+                                   digital->time_format, digital->time_font,
+                                   digital->time);
+
+  /* set date label */
+  xfce_clock_digital_update_label (digital->date_label, &digital->date_parsed,
+                                   digital->date_format, digital->date_font,
+                                   digital->time);
 }
 
 
@@ -50,6 +50,13 @@ static void      xfce_clock_lcd_finalize     (GObject           *object);
 static gboolean  xfce_clock_lcd_draw         (GtkWidget         *widget,
                                               cairo_t           *cr);
 static gdouble   xfce_clock_lcd_get_ratio    (XfceClockLcd      *lcd);
+static void      xfce_clock_lcd_draw_layer   (XfceClockLcd      *lcd,
+                                              cairo_t           *cr,
+                                              GDateTime         *time,
+                                              gdouble            size,
+                                              gdouble            offset_x,
+                                              gdouble            offset_y,
+                                              gboolean           dynamic);
 static gdouble   xfce_clock_lcd_draw_dots    (cairo_t           *cr,
                                               gdouble            size,
                                               gdouble            offset_x,
@@ -93,6 +100,14 @@ struct _XfceClockLcd
   guint               flash_separators : 1;
 
   ClockTime          *time;
+
+  /* hours, minutes and meridiem, rendered once per minute */
+  cairo_surface_t    *layer;
+  gint                layer_width;
+  gint                layer_height;
+  gint                layer_scale;
+  gint                layer_minute;
+  GdkRGBA             layer_rgba;
 };
 
 typedef struct
@@ -214,6 +229,13 @@ xfce_clock_lcd_set_property (GObject      *object,
       break;
     }
 
+  /* the layout of the cached layer changed */
+  if (lcd->layer != NULL)
+    {
+      cairo_surface_destroy (lcd->layer);
+      lcd->layer = NULL;
+    }
+
   g_object_notify (object, "size-ratio");
 
   /* reschedule the timeout and resize */
@@ -268,8 +290,13 @@ xfce_clock_lcd_get_property (GObject    *object,
 static void
 xfce_clock_lcd_finalize (GObject *object)
 {
+  XfceClockLcd *lcd = XFCE_CLOCK_LCD (object);
+
   /* stop the timeout */
-  clock_time_timeout_free (XFCE_CLOCK_LCD (object)->timeout);
+  clock_time_timeout_free (lcd->timeout);
+
+  if (lcd->layer != NULL)
+    cairo_surface_destroy (lcd->layer);
 
   (*G_OBJECT_CLASS (xfce_clock_lcd_parent_class)->finalize) (object);
 }
@@ -282,13 +309,16 @@ xfce_clock_lcd_draw (GtkWidget *widget,
 {
   XfceClockLcd *lcd = XFCE_CLOCK_LCD (widget);
   gdouble       offset_x, offset_y;
-  gint          ticks, i;
+  gint          ticks;
+  gint          minute;
+  gint          scale_factor;
   gdouble       size;
   gdouble       ratio;
   GDateTime    *time;
   GtkAllocation allocation;
   GtkStyleContext *ctx;
   GdkRGBA          fg_rgba;
+  cairo_t         *layer_cr;
 
   panel_return_val_if_fail (XFCE_CLOCK_IS_LCD (lcd), FALSE);
   panel_return_val_if_fail (cr != NULL, FALSE);
@@ -300,10 +330,9 @@ xfce_clock_lcd_draw (GtkWidget *widget,
   gtk_widget_get_allocation (widget, &allocation);
   size = MIN ((gdouble) allocation.width / ratio, allocation.height);
 
-  /* set correct color */
+  /* get correct color */
   ctx = gtk_widget_get_style_context (widget);
   gtk_style_context_get_color (ctx, gtk_widget_get_state_flags (widget), &fg_rgba);
-  gdk_cairo_set_source_rgba (cr, &fg_rgba);
 
   /* begin offsets */
   offset_x = rint ((allocation.width - (size * ratio)) / 2.00);
@@ -313,15 +342,9 @@ xfce_clock_lcd_draw (GtkWidget *widget,
   offset_x = MAX (0.00, offset_x);
   offset_y = MAX (0.00, offset_y);
 
-  cairo_push_group (cr);
-
-  /* width of the clear line */
-  cairo_set_line_width (cr, MAX (size * 0.05, 1.5));
-
   /* get the local time */
   time = clock_time_get_time (lcd->time);
 
-  /* draw the hours */
   ticks = g_date_time_get_hour (time);
 
   /* convert 24h clock to 12h clock */
@@ -339,14 +362,90 @@ xfce_clock_lcd_draw (GtkWidget *widget,
       && (!lcd->show_seconds || g_date_time_get_second (time) < 3))
     g_object_notify (G_OBJECT (lcd), "size-ratio");
 
+  /* render the digits that only change once per minute into the
+   * cached layer, if the size, scale, color or minute changed */
+  minute = g_date_time_get_hour (time) * 60 + g_date_time_get_minute (time);
+  scale_factor = gtk_widget_get_scale_factor (widget);
+  if (lcd->layer == NULL
+      || lcd->layer_width != allocation.width
+      || lcd->layer_height != allocation.height
+      || lcd->layer_scale != scale_factor
+      || lcd->layer_minute != minute
+      || !gdk_rgba_equal (&lcd->layer_rgba, &fg_rgba))
+    {
+      if (lcd->layer != NULL)
+        cairo_surface_destroy (lcd->layer);
+
+      lcd->layer = gdk_window_create_similar_surface (gtk_widget_get_window (widget),
+                                                      CAIRO_CONTENT_COLOR_ALPHA,
+                                                      allocation.width,
+                                                      allocation.height);
+      lcd->layer_width = allocation.width;
+      lcd->layer_height = allocation.height;
+      lcd->layer_scale = scale_factor;
+      lcd->layer_minute = minute;
+      lcd->layer_rgba = fg_rgba;
+
+      layer_cr = cairo_create (lcd->layer);
+      gdk_cairo_set_source_rgba (layer_cr, &fg_rgba);
+      cairo_set_line_width (layer_cr, MAX (size * 0.05, 1.5));
+      xfce_clock_lcd_draw_layer (lcd, layer_cr, time, size, offset_x, offset_y, FALSE);
+      cairo_destroy (layer_cr);
+    }
+
+  cairo_push_group (cr);
+
+  cairo_set_source_surface (cr, lcd->layer, 0, 0);
+  cairo_paint (cr);
+
+  /* draw the separators and seconds on top */
+  gdk_cairo_set_source_rgba (cr, &fg_rgba);
+  cairo_set_line_width (cr, MAX (size * 0.05, 1.5));
+  xfce_clock_lcd_draw_layer (lcd, cr, time, size, offset_x, offset_y, TRUE);
+
+  /* drop the pushed group */
+  g_date_time_unref (time);
+  cairo_pop_group_to_source (cr);
+  cairo_paint (cr);
+
+  return FALSE;
+}
+
+
+
+static void
+xfce_clock_lcd_draw_layer (XfceClockLcd *lcd,
+                           cairo_t      *cr,
+                           GDateTime    *time,
+                           gdouble       size,
+                           gdouble       offset_x,
+                           gdouble       offset_y,
+                           gboolean      dynamic)
+{
+  gint    ticks, i;
+  gdouble digit_width = size * (RELATIVE_DIGIT + RELATIVE_SPACE);
+
+  /* draw the hours */
+  ticks = g_date_time_get_hour (time);
+
+  /* convert 24h clock to 12h clock */
+  if (!lcd->show_military && ticks > 12)
+    ticks -= 12;
+
   if (ticks >= 10)
     {
       /* draw the number and increase the offset */
-      offset_x = xfce_clock_lcd_draw_digit (cr, ticks >= 20 ? 2 : 1, size, offset_x, offset_y);
+      if (dynamic)
+        offset_x += digit_width;
+      else
+        offset_x = xfce_clock_lcd_draw_digit (cr, ticks >= 20 ? 2 : 1, size, offset_x, offset_y);
     }
 
   /* draw the other number of the hour and increase the offset */
-  offset_x = xfce_clock_lcd_draw_digit (cr, ticks % 10, size, offset_x, offset_y);
+  if (dynamic)
+    offset_x += digit_width;
+  else
+    offset_x = xfce_clock_lcd_draw_digit (cr, ticks % 10, size, offset_x, offset_y);
 
   for (i = 0; i < 2; i++)
     {
@@ -366,20 +465,29 @@ xfce_clock_lcd_draw (GtkWidget *widget,
           ticks = g_date_time_get_second (time);
         }
 
-      /* draw the dots */
-      if (lcd->flash_separators && (g_date_time_get_second (time) % 2) == 1)
+      /* draw the dots, they flash every second */
+      if (!dynamic
+          || (lcd->flash_separators && (g_date_time_get_second (time) % 2) == 1))
         offset_x += size * RELATIVE_SPACE * 2;
       else
         offset_x = xfce_clock_lcd_draw_dots (cr, size, offset_x, offset_y);
 
-      /* draw the first digit */
-      offset_x = xfce_clock_lcd_draw_digit (cr, (ticks - (ticks % 10)) / 10, size, offset_x, offset_y);
+      /* the seconds are drawn on every update */
+      if (dynamic == (i == 1))
+        {
+          /* draw the first digit */
+          offset_x = xfce_clock_lcd_draw_digit (cr, (ticks - (ticks % 10)) / 10, size, offset_x, offset_y);
 
-      /* draw the second digit */
-      offset_x = xfce_clock_lcd_draw_digit (cr, ticks % 10, size, offset_x, offset_y);
+          /* draw the second digit */
+          offset_x = xfce_clock_lcd_draw_digit (cr, ticks % 10, size, offset_x, offset_y);
+        }
+      else
+        {
+          offset_x += 2 * digit_width;
+        }
     }
 
-  if (lcd->show_meridiem)
+  if (lcd->show_meridiem && !dynamic)
     {
       /* am or pm? */
       ticks = g_date_time_get_hour (time) >= 12 ? 11 : 10;
@@ -387,13 +495,6 @@ xfce_clock_lcd_draw (GtkWidget *widget,
       /* draw the digit */
       xfce_clock_lcd_draw_digit (cr, ticks, size, offset_x, offset_y);
     }
-
-  /* drop the pushed group */
-  g_date_time_unref (time);
-  cairo_pop_group_to_source (cr);
-  cairo_paint (cr);
-
-  return FALSE;
 }
 
 
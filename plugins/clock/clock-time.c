@@ -21,6 +21,20 @@
 #include <config.h>
 #endif
 
+#ifdef HAVE_SYS_TIMERFD_H
+#include <sys/timerfd.h>
+#include <glib-unix.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
 #include <glib.h>
 #include <common/panel-private.h>
 
@@ -66,11 +80,45 @@ struct _ClockTimeTimeout
   guint       timeout_id;
   guint       timeout_counter;
   guint       restart : 1;
+  gint        timer_fd;
   ClockTime  *time;
   guint       time_changed_id;
   ClockSleepMonitor *sleep_monitor;
 };
 
+typedef enum
+{
+  CLOCK_TIME_UNIT_ALWAYS,
+  CLOCK_TIME_UNIT_SECOND,
+  CLOCK_TIME_UNIT_MINUTE,
+  CLOCK_TIME_UNIT_HOUR,
+  CLOCK_TIME_UNIT_DAY,
+  CLOCK_TIME_UNIT_MONTH,
+  CLOCK_TIME_UNIT_YEAR,
+  N_CLOCK_TIME_UNITS
+}
+ClockTimeUnit;
+
+typedef struct
+{
+  /* literal text, or the conversion specification of a field */
+  gchar         *text;
+  guint          is_field : 1;
+
+  /* unit the field depends on and its value at the last render */
+  ClockTimeUnit  unit;
+  gint64         key;
+  gchar         *value;
+}
+ClockTimeSegment;
+
+struct _ClockTimeFormat
+{
+  GArray    *segments;
+  gchar     *string;
+  guint      rendered : 1;
+};
+
 enum
 {
   TIME_CHANGED,
@@ -248,6 +296,292 @@ clock_time_strdup_strftime (ClockTime       *time,
 
 
 
+static ClockTimeUnit
+clock_time_unit_from_conversion (gchar conversion)
+{
+  switch (conversion)
+    {
+    case 'c':
+    case 'r':
+    case 's':
+    case 'S':
+    case 'T':
+    case 'X':
+      return CLOCK_TIME_UNIT_SECOND;
+
+    case 'M':
+    case 'R':
+      return CLOCK_TIME_UNIT_MINUTE;
+
+    case 'H':
+    case 'I':
+    case 'k':
+    case 'l':
+    case 'p':
+    case 'P':
+      return CLOCK_TIME_UNIT_HOUR;
+
+    case 'a':
+    case 'A':
+    case 'd':
+    case 'D':
+    case 'e':
+    case 'F':
+    case 'g':
+    case 'G':
+    case 'j':
+    case 'u':
+    case 'U':
+    case 'V':
+    case 'w':
+    case 'W':
+    case 'x':
+      return CLOCK_TIME_UNIT_DAY;
+
+    case 'b':
+    case 'B':
+    case 'h':
+    case 'm':
+      return CLOCK_TIME_UNIT_MONTH;
+
+    case 'C':
+    case 'y':
+    case 'Y':
+      return CLOCK_TIME_UNIT_YEAR;
+
+    default:
+      /* time zone names, sub-second fields and unknown conversions */
+      return CLOCK_TIME_UNIT_ALWAYS;
+    }
+}
+
+
+
+static void
+clock_time_segment_clear (gpointer data)
+{
+  ClockTimeSegment *segment = data;
+
+  g_free (segment->text);
+  g_free (segment->value);
+}
+
+
+
+static void
+clock_time_format_append (ClockTimeFormat *parsed,
+                          const gchar     *text,
+                          gsize            len,
+                          gboolean         is_field,
+                          ClockTimeUnit    unit)
+{
+  ClockTimeSegment segment = { NULL, };
+
+  segment.text = g_strndup (text, len);
+  segment.is_field = is_field;
+  segment.unit = unit;
+  g_array_append_val (parsed->segments, segment);
+}
+
+
+
+ClockTimeFormat *
+clock_time_format_new (const gchar *format)
+{
+  ClockTimeFormat *parsed;
+  GString         *literal;
+  const gchar     *p, *start;
+  guint            n_colons;
+
+  parsed = g_slice_new0 (ClockTimeFormat);
+  parsed->segments = g_array_new (FALSE, TRUE, sizeof (ClockTimeSegment));
+  g_array_set_clear_func (parsed->segments, clock_time_segment_clear);
+
+  if (format == NULL)
+    return parsed;
+
+  /* split the format in literal text and single conversions, so each
+   * field is only formatted again when the time unit it shows changed */
+  literal = g_string_new (NULL);
+  for (p = format; *p != '\0'; p++)
+    {
+      if (*p != '%')
+        {
+          g_string_append_c (literal, *p);
+          continue;
+        }
+
+      if (p[1] == '%')
+        {
+          g_string_append_c (literal, '%');
+          p++;
+          continue;
+        }
+
+      /* skip the padding and alternative representation modifiers */
+      start = p++;
+      while (*p == '_' || *p == '-' || *p == '0' || *p == 'E' || *p == 'O')
+        p++;
+
+      /* the numeric time zone with colons: %:z, %::z and %:::z */
+      if (p[0] == ':')
+        {
+          n_colons = 0;
+          while (p[n_colons] == ':' && n_colons < 3)
+            n_colons++;
+          if (p[n_colons] == 'z')
+            p += n_colons;
+        }
+
+      /* leave anything we don't understand, including an incomplete
+       * conversion, to g_date_time_format() on the whole format */
+      if (!g_ascii_isalpha (*p))
+        {
+          g_array_set_size (parsed->segments, 0);
+          clock_time_format_append (parsed, format, strlen (format), TRUE,
+                                    CLOCK_TIME_UNIT_ALWAYS);
+          g_string_free (literal, TRUE);
+
+          return parsed;
+        }
+
+      if (literal->len > 0)
+        {
+          clock_time_format_append (parsed, literal->str, literal->len,
+                                    FALSE, CLOCK_TIME_UNIT_ALWAYS);
+          g_string_truncate (literal, 0);
+        }
+
+      clock_time_format_append (parsed, start, p - start + 1, TRUE,
+                                clock_time_unit_from_conversion (*p));
+    }
+
+  if (literal->len > 0)
+    clock_time_format_append (parsed, literal->str, literal->len,
+                              FALSE, CLOCK_TIME_UNIT_ALWAYS);
+  g_string_free (literal, TRUE);
+
+  return parsed;
+}
+
+
+
+gboolean
+clock_time_format_update (ClockTimeFormat *format,
+                          ClockTime       *time)
+{
+  GDateTime        *date_time;
+  ClockTimeSegment *segment;
+  gint64            keys[N_CLOCK_TIME_UNITS];
+  gint64            local;
+  gboolean          changed;
+  gboolean          failed = FALSE;
+  GString          *string;
+  gchar            *value;
+  guint             i;
+
+  panel_return_val_if_fail (format != NULL, FALSE);
+  panel_return_val_if_fail (XFCE_IS_CLOCK_TIME (time), FALSE);
+
+  date_time = clock_time_get_time (time);
+
+  /* the local time truncated to each unit, so a change of the time zone
+   * or a daylight saving transition also invalidates the fields */
+  local = g_date_time_to_unix (date_time)
+          + g_date_time_get_utc_offset (date_time) / G_TIME_SPAN_SECOND;
+  keys[CLOCK_TIME_UNIT_ALWAYS] = 0;
+  keys[CLOCK_TIME_UNIT_SECOND] = local;
+  keys[CLOCK_TIME_UNIT_MINUTE] = local / 60;
+  keys[CLOCK_TIME_UNIT_HOUR] = local / 3600;
+  keys[CLOCK_TIME_UNIT_DAY] = local / 86400;
+  keys[CLOCK_TIME_UNIT_MONTH] = g_date_time_get_year (date_time) * 12
+                                + g_date_time_get_month (date_time);
+  keys[CLOCK_TIME_UNIT_YEAR] = g_date_time_get_year (date_time);
+
+  changed = !format->rendered;
+  for (i = 0; i < format->segments->len; i++)
+    {
+      segment = &g_array_index (format->segments, ClockTimeSegment, i);
+      if (!segment->is_field)
+        continue;
+
+      if (format->rendered
+          && segment->unit != CLOCK_TIME_UNIT_ALWAYS
+          && segment->key == keys[segment->unit])
+        continue;
+
+      segment->key = keys[segment->unit];
+      value = g_date_time_format (date_time, segment->text);
+      if (g_strcmp0 (value, segment->value) != 0)
+        {
+          g_free (segment->value);
+          segment->value = value;
+          changed = TRUE;
+        }
+      else
+        {
+          g_free (value);
+        }
+    }
+
+  g_date_time_unref (date_time);
+  format->rendered = TRUE;
+
+  if (!changed)
+    return FALSE;
+
+  string = g_string_new (NULL);
+  for (i = 0; i < format->segments->len && !failed; i++)
+    {
+      segment = &g_array_index (format->segments, ClockTimeSegment, i);
+      if (!segment->is_field)
+        g_string_append (string, segment->text);
+      else if (segment->value != NULL)
+        g_string_append (string, segment->value);
+      else
+        failed = TRUE;
+    }
+
+  /* same semantics as clock_time_strdup_strftime() */
+  g_free (format->string);
+  if (failed || string->len == 0)
+    {
+      format->string = NULL;
+      g_string_free (string, TRUE);
+    }
+  else
+    {
+      format->string = g_string_free (string, FALSE);
+    }
+
+  return TRUE;
+}
+
+
+
+const gchar *
+clock_time_format_get_string (ClockTimeFormat *format)
+{
+  panel_return_val_if_fail (format != NULL, NULL);
+
+  return format->string;
+}
+
+
+
+void
+clock_time_format_free (ClockTimeFormat *format)
+{
+  if (format == NULL)
+    return;
+
+  g_array_free (format->segments, TRUE);
+  g_free (format->string);
+  g_slice_free (ClockTimeFormat, format);
+}
+
+
+
 guint
 clock_time_interval_from_format (const gchar *format)
 {
@@ -340,6 +674,103 @@ clock_time_timeout_sync (gpointer user_data)
 
 
 
+#ifdef HAVE_SYS_TIMERFD_H
+static gboolean
+clock_time_timeout_timer_fd (gint          fd,
+                             GIOCondition  condition,
+                             gpointer      user_data)
+{
+  ClockTimeTimeout *timeout = user_data;
+  guint64           expirations;
+
+  if (read (fd, &expirations, sizeof (expirations)) < 0)
+    {
+      /* the system time was changed, align the timer again */
+      if (errno == ECANCELED)
+        {
+          g_signal_emit (G_OBJECT (timeout->time), clock_time_signals[TIME_CHANGED], 0);
+          timeout->restart = TRUE;
+          return FALSE;
+        }
+
+      if (errno == EAGAIN || errno == EINTR)
+        return TRUE;
+
+      /* fall back to the normal timeouts */
+      g_warning ("Failed to read from the clock timer: %s", g_strerror (errno));
+      close (timeout->timer_fd);
+      timeout->timer_fd = -1;
+      timeout->restart = TRUE;
+      return FALSE;
+    }
+
+  g_signal_emit (G_OBJECT (timeout->time), clock_time_signals[TIME_CHANGED], 0);
+
+  return TRUE;
+}
+
+
+
+static void
+clock_time_timeout_timer_fd_destroyed (gpointer user_data)
+{
+  ClockTimeTimeout *timeout = user_data;
+
+  timeout->timeout_id = 0;
+
+  if (G_UNLIKELY (timeout->restart))
+    clock_time_timeout_set_interval (timeout, timeout->interval);
+}
+
+
+
+static gboolean
+clock_time_timeout_timer_fd_start (ClockTimeTimeout *timeout)
+{
+  struct itimerspec  spec = { { 0, }, };
+  GDateTime         *time;
+  gint64             now, next;
+  GSource           *source;
+
+  if (timeout->timer_fd == -1)
+    return FALSE;
+
+  /* the next second or minute boundary in the timezone of the clock,
+   * as an absolute time on the realtime clock */
+  time = clock_time_get_time (timeout->time);
+  now = g_date_time_to_unix (time) * G_USEC_PER_SEC + g_date_time_get_microsecond (time);
+  next = now - g_date_time_get_microsecond (time) + (gint64) timeout->interval * G_USEC_PER_SEC;
+  if (timeout->interval == CLOCK_INTERVAL_MINUTE)
+    next -= (gint64) g_date_time_get_second (time) * G_USEC_PER_SEC;
+  g_date_time_unref (time);
+
+  spec.it_value.tv_sec = next / G_USEC_PER_SEC;
+  spec.it_value.tv_nsec = (next % G_USEC_PER_SEC) * 1000;
+  spec.it_interval.tv_sec = timeout->interval;
+
+  /* cancel on set makes the read fail when the system time changes */
+  if (timerfd_settime (timeout->timer_fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+                       &spec, NULL) == -1)
+    {
+      g_warning ("Failed to set the clock timer: %s", g_strerror (errno));
+      close (timeout->timer_fd);
+      timeout->timer_fd = -1;
+      return FALSE;
+    }
+
+  source = g_unix_fd_source_new (timeout->timer_fd, G_IO_IN);
+  g_source_set_priority (source, G_PRIORITY_HIGH);
+  g_source_set_callback (source, (GSourceFunc) (void (*)(void)) clock_time_timeout_timer_fd,
+                         timeout, clock_time_timeout_timer_fd_destroyed);
+  timeout->timeout_id = g_source_attach (source, NULL);
+  g_source_unref (source);
+
+  return TRUE;
+}
+#endif
+
+
+
 ClockTimeTimeout *
 clock_time_timeout_new (guint       interval,
                         ClockTime  *time,
@@ -360,6 +791,16 @@ clock_time_timeout_new (guint       interval,
   timeout->restart = FALSE;
   timeout->time = time;
 
+#ifdef HAVE_SYS_TIMERFD_H
+  /* a timer on the realtime clock wakes up exactly on the second or
+   * minute boundary, and it also notices time changes and resume */
+  timeout->timer_fd = timerfd_create (CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (timeout->timer_fd == -1)
+    g_warning ("Failed to create the clock timer: %s", g_strerror (errno));
+#else
+  timeout->timer_fd = -1;
+#endif
+
   timeout->time_changed_id =
     g_signal_connect_swapped (G_OBJECT (time), "time-changed",
                               c_handler, gobject);
@@ -410,6 +851,11 @@ clock_time_timeout_set_interval (ClockTimeTimeout *timeout,
   if (!restart)
     g_signal_emit (G_OBJECT (timeout->time), clock_time_signals[TIME_CHANGED], 0);
 
+#ifdef HAVE_SYS_TIMERFD_H
+  if (clock_time_timeout_timer_fd_start (timeout))
+    return;
+#endif
+
   time = clock_time_get_time (timeout->time);
   if (interval == CLOCK_INTERVAL_MINUTE)
     {
@@ -474,6 +920,11 @@ clock_time_timeout_free (ClockTimeTimeout *timeout)
   if (G_LIKELY (timeout->timeout_id != 0))
     g_source_remove (timeout->timeout_id);
 
+#ifdef HAVE_SYS_TIMERFD_H
+  if (timeout->timer_fd != -1)
+    close (timeout->timer_fd);
+#endif
+
   g_slice_free (ClockTimeTimeout, timeout);
 }
 
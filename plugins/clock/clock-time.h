@@ -33,6 +33,7 @@ G_BEGIN_DECLS
 typedef struct _ClockTime          ClockTime;
 typedef struct _ClockTimeClass     ClockTimeClass;
 typedef struct _ClockTimeTimeout   ClockTimeTimeout;
+typedef struct _ClockTimeFormat    ClockTimeFormat;
 
 #define XFCE_TYPE_CLOCK_TIME              (clock_time_get_type ())
 #define XFCE_CLOCK_TIME(obj)              (G_TYPE_CHECK_INSTANCE_CAST ((obj), XFCE_TYPE_CLOCK_TIME, ClockTime))
@@ -67,6 +68,15 @@ GDateTime          *clock_time_get_time               (ClockTime           *time
 gchar              *clock_time_strdup_strftime        (ClockTime           *time,
                                                        const gchar         *format);
 
+ClockTimeFormat    *clock_time_format_new             (const gchar         *format);
+
+gboolean            clock_time_format_update          (ClockTimeFormat     *format,
+                                                       ClockTime           *time);
+
+const gchar        *clock_time_format_get_string      (ClockTimeFormat     *format);
+
+void                clock_time_format_free            (ClockTimeFormat     *format);
+
 guint               clock_time_interval_from_format   (const gchar         *format);
 
 G_END_DECLS
@@ -151,6 +151,7 @@ struct _ClockPlugin
   guint               rotate_vertically : 1;
 
   gchar              *tooltip_format;
+  ClockTimeFormat    *tooltip_parsed;
   ClockTimeTimeout   *tooltip_timeout;
 
   GdkSeat            *seat;
@@ -292,6 +293,7 @@ clock_plugin_init (ClockPlugin *plugin)
   plugin->mode = CLOCK_PLUGIN_MODE_DEFAULT;
   plugin->clock = NULL;
   plugin->tooltip_format = g_strdup (DEFAULT_TOOLTIP_FORMAT);
+  plugin->tooltip_parsed = NULL;
   plugin->tooltip_timeout = NULL;
   plugin->command = g_strdup ("");
   plugin->time_config_tool = g_strdup (DEFAULT_TIME_CONFIG_TOOL);
@@ -379,6 +381,8 @@ clock_plugin_set_property (GObject      *object,
     case PROP_TOOLTIP_FORMAT:
       g_free (plugin->tooltip_format);
       plugin->tooltip_format = g_value_dup_string (value);
+      clock_time_format_free (plugin->tooltip_parsed);
+      plugin->tooltip_parsed = NULL;
       break;
 
     case PROP_COMMAND:
@@ -557,6 +561,7 @@ clock_plugin_free_data (XfcePanelPlugin *panel_plugin)
   if (plugin->sleep_monitor != NULL)
     g_object_unref (G_OBJECT (plugin->sleep_monitor));
 
+  clock_time_format_free (plugin->tooltip_parsed);
   g_free (plugin->tooltip_format);
   g_free (plugin->time_config_tool);
   g_free (plugin->command);
@@ -1547,12 +1552,17 @@ static gboolean
 clock_plugin_tooltip (gpointer user_data)
 {
   ClockPlugin *plugin = XFCE_CLOCK_PLUGIN (user_data);
-  gchar       *string;
+
+  if (plugin->tooltip_parsed == NULL)
+    plugin->tooltip_parsed = clock_time_format_new (plugin->tooltip_format);
+
+  /* nothing to do if none of the shown fields changed */
+  if (!clock_time_format_update (plugin->tooltip_parsed, plugin->time))
+    return TRUE;
 
   /* set the tooltip */
-  string = clock_time_strdup_strftime (plugin->time, plugin->tooltip_format);
-  gtk_widget_set_tooltip_markup (GTK_WIDGET (plugin), string);
-  g_free (string);
+  gtk_widget_set_tooltip_markup (GTK_WIDGET (plugin),
+                                 clock_time_format_get_string (plugin->tooltip_parsed));
 
   /* make sure the tooltip is up2date */
   gtk_widget_trigger_tooltip_query (GTK_WIDGET (plugin));
@@ -28,6 +28,7 @@
 #include <common/panel-xfconf.h>
 #include <common/panel-utils.h>
 #include <common/panel-private.h>
+#include <common/panel-launch.h>
 
 #ifdef HAVE_GIO_UNIX
 #include <gio/gdesktopappinfo.h>
@@ -688,10 +689,13 @@ directory_menu_plugin_menu_launch_desktop_file (GtkWidget *mi,
   GIcon               *icon;
   GError              *error = NULL;
   GdkDisplay          *display;
+  PanelLaunch         *launch;
 
   panel_return_if_fail (G_IS_APP_INFO (info));
   panel_return_if_fail (GTK_IS_WIDGET (mi));
 
+  launch = panel_launch_begin (g_app_info_get_id (info));
+
   display = gtk_widget_get_display (mi);
   context = gdk_display_get_app_launch_context (display);
   gdk_app_launch_context_set_screen (context, gtk_widget_get_screen (mi));
@@ -699,9 +703,15 @@ directory_menu_plugin_menu_launch_desktop_file (GtkWidget *mi,
   icon = g_app_info_get_icon (info);
   if (G_LIKELY (icon != NULL))
     gdk_app_launch_context_set_icon (context, icon);
+  panel_launch_set_context (launch, G_APP_LAUNCH_CONTEXT (context));
 
-  if (!g_app_info_launch (info, NULL, G_APP_LAUNCH_CONTEXT (context), &error))
+  if (g_app_info_launch (info, NULL, G_APP_LAUNCH_CONTEXT (context), &error))
+    {
+      panel_launch_spawned (launch, FALSE);
+    }
+  else
     {
+      panel_launch_cancel (launch);
       xfce_dialog_show_error (NULL, error, _("Failed to launch application \"%s\""),
                               g_app_info_get_executable (info));
       g_error_free (error);
@@ -726,15 +736,19 @@ directory_menu_plugin_menu_launch (GtkWidget *mi,
   const gchar         *message;
   gboolean             result;
   GdkDisplay          *display;
+  PanelLaunch         *launch;
 
   panel_return_if_fail (G_IS_FILE (file));
   panel_return_if_fail (GTK_IS_WIDGET (mi));
 
+  launch = panel_launch_begin (NULL);
+
   info = g_file_query_info (file, G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE,
                             G_FILE_QUERY_INFO_NONE, NULL, &error);
   if (G_UNLIKELY (info == NULL))
     {
       message = _("Failed to query content type for \"%s\"");
+      panel_launch_cancel (launch);
       goto err;
     }
 
@@ -744,6 +758,7 @@ directory_menu_plugin_menu_launch (GtkWidget *mi,
   if (G_LIKELY (appinfo == NULL))
     {
       message = _("No default application found for \"%s\"");
+      panel_launch_cancel (launch);
       goto err;
     }
 
@@ -753,16 +768,23 @@ directory_menu_plugin_menu_launch (GtkWidget *mi,
   context = gdk_display_get_app_launch_context (display);
   gdk_app_launch_context_set_screen (context, gtk_widget_get_screen (mi));
   gdk_app_launch_context_set_timestamp (context, gtk_get_current_event_time ());
+  panel_launch_set_context (launch, G_APP_LAUNCH_CONTEXT (context));
 
   result = g_app_info_launch (appinfo, &fake_list, G_APP_LAUNCH_CONTEXT (context), &error);
   g_object_unref (G_OBJECT (context));
-  g_object_unref (G_OBJECT (appinfo));
   if (G_UNLIKELY (!result))
     {
+      g_object_unref (G_OBJECT (appinfo));
       message = _("Failed to launch default application for \"%s\"");
+      panel_launch_cancel (launch);
       goto err;
     }
 
+  /* the default application is what we're launching */
+  panel_launch_set_desktop_id (launch, g_app_info_get_id (appinfo));
+  panel_launch_spawned (launch, FALSE);
+  g_object_unref (G_OBJECT (appinfo));
+
   return;
 
 err:
@@ -789,6 +811,9 @@ directory_menu_plugin_menu_open (GtkWidget   *mi,
   gboolean      result = FALSE;
   gchar        *argv[3];
   gboolean      startup_notify = FALSE;
+  PanelLaunch  *launch;
+
+  launch = panel_launch_begin (NULL);
 
   /* try to work around the exo code and get the direct command */
   rc = xfce_rc_config_open (XFCE_RESOURCE_CONFIG, "xfce4/helpers.rc", TRUE);
@@ -839,6 +864,13 @@ directory_menu_plugin_menu_open (GtkWidget   *mi,
                                gtk_get_current_event_time (),
                                NULL, FALSE, NULL);
           g_free (filename);
+
+          if (result)
+            {
+              panel_launch_set_desktop_id (launch, binaries[i]);
+              panel_launch_spawned (launch, startup_notify);
+              launch = NULL;
+            }
           break;
         }
 
@@ -857,6 +889,10 @@ directory_menu_plugin_menu_open (GtkWidget   *mi,
           _("Failed to execute the preferred application for category \"%s\""), category);
       g_error_free (error);
     }
+
+  /* exo does not tell what it started */
+  if (launch != NULL)
+    panel_launch_cancel (launch);
 }
 
 
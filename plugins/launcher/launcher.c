@@ -35,12 +35,14 @@
 #include <common/panel-private.h>
 #include <common/panel-xfconf.h>
 #include <common/panel-utils.h>
+#include <common/panel-launch.h>
 
 #include "launcher.h"
 #include "launcher-dialog.h"
 
 #define ARROW_BUTTON_SIZE              (12)
 #define MENU_POPUP_DELAY               (225)
+#define FILE_CHANGED_DELAY             (250)
 #define NO_ARROW_INSIDE_BUTTON(plugin) ((plugin)->arrow_position != LAUNCHER_ARROW_INTERNAL \
                                         || LIST_HAS_ONE_OR_NO_ENTRIES ((plugin)->items))
 #define ARROW_INSIDE_BUTTON(plugin)    (!NO_ARROW_INSIDE_BUTTON (plugin))
@@ -168,6 +170,8 @@ static void               launcher_plugin_item_exec_from_clipboard      (GarconM
                                                                          GdkScreen            *screen);
 static GSList            *launcher_plugin_uri_list_extract              (GtkSelectionData     *data);
 static void               launcher_plugin_uri_list_free                 (GSList               *uri_list);
+static gchar             *launcher_plugin_unique_basename               (void);
+static void               launcher_plugin_file_changed_queue            (LauncherPlugin       *plugin);
 
 
 
@@ -203,10 +207,49 @@ struct _LauncherPlugin
 
   GFile             *config_directory;
   GFileMonitor      *config_monitor;
+  GHashTable        *changed_files;
+  guint              file_changed_timeout_id;
+
+  /* asynchronous item loading */
+  GSList            *loads;
+  guint              load_modified : 1;
 
   guint              save_timeout_id;
 };
 
+typedef struct
+{
+  gint        ref_count;
+
+  /* the applications menu pool, loaded by the first worker that
+   * needs it and shared by all items of one load */
+  GMutex      lock;
+  GHashTable *items;
+}
+LauncherPluginPool;
+
+typedef struct
+{
+  /* empty item shown in the list until the file is loaded, the load
+   * is cancelled when the item is removed from the list */
+  GarconMenuItem     *placeholder;
+  GCancellable       *cancellable;
+
+  /* file to load and the name of the duplicate in the config
+   * directory for files outside the config directory */
+  GFile              *file;
+  GFile              *config_directory;
+  gchar              *dst_name;
+
+  /* the configured string, if it might be a global desktop id */
+  gchar              *desktop_id;
+  LauncherPluginPool *pool;
+
+  guint               location_changed : 1;
+  guint               pool_lookup : 1;
+}
+LauncherPluginItemLoad;
+
 enum
 {
   PROP_0,
@@ -231,6 +274,9 @@ XFCE_PANEL_DEFINE_PLUGIN_RESIDENT (LauncherPlugin, launcher_plugin)
 
 /* quark to attach the plugin to menu items */
 static GQuark      launcher_plugin_quark = 0;
+
+/* quark to cache the desktop id launches are recorded with */
+static GQuark      launcher_plugin_launch_id_quark = 0;
 static guint       launcher_signals[LAST_SIGNAL];
 
 
@@ -311,8 +357,9 @@ launcher_plugin_class_init (LauncherPluginClass *klass)
                   g_cclosure_marshal_VOID__VOID,
                   G_TYPE_NONE, 0);
 
-  /* initialize the quark */
+  /* initialize the quarks */
   launcher_plugin_quark = g_quark_from_static_string ("xfce-launcher-plugin");
+  launcher_plugin_launch_id_quark = g_quark_from_static_string ("xfce-launcher-launch-id");
 }
 
 
@@ -336,6 +383,10 @@ launcher_plugin_init (LauncherPlugin *plugin)
   plugin->icon_name = NULL;
   plugin->menu_timeout_id = 0;
   plugin->save_timeout_id = 0;
+  plugin->loads = NULL;
+  plugin->changed_files = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+                                                 g_object_unref, NULL);
+  plugin->file_changed_timeout_id = 0;
 
   /* create the panel widgets */
   plugin->box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
@@ -554,105 +605,29 @@ err1:
 }
 
 
+
 static GarconMenuItem *
-launcher_plugin_item_load (LauncherPlugin *plugin,
-                           const gchar    *str,
-                           gboolean       *desktop_id_return,
-                           gboolean       *location_changed)
+launcher_plugin_item_steal (LauncherPlugin *plugin,
+                            GFile          *file)
 {
-  GFile          *src_file, *dst_file;
-  gchar          *src_path, *dst_path;
-  GSList         *li, *lnext;
+  GSList         *li;
+  GFile          *item_file;
   GarconMenuItem *item = NULL;
-  GError         *error = NULL;
 
-  panel_return_val_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin), NULL);
-  panel_return_val_if_fail (str != NULL, NULL);
-  panel_return_val_if_fail (G_IS_FILE (plugin->config_directory), NULL);
-
-  if (G_UNLIKELY (g_path_is_absolute (str) || g_uri_is_valid (str, G_URI_FLAGS_NONE, NULL)))
+  /* remove the item pointing to file from the list and return it */
+  for (li = plugin->items; li != NULL; li = li->next)
     {
-      src_file = g_file_new_for_commandline_arg (str);
-      if (g_file_has_prefix (src_file, plugin->config_directory))
-        {
-          /* nothing, we use the file below */
-        }
-      else if (g_file_query_exists (src_file, NULL))
-        {
-          /* create a unique file in the config directory */
-          dst_path = launcher_plugin_unique_filename (plugin);
-          dst_file = g_file_new_for_path (dst_path);
-
-          /* create a duplicate in the config directory */
-          if (launcher_plugin_item_duplicate (src_file, dst_file, &error))
-            {
-              /* use the new file */
-              g_object_unref (G_OBJECT (src_file));
-              src_file = dst_file;
-
-              if (G_LIKELY (location_changed != NULL))
-                *location_changed = TRUE;
-            }
-          else
-            {
-              src_path = g_file_get_parse_name (src_file);
-              g_warning ("Failed to create duplicate of desktop file \"%s\" "
-                          "to \"%s\": %s", src_path, dst_path, error->message);
-              g_error_free (error);
-              g_free (src_path);
-
-              /* continue using the source file, the user won't be able to
-               * edit the item, but atleast we have something that works in
-               * the panel */
-              g_object_unref (G_OBJECT (dst_file));
-            }
-
-          g_free (dst_path);
-        }
-      else
-        {
-          /* nothing we can do with this file */
-          src_path = g_file_get_parse_name (src_file);
-          g_warning ("Failed to load desktop file \"%s\". It will be removed "
-                     "from the configuration", src_path);
-          g_free (src_path);
-          g_object_unref (G_OBJECT (src_file));
-
-          return NULL;
-        }
-    }
-  else
-    {
-      /* assume the file is a child in the config directory */
-      src_file = g_file_get_child (plugin->config_directory, str);
-
-      /* str might also be a global desktop id */
-      if (G_LIKELY (desktop_id_return != NULL))
-        *desktop_id_return = TRUE;
-    }
-
-  panel_assert (G_IS_FILE (src_file));
-
-  /* maybe we have this file in the launcher configuration, then we don't
-   * have to load it again from the harddisk */
-  for (li = plugin->items; item == NULL && li != NULL; li = lnext)
-    {
-      lnext = li->next;
-      dst_file = garcon_menu_item_get_file (GARCON_MENU_ITEM (li->data));
-      if (g_file_equal (src_file, dst_file))
+      item_file = garcon_menu_item_get_file (GARCON_MENU_ITEM (li->data));
+      if (g_file_equal (file, item_file))
         {
           item = GARCON_MENU_ITEM (li->data);
           plugin->items = g_slist_delete_link (plugin->items, li);
+          g_object_unref (G_OBJECT (item_file));
+          break;
         }
-      g_object_unref (G_OBJECT (dst_file));
+      g_object_unref (G_OBJECT (item_file));
     }
 
-  /* load the file from the disk */
-  if (item == NULL)
-    item = garcon_menu_item_new (src_file);
-
-  g_object_unref (G_OBJECT (src_file));
-
   return item;
 }
 
@@ -701,21 +676,345 @@ launcher_plugin_items_free (LauncherPlugin *plugin)
 
 
 
+static LauncherPluginPool *
+launcher_plugin_pool_ref (LauncherPluginPool *pool)
+{
+  if (pool == NULL)
+    {
+      pool = g_slice_new0 (LauncherPluginPool);
+      g_mutex_init (&pool->lock);
+    }
+
+  g_atomic_int_inc (&pool->ref_count);
+
+  return pool;
+}
+
+
+
+static void
+launcher_plugin_pool_unref (LauncherPluginPool *pool)
+{
+  if (g_atomic_int_dec_and_test (&pool->ref_count))
+    {
+      if (pool->items != NULL)
+        g_hash_table_destroy (pool->items);
+      g_mutex_clear (&pool->lock);
+      g_slice_free (LauncherPluginPool, pool);
+    }
+}
+
+
+
+static GarconMenuItem *
+launcher_plugin_pool_lookup (LauncherPluginPool *pool,
+                             const gchar        *desktop_id)
+{
+  GarconMenuItem *item;
+
+  g_mutex_lock (&pool->lock);
+
+  /* the other workers wait until the pool is loaded */
+  if (pool->items == NULL)
+    pool->items = launcher_plugin_garcon_menu_pool ();
+
+  item = g_hash_table_lookup (pool->items, desktop_id);
+  if (item != NULL)
+    g_object_ref (G_OBJECT (item));
+
+  g_mutex_unlock (&pool->lock);
+
+  return item;
+}
+
+
+
+static void
+launcher_plugin_item_load_free (gpointer data)
+{
+  LauncherPluginItemLoad *load = data;
+
+  g_object_unref (G_OBJECT (load->placeholder));
+  g_object_unref (G_OBJECT (load->cancellable));
+  g_object_unref (G_OBJECT (load->file));
+  g_object_unref (G_OBJECT (load->config_directory));
+  g_free (load->dst_name);
+  g_free (load->desktop_id);
+  if (load->pool != NULL)
+    launcher_plugin_pool_unref (load->pool);
+  g_slice_free (LauncherPluginItemLoad, load);
+}
+
+
+
+static void
+launcher_plugin_item_load_warning (GFile *file)
+{
+  gchar *path;
+
+  path = g_file_get_parse_name (file);
+  g_warning ("Failed to load desktop file \"%s\". It will be removed "
+             "from the configuration", path);
+  g_free (path);
+}
+
+
+
+static void
+launcher_plugin_item_load_thread (GTask        *task,
+                                  gpointer      source_object,
+                                  gpointer      task_data,
+                                  GCancellable *cancellable)
+{
+  LauncherPluginItemLoad *load = task_data;
+  GarconMenuItem         *pool_item = NULL;
+  GarconMenuItem         *item;
+  GFile                  *src_file;
+  GFile                  *dst_file;
+  gchar                  *src_path;
+  gchar                  *dst_path;
+  GError                 *error = NULL;
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  /* this runs in a worker thread, so only touch the load data here */
+  src_file = g_object_ref (G_OBJECT (load->file));
+  if (load->desktop_id != NULL
+      && !g_file_query_exists (src_file, cancellable))
+    {
+      /* we are going to load an desktop_id from the item pool,
+       * even if this failes, save the new item list, so we don't
+       * try this again in the future */
+      load->pool_lookup = TRUE;
+
+      pool_item = launcher_plugin_pool_lookup (load->pool, load->desktop_id);
+      if (pool_item == NULL)
+        {
+          launcher_plugin_item_load_warning (src_file);
+          g_object_unref (G_OBJECT (src_file));
+          g_task_return_pointer (task, NULL, NULL);
+          return;
+        }
+
+      /* we want an editable file, so try to make a copy */
+      g_object_unref (G_OBJECT (src_file));
+      src_file = garcon_menu_item_get_file (pool_item);
+    }
+
+  if (load->dst_name != NULL
+      && !g_file_has_prefix (src_file, load->config_directory))
+    {
+      if (!g_file_query_exists (src_file, cancellable))
+        {
+          /* nothing we can do with this file */
+          launcher_plugin_item_load_warning (src_file);
+          g_object_unref (G_OBJECT (src_file));
+          if (pool_item != NULL)
+            g_object_unref (G_OBJECT (pool_item));
+          g_task_return_pointer (task, NULL, NULL);
+          return;
+        }
+
+      /* do not write a duplicate for an item that is already removed */
+      if (g_task_return_error_if_cancelled (task))
+        {
+          g_object_unref (G_OBJECT (src_file));
+          if (pool_item != NULL)
+            g_object_unref (G_OBJECT (pool_item));
+          return;
+        }
+
+      /* create a duplicate in the config directory */
+      dst_file = g_file_get_child (load->config_directory, load->dst_name);
+      if (!g_file_make_directory_with_parents (load->config_directory, NULL, &error)
+          && g_error_matches (error, G_IO_ERROR, G_IO_ERROR_EXISTS))
+        g_clear_error (&error);
+
+      if (error == NULL
+          && launcher_plugin_item_duplicate (src_file, dst_file, &error))
+        {
+          /* use the new file */
+          g_object_unref (G_OBJECT (src_file));
+          src_file = dst_file;
+          load->location_changed = TRUE;
+        }
+      else
+        {
+          src_path = g_file_get_parse_name (src_file);
+          dst_path = g_file_get_parse_name (dst_file);
+          g_warning ("Failed to create duplicate of desktop file \"%s\" "
+                      "to \"%s\": %s", src_path, dst_path, error->message);
+          g_error_free (error);
+          g_free (src_path);
+          g_free (dst_path);
+
+          /* continue using the source file, the user won't be able to
+           * edit the item, but atleast we have something that works in
+           * the panel */
+          g_object_unref (G_OBJECT (dst_file));
+        }
+    }
+
+  g_object_unref (G_OBJECT (load->file));
+  load->file = src_file;
+
+  item = garcon_menu_item_new (load->file);
+  if (pool_item != NULL)
+    {
+      /* if something failed, use the pool item, but this one
+       * won't be editable in the dialog */
+      if (G_UNLIKELY (item == NULL))
+        item = GARCON_MENU_ITEM (g_object_ref (G_OBJECT (pool_item)));
+      g_object_unref (G_OBJECT (pool_item));
+    }
+  else if (G_UNLIKELY (item == NULL))
+    {
+      launcher_plugin_item_load_warning (load->file);
+    }
+
+  g_task_return_pointer (task, item, g_object_unref);
+}
+
+
+
+static void
+launcher_plugin_item_load_orphan (LauncherPluginItemLoad *load)
+{
+  /* the item is not used, so remove the duplicate we created */
+  if (load->location_changed)
+    g_file_delete_async (load->file, G_PRIORITY_DEFAULT, NULL, NULL, NULL);
+}
+
+
+
+static void
+launcher_plugin_item_load_ready (GObject      *source_object,
+                                 GAsyncResult *result,
+                                 gpointer      user_data)
+{
+  LauncherPlugin         *plugin = XFCE_LAUNCHER_PLUGIN (source_object);
+  LauncherPluginItemLoad *load = g_task_get_task_data (G_TASK (result));
+  GarconMenuItem         *item;
+  GSList                 *li;
+  gboolean                first;
+
+  panel_return_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin));
+
+  /* item is NULL if the load was cancelled */
+  item = g_task_propagate_pointer (G_TASK (result), NULL);
+
+  /* the load is not in the list if the plugin is being destroyed */
+  li = g_slist_find (plugin->loads, load);
+  if (G_UNLIKELY (li == NULL))
+    {
+      launcher_plugin_item_load_orphan (load);
+      if (item != NULL)
+        g_object_unref (G_OBJECT (item));
+      return;
+    }
+  plugin->loads = g_slist_delete_link (plugin->loads, li);
+
+  /* check if the placeholder is still in the list, the items might
+   * have been replaced while the file was loading */
+  li = g_slist_find (plugin->items, load->placeholder);
+  if (G_LIKELY (li != NULL))
+    {
+      if (load->pool_lookup || load->location_changed)
+        plugin->load_modified = TRUE;
+
+      first = (li == plugin->items);
+
+      /* replace the placeholder, the task data keeps the other reference */
+      g_object_unref (G_OBJECT (load->placeholder));
+      if (G_LIKELY (item != NULL))
+        {
+          panel_assert (GARCON_IS_MENU_ITEM (item));
+          li->data = item;
+          g_signal_connect (G_OBJECT (item), "changed",
+              G_CALLBACK (launcher_plugin_item_changed), plugin);
+        }
+      else
+        {
+          plugin->items = g_slist_delete_link (plugin->items, li);
+        }
+
+      /* update the button or destroy the menu */
+      launcher_plugin_menu_destroy (plugin);
+      if (first)
+        {
+          launcher_plugin_button_update (plugin);
+          launcher_plugin_button_update_action_menu (plugin);
+        }
+
+      /* the number of items changed, update the arrow and size */
+      if (G_UNLIKELY (item == NULL))
+        {
+          launcher_plugin_arrow_visibility (plugin);
+          launcher_plugin_pack_widgets (plugin);
+          launcher_plugin_size_changed (XFCE_PANEL_PLUGIN (plugin),
+              xfce_panel_plugin_get_size (XFCE_PANEL_PLUGIN (plugin)));
+        }
+    }
+  else
+    {
+      launcher_plugin_item_load_orphan (load);
+      if (item != NULL)
+        g_object_unref (G_OBJECT (item));
+    }
+
+  /* all items are loaded */
+  if (plugin->loads == NULL)
+    {
+      /* store the new item list */
+      if (plugin->load_modified)
+        {
+          plugin->load_modified = FALSE;
+          launcher_plugin_save_delayed (plugin);
+        }
+
+      /* update the dialog */
+      g_signal_emit (G_OBJECT (plugin), launcher_signals[ITEMS_CHANGED], 0);
+
+      /* handle the file changes that were queued while loading */
+      if (g_hash_table_size (plugin->changed_files) > 0)
+        launcher_plugin_file_changed_queue (plugin);
+    }
+}
+
+
+
+static void
+launcher_plugin_items_cancel_loads (LauncherPlugin *plugin)
+{
+  GSList                 *li;
+  LauncherPluginItemLoad *load;
+
+  /* stop loading items that are no longer in the list */
+  for (li = plugin->loads; li != NULL; li = li->next)
+    {
+      load = li->data;
+      if (g_slist_find (plugin->items, load->placeholder) == NULL)
+        g_cancellable_cancel (load->cancellable);
+    }
+}
+
+
+
 static void
 launcher_plugin_items_load (LauncherPlugin *plugin,
                             GPtrArray      *array)
 {
-  guint           i;
-  const GValue   *value;
-  const gchar    *str;
-  GarconMenuItem *item;
-  GarconMenuItem *pool_item;
-  GSList         *items = NULL;
-  GHashTable     *pool = NULL;
-  gboolean        desktop_id;
-  gchar          *uri;
-  gboolean        items_modified = FALSE;
-  gboolean        location_changed;
+  guint                   i;
+  const GValue           *value;
+  const gchar            *str;
+  GarconMenuItem         *item;
+  GSList                 *items = NULL;
+  GFile                  *file;
+  const gchar            *desktop_id;
+  LauncherPluginItemLoad *load;
+  LauncherPluginPool     *pool = NULL;
+  GTask                  *task;
 
   panel_return_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin));
   panel_return_if_fail (array != NULL);
@@ -730,70 +1029,69 @@ launcher_plugin_items_load (LauncherPlugin *plugin,
       if (str == NULL || !g_str_has_suffix (str, ".desktop"))
         continue;
 
-      /* try to load the item */
-      desktop_id = FALSE;
-      location_changed = FALSE;
-      item = launcher_plugin_item_load (plugin, str, &desktop_id, &location_changed);
-      if (G_LIKELY (item == NULL))
+      /* resolve the file, without touching the disk */
+      desktop_id = NULL;
+      if (G_UNLIKELY (g_path_is_absolute (str) || g_uri_is_valid (str, G_URI_FLAGS_NONE, NULL)))
         {
-          /* str did not look like a desktop-id, so no need to look
-           * for it in the application pool */
-          if (!desktop_id)
-            continue;
+          file = g_file_new_for_commandline_arg (str);
+        }
+      else
+        {
+          /* assume the file is a child in the config directory, str
+           * might also be a global desktop id */
+          file = g_file_get_child (plugin->config_directory, str);
+          desktop_id = str;
+        }
 
-          /* we are going to load an desktop_id from the item pool,
-           * even if this failes, save the new item list, so we don't
-           * try this again in the future */
-          items_modified = TRUE;
+      /* maybe we have this file in the launcher configuration, then we don't
+       * have to load it again from the harddisk */
+      item = launcher_plugin_item_steal (plugin, file);
+      if (item != NULL)
+        {
+          g_object_unref (G_OBJECT (file));
+          g_signal_connect (G_OBJECT (item), "changed",
+              G_CALLBACK (launcher_plugin_item_changed), plugin);
+          items = g_slist_prepend (items, item);
+          continue;
+        }
 
-          /* load the pool with desktop items */
-          if (pool == NULL)
-            pool = launcher_plugin_garcon_menu_pool ();
+      /* add an empty item to the list and load the file in a worker
+       * thread, so the plugin is shown before all files are read */
+      load = g_slice_new0 (LauncherPluginItemLoad);
+      load->placeholder = g_object_new (GARCON_TYPE_MENU_ITEM, "file", file, NULL);
+      load->cancellable = g_cancellable_new ();
+      load->file = file;
+      load->config_directory = g_object_ref (G_OBJECT (plugin->config_directory));
+      load->desktop_id = g_strdup (desktop_id);
 
-          /* lookup the item in the item pool */
-          pool_item = g_hash_table_lookup (pool, str);
-          if (pool_item != NULL)
-            {
-              /* we want an editable file, so try to make a copy */
-              uri = garcon_menu_item_get_uri (pool_item);
-              item = launcher_plugin_item_load (plugin, uri, NULL, NULL);
-              g_free (uri);
-
-              /* if something failed, use the pool item, but this one
-               * won't be editable in the dialog */
-              if (G_UNLIKELY (item == NULL))
-                item = GARCON_MENU_ITEM (g_object_ref (G_OBJECT (pool_item)));
-            }
+      /* desktop ids are looked up in the applications menu, shared by
+       * all the items of this load */
+      if (desktop_id != NULL)
+        load->pool = pool = launcher_plugin_pool_ref (pool);
 
-          /* skip this item if still not found */
-          if (item == NULL)
-            continue;
-        }
-      else if (location_changed)
-        {
-          items_modified = TRUE;
-        }
+      /* files outside the config directory are copied by the worker,
+       * the unique name is picked here, this is not thread-safe */
+      if (desktop_id != NULL || !g_file_has_prefix (file, plugin->config_directory))
+        load->dst_name = launcher_plugin_unique_basename ();
 
-      /* add the item to the list */
-      panel_assert (GARCON_IS_MENU_ITEM (item));
-      items = g_slist_append (items, item);
-      g_signal_connect (G_OBJECT (item), "changed",
-          G_CALLBACK (launcher_plugin_item_changed), plugin);
-    }
+      items = g_slist_prepend (items, g_object_ref (G_OBJECT (load->placeholder)));
+      plugin->loads = g_slist_prepend (plugin->loads, load);
 
-  if (G_UNLIKELY (pool != NULL))
-    g_hash_table_destroy (pool);
+      task = g_task_new (plugin, load->cancellable,
+                         launcher_plugin_item_load_ready, NULL);
+      g_task_set_task_data (task, load, launcher_plugin_item_load_free);
+      g_task_run_in_thread (task, launcher_plugin_item_load_thread);
+      g_object_unref (G_OBJECT (task));
+    }
 
   /* remove config files of items not in the new config */
   launcher_plugin_items_delete_configs (plugin);
 
   /* release the old menu items and set new one */
   launcher_plugin_items_free (plugin);
-  plugin->items = items;
+  plugin->items = g_slist_reverse (items);
 
-  /* store the new item list */
-  if (items_modified)
-    launcher_plugin_save_delayed (plugin);
+  launcher_plugin_items_cancel_loads (plugin);
 }
 
 
@@ -825,6 +1123,7 @@ launcher_plugin_set_property (GObject      *object,
         {
           launcher_plugin_items_delete_configs (plugin);
           launcher_plugin_items_free (plugin);
+          launcher_plugin_items_cancel_loads (plugin);
         }
 
       /* emit signal */
@@ -894,57 +1193,55 @@ update_arrow:
 
 
 static void
-launcher_plugin_file_changed (GFileMonitor      *monitor,
-                              GFile             *changed_file,
-                              GFile             *other_file,
-                              GFileMonitorEvent  event_type,
-                              LauncherPlugin    *plugin)
+launcher_plugin_file_changed_timeout_destroyed (gpointer user_data)
 {
+  XFCE_LAUNCHER_PLUGIN (user_data)->file_changed_timeout_id = 0;
+}
+
+
+
+static gboolean
+launcher_plugin_file_changed_timeout (gpointer user_data)
+{
+  LauncherPlugin *plugin = XFCE_LAUNCHER_PLUGIN (user_data);
   GSList         *li, *lnext;
   GarconMenuItem *item;
   GFile          *item_file;
-  gboolean        found;
+  GFile          *changed_file;
+  GHashTableIter  iter;
   GError         *error = NULL;
-  gchar          *base_name;
-  gboolean        result;
-  gboolean        exists;
+  gboolean        update_button = FALSE;
+  gboolean        update_menu = FALSE;
   gboolean        update_plugin = FALSE;
 
-  panel_return_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin));
-  panel_return_if_fail (plugin->config_monitor == monitor);
-
-  /* waited until all events are proccessed */
-  if (event_type != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT
-      && event_type != G_FILE_MONITOR_EVENT_DELETED
-      && event_type != G_FILE_MONITOR_EVENT_CREATED)
-    return;
-
-  /* we only act on desktop files */
-  base_name = g_file_get_basename (changed_file);
-  result = g_str_has_suffix (base_name, ".desktop");
-  g_free (base_name);
-  if (!result)
-    return;
-
-  exists = g_file_query_exists (changed_file, NULL);
+  panel_return_val_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin), FALSE);
 
-  /* lookup the file in the menu items */
-  for (li = plugin->items, found = FALSE; !found && li != NULL; li = lnext)
+  /* lookup the changed files in the menu items, the files that are
+   * found are removed from the table, the rest are new files */
+  for (li = plugin->items; li != NULL; li = lnext)
     {
       lnext = li->next;
       item = GARCON_MENU_ITEM (li->data);
       item_file = garcon_menu_item_get_file (item);
-      found = g_file_equal (changed_file, item_file);
-      if (found)
+      if (g_hash_table_remove (plugin->changed_files, item_file))
         {
-          if (exists)
+          if (g_file_query_exists (item_file, NULL))
             {
-              /* reload the file */
+              /* reload the file, the plugin is updated once below */
+              g_signal_handlers_block_by_func (G_OBJECT (item),
+                  launcher_plugin_item_changed, plugin);
               if (!garcon_menu_item_reload (item, NULL, &error))
                 {
                   g_critical ("Failed to reload menu item: %s", error->message);
-                  g_error_free (error);
+                  g_clear_error (&error);
                 }
+              g_signal_handlers_unblock_by_func (G_OBJECT (item),
+                  launcher_plugin_item_changed, plugin);
+
+              if (li == plugin->items)
+                update_button = TRUE;
+              else
+                update_menu = TRUE;
             }
           else
             {
@@ -957,31 +1254,104 @@ launcher_plugin_file_changed (GFileMonitor      *monitor,
       g_object_unref (G_OBJECT (item_file));
     }
 
-  if (!found && exists)
+  /* stop loading removed items */
+  if (update_plugin)
+    launcher_plugin_items_cancel_loads (plugin);
+
+  /* files created while loading are most likely duplicates made by the
+   * item loader, keep them queued until the load finishes, by then the
+   * duplicates are in the list and matched above */
+  if (plugin->loads == NULL)
     {
-      /* add the new file to the config */
-      item = garcon_menu_item_new (changed_file);
-      if (G_LIKELY (item != NULL))
+      g_hash_table_iter_init (&iter, plugin->changed_files);
+      while (g_hash_table_iter_next (&iter, (gpointer *) &changed_file, NULL))
         {
-          plugin->items = g_slist_append (plugin->items, item);
-          g_signal_connect (G_OBJECT (item), "changed",
-              G_CALLBACK (launcher_plugin_item_changed), plugin);
-          update_plugin = TRUE;
+          if (!g_file_query_exists (changed_file, NULL))
+            continue;
+
+          /* add the new file to the config */
+          item = garcon_menu_item_new (changed_file);
+          if (G_LIKELY (item != NULL))
+            {
+              plugin->items = g_slist_append (plugin->items, item);
+              g_signal_connect (G_OBJECT (item), "changed",
+                  G_CALLBACK (launcher_plugin_item_changed), plugin);
+              update_plugin = TRUE;
+            }
         }
+
+      g_hash_table_remove_all (plugin->changed_files);
     }
 
-  if (update_plugin)
+  if (update_plugin || update_button)
     {
       launcher_plugin_button_update (plugin);
       launcher_plugin_menu_destroy (plugin);
       launcher_plugin_button_update_action_menu (plugin);
+    }
+  else if (update_menu)
+    {
+      launcher_plugin_menu_destroy (plugin);
+    }
 
+  if (update_plugin)
+    {
       /* save the new config */
       launcher_plugin_save_delayed (plugin);
 
       /* update the dialog */
       g_signal_emit (G_OBJECT (plugin), launcher_signals[ITEMS_CHANGED], 0);
     }
+
+  return FALSE;
+}
+
+
+
+static void
+launcher_plugin_file_changed_queue (LauncherPlugin *plugin)
+{
+  if (plugin->file_changed_timeout_id == 0)
+    {
+      plugin->file_changed_timeout_id =
+          gdk_threads_add_timeout_full (G_PRIORITY_LOW, FILE_CHANGED_DELAY,
+                                        launcher_plugin_file_changed_timeout, plugin,
+                                        launcher_plugin_file_changed_timeout_destroyed);
+    }
+}
+
+
+
+static void
+launcher_plugin_file_changed (GFileMonitor      *monitor,
+                              GFile             *changed_file,
+                              GFile             *other_file,
+                              GFileMonitorEvent  event_type,
+                              LauncherPlugin    *plugin)
+{
+  gchar    *base_name;
+  gboolean  result;
+
+  panel_return_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin));
+  panel_return_if_fail (plugin->config_monitor == monitor);
+
+  /* waited until all events are proccessed */
+  if (event_type != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT
+      && event_type != G_FILE_MONITOR_EVENT_DELETED
+      && event_type != G_FILE_MONITOR_EVENT_CREATED)
+    return;
+
+  /* we only act on desktop files */
+  base_name = g_file_get_basename (changed_file);
+  result = g_str_has_suffix (base_name, ".desktop");
+  g_free (base_name);
+  if (!result)
+    return;
+
+  /* collect the changes and handle them in one go, tools that touch
+   * many desktop files generate a burst of events */
+  g_hash_table_add (plugin->changed_files, g_object_ref (G_OBJECT (changed_file)));
+  launcher_plugin_file_changed_queue (plugin);
 }
 
 
@@ -1081,6 +1451,7 @@ launcher_plugin_free_data (XfcePanelPlugin *panel_plugin)
 {
   LauncherPlugin *plugin = XFCE_LAUNCHER_PLUGIN (panel_plugin);
   GtkIconTheme   *icon_theme;
+  GSList         *li;
 
   /* stop monitoring */
   if (plugin->config_monitor != NULL)
@@ -1089,6 +1460,11 @@ launcher_plugin_free_data (XfcePanelPlugin *panel_plugin)
       g_object_unref (G_OBJECT (plugin->config_monitor));
     }
 
+  /* drop pending file changes */
+  if (plugin->file_changed_timeout_id != 0)
+    g_source_remove (plugin->file_changed_timeout_id);
+  g_hash_table_destroy (plugin->changed_files);
+
   if (plugin->save_timeout_id != 0)
     {
       g_source_remove (plugin->save_timeout_id);
@@ -1098,6 +1474,12 @@ launcher_plugin_free_data (XfcePanelPlugin *panel_plugin)
   /* destroy the menu and timeout */
   launcher_plugin_menu_destroy (plugin);
 
+  /* abort loading items, the load data is released by the tasks */
+  for (li = plugin->loads; li != NULL; li = li->next)
+    g_cancellable_cancel (((LauncherPluginItemLoad *) li->data)->cancellable);
+  g_slist_free (plugin->loads);
+  plugin->loads = NULL;
+
   launcher_plugin_items_free (plugin);
 
   if (plugin->config_directory != NULL)
@@ -1139,6 +1521,11 @@ launcher_plugin_removed (XfcePanelPlugin *panel_plugin)
       plugin->config_monitor = NULL;
     }
 
+  /* drop pending file changes */
+  if (plugin->file_changed_timeout_id != 0)
+    g_source_remove (plugin->file_changed_timeout_id);
+  g_hash_table_remove_all (plugin->changed_files);
+
   /* cleanup desktop files in the config dir */
   launcher_plugin_items_delete_configs (plugin);
 
@@ -2441,6 +2828,45 @@ launcher_plugin_item_query_tooltip (GtkWidget      *widget,
 
 
 
+static const gchar *
+launcher_plugin_item_launch_id (GarconMenuItem *item)
+{
+  gchar    *launch_id;
+  gchar    *path;
+  gchar    *source;
+  GKeyFile *key_file;
+
+  launch_id = g_object_get_qdata (G_OBJECT (item), launcher_plugin_launch_id_quark);
+  if (G_LIKELY (launch_id != NULL))
+    return launch_id;
+
+  /* items in the config directory are copies with generated names, so
+   * use the name of the desktop file they were copied from */
+  source = NULL;
+  path = g_file_get_path (garcon_menu_item_get_file (item));
+  key_file = g_key_file_new ();
+  if (path != NULL
+      && g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, NULL))
+    source = g_key_file_get_string (key_file, G_KEY_FILE_DESKTOP_GROUP, "X-XFCE-Source", NULL);
+  g_key_file_free (key_file);
+  g_free (path);
+
+  if (source != NULL)
+    launch_id = g_path_get_basename (source);
+  else if (garcon_menu_item_get_name (item) != NULL)
+    launch_id = g_strdup (garcon_menu_item_get_name (item));
+  else
+    launch_id = g_strdup (garcon_menu_item_get_desktop_id (item));
+  g_free (source);
+
+  g_object_set_qdata_full (G_OBJECT (item), launcher_plugin_launch_id_quark,
+                           launch_id, g_free);
+
+  return launch_id;
+}
+
+
+
 static gboolean
 launcher_plugin_item_exec_on_screen (GarconMenuItem *item,
                                      guint32         event_time,
@@ -2452,6 +2878,7 @@ launcher_plugin_item_exec_on_screen (GarconMenuItem *item,
   gboolean     succeed = FALSE;
   gchar       *command, *uri;
   const gchar *icon;
+  PanelLaunch *launch;
 
   panel_return_val_if_fail (GARCON_IS_MENU_ITEM (item), FALSE);
   panel_return_val_if_fail (GDK_IS_SCREEN (screen), FALSE);
@@ -2460,6 +2887,9 @@ launcher_plugin_item_exec_on_screen (GarconMenuItem *item,
   command = (gchar*) garcon_menu_item_get_command (item);
   panel_return_val_if_fail (!panel_str_is_empty (command), FALSE);
 
+  /* measure the launch latency */
+  launch = panel_launch_begin (launcher_plugin_item_launch_id (item));
+
   /* expand the field codes */
   icon = garcon_menu_item_get_icon_name (item);
   uri = garcon_menu_item_get_uri (item);
@@ -2482,8 +2912,14 @@ launcher_plugin_item_exec_on_screen (GarconMenuItem *item,
       g_strfreev (argv);
     }
 
-  if (G_UNLIKELY (!succeed))
+  if (G_LIKELY (succeed))
     {
+      panel_launch_spawned (launch, garcon_menu_item_supports_startup_notification (item));
+    }
+  else
+    {
+      panel_launch_cancel (launch);
+
       /* show an error dialog */
       xfce_dialog_show_error (NULL, error, _("Failed to execute command \"%s\"."), command);
       g_error_free (error);
@@ -2673,21 +3109,33 @@ launcher_plugin_get_items (LauncherPlugin *plugin)
 
 
 
+static gchar *
+launcher_plugin_unique_basename (void)
+{
+  static guint counter = 0;
+
+  return g_strdup_printf ("%" G_GINT64_FORMAT "%d.desktop",
+                          g_get_real_time () / G_USEC_PER_SEC,
+                          ++counter);
+}
+
+
+
 gchar *
 launcher_plugin_unique_filename (LauncherPlugin *plugin)
 {
-  gchar        *filename, *path;
-  static guint  counter = 0;
+  gchar *basename, *filename, *path;
 
   panel_return_val_if_fail (XFCE_IS_LAUNCHER_PLUGIN (plugin), NULL);
 
-  filename = g_strdup_printf (RELATIVE_CONFIG_PATH G_DIR_SEPARATOR_S "%" G_GINT64_FORMAT "%d.desktop",
+  basename = launcher_plugin_unique_basename ();
+  filename = g_strdup_printf (RELATIVE_CONFIG_PATH G_DIR_SEPARATOR_S "%s",
                               xfce_panel_plugin_get_name (XFCE_PANEL_PLUGIN (plugin)),
                               xfce_panel_plugin_get_unique_id (XFCE_PANEL_PLUGIN (plugin)),
-                              g_get_real_time () / G_USEC_PER_SEC,
-                              ++counter);
+                              basename);
   path = xfce_resource_save_location (XFCE_RESOURCE_CONFIG, filename, TRUE);
   g_free (filename);
+  g_free (basename);
 
   return path;
 
@@ -93,6 +93,7 @@ enum
 {
   VIEWPORT_X,
   VIEWPORT_Y,
+  VIEWPORT_NUMBER,
   N_INFOS
 };
 
@@ -292,15 +293,51 @@ pager_buttons_button_press_event (GtkWidget      *button,
 
 
 
+static GtkWidget *
+pager_buttons_workspace_button_new (WnckWorkspace *workspace,
+                                    gboolean       active,
+                                    GtkWidget     *panel_plugin)
+{
+  GtkWidget *button;
+  GtkWidget *label;
+
+  button = xfce_panel_create_toggle_button ();
+  gtk_widget_add_events (GTK_WIDGET (button), GDK_SCROLL_MASK | GDK_SMOOTH_SCROLL_MASK);
+  if (active)
+    gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (button), TRUE);
+  g_signal_connect (G_OBJECT (button), "toggled",
+      G_CALLBACK (pager_buttons_workspace_button_toggled), workspace);
+  g_signal_connect (G_OBJECT (button), "button-press-event",
+      G_CALLBACK (pager_buttons_button_press_event), NULL);
+  xfce_panel_plugin_add_action_widget (XFCE_PANEL_PLUGIN (panel_plugin), button);
+  gtk_widget_show (button);
+
+  g_object_set_data (G_OBJECT (button), "workspace", workspace);
+
+  label = gtk_label_new (NULL);
+  g_signal_connect_object (G_OBJECT (workspace), "name-changed",
+      G_CALLBACK (pager_buttons_workspace_button_label), label, 0);
+  gtk_container_add (GTK_CONTAINER (button), label);
+  gtk_widget_show (label);
+
+  return button;
+}
+
+
+
 static gboolean
 pager_buttons_rebuild_idle (gpointer user_data)
 {
   PagerButtons  *pager = XFCE_PAGER_BUTTONS (user_data);
-  GList         *li, *workspaces;
+  GList         *li, *workspaces, *children;
+  GSList        *lp, *buttons;
+  GHashTable    *old_buttons;
+  GHashTableIter iter;
   WnckWorkspace *active_ws;
   gint           n, n_workspaces;
   gint           rows, cols;
   gint           row, col;
+  gint           left, top;
   GtkWidget     *button;
   WnckWorkspace *workspace = NULL;
   GtkWidget     *panel_plugin;
@@ -311,21 +348,24 @@ pager_buttons_rebuild_idle (gpointer user_data)
   gboolean       viewport_mode = FALSE;
   gint           n_viewports = 0;
   gint          *vp_info;
+  gboolean       reuse;
   gchar          text[8];
 
   panel_return_val_if_fail (XFCE_IS_PAGER_BUTTONS (pager), FALSE);
   panel_return_val_if_fail (WNCK_IS_SCREEN (pager->wnck_screen), FALSE);
 
-  gtk_container_foreach (GTK_CONTAINER (pager),
-      (GtkCallback) (void (*)(void)) gtk_widget_destroy, NULL);
-
-  g_slist_free (pager->buttons);
-  pager->buttons = NULL;
-
   active_ws = wnck_screen_get_active_workspace (pager->wnck_screen);
   workspaces = wnck_screen_get_workspaces (pager->wnck_screen);
   if (workspaces == NULL)
-    goto leave;
+    {
+      gtk_container_foreach (GTK_CONTAINER (pager),
+          (GtkCallback) (void (*)(void)) gtk_widget_destroy, NULL);
+
+      g_slist_free (pager->buttons);
+      pager->buttons = NULL;
+
+      goto leave;
+    }
 
   n_workspaces = g_list_length (workspaces);
 
@@ -384,11 +424,75 @@ pager_buttons_rebuild_idle (gpointer user_data)
       viewport_x = wnck_workspace_get_viewport_x (workspace);
       viewport_y = wnck_workspace_get_viewport_y (workspace);
 
+      /* the viewports-changed signal is also emitted when the viewport
+       * is moved, in that case the existing buttons are still valid */
+      children = gtk_container_get_children (GTK_CONTAINER (pager));
+      reuse = pager->buttons == NULL && (gint) g_list_length (children) == n_viewports;
+      for (li = children; reuse && li != NULL; li = li->next)
+        {
+          vp_info = g_object_get_data (G_OBJECT (li->data), "viewport-info");
+          reuse = vp_info != NULL
+                  && vp_info[VIEWPORT_X] == (vp_info[VIEWPORT_NUMBER] % (workspace_height / screen_height)) * screen_width
+                  && vp_info[VIEWPORT_Y] == (vp_info[VIEWPORT_NUMBER] / (workspace_height / screen_height)) * screen_height;
+        }
+
+      if (reuse)
+        {
+          for (li = children; li != NULL; li = li->next)
+            {
+              button = GTK_WIDGET (li->data);
+              vp_info = g_object_get_data (G_OBJECT (button), "viewport-info");
+              n = vp_info[VIEWPORT_NUMBER];
+
+              /* don't move the viewport again when the state is synced */
+              g_signal_handlers_block_by_func (G_OBJECT (button),
+                  G_CALLBACK (pager_buttons_viewport_button_toggled), pager);
+              gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (button),
+                  viewport_x >= vp_info[VIEWPORT_X] && viewport_x < vp_info[VIEWPORT_X] + screen_width
+                  && viewport_y >= vp_info[VIEWPORT_Y] && viewport_y < vp_info[VIEWPORT_Y] + screen_height);
+              g_signal_handlers_unblock_by_func (G_OBJECT (button),
+                  G_CALLBACK (pager_buttons_viewport_button_toggled), pager);
+
+              gtk_label_set_angle (GTK_LABEL (gtk_bin_get_child (GTK_BIN (button))),
+                  pager->orientation == GTK_ORIENTATION_HORIZONTAL ? 0 : 270);
+
+              if (pager->orientation == GTK_ORIENTATION_HORIZONTAL)
+                {
+                  row = n % cols;
+                  col = n / cols;
+                }
+              else
+                {
+                  row = n / cols;
+                  col = n % cols;
+                }
+
+              gtk_container_child_get (GTK_CONTAINER (pager), button,
+                                       "left-attach", &left, "top-attach", &top, NULL);
+              if (left != row || top != col)
+                gtk_container_child_set (GTK_CONTAINER (pager), button,
+                                         "left-attach", row, "top-attach", col, NULL);
+            }
+
+          g_list_free (children);
+
+          goto leave;
+        }
+
+      g_list_free (children);
+
+      gtk_container_foreach (GTK_CONTAINER (pager),
+          (GtkCallback) (void (*)(void)) gtk_widget_destroy, NULL);
+
+      g_slist_free (pager->buttons);
+      pager->buttons = NULL;
+
       for (n = 0; n < n_viewports; n++)
         {
           vp_info = g_new0 (gint, N_INFOS);
           vp_info[VIEWPORT_X] = (n % (workspace_height / screen_height)) * screen_width;
           vp_info[VIEWPORT_Y] = (n / (workspace_height / screen_height)) * screen_height;
+          vp_info[VIEWPORT_NUMBER] = n;
 
           button = xfce_panel_create_toggle_button ();
           gtk_widget_add_events (GTK_WIDGET (button), GDK_SCROLL_MASK | GDK_SMOOTH_SCROLL_MASK);
@@ -429,32 +533,24 @@ pager_buttons_rebuild_idle (gpointer user_data)
     }
   else
     {
-      for (li = workspaces, n = 0; li != NULL; li = li->next, n++)
-        {
-          workspace = WNCK_WORKSPACE (li->data);
+      /* the viewport buttons are not in the buttons list */
+      children = gtk_container_get_children (GTK_CONTAINER (pager));
+      for (li = children; li != NULL; li = li->next)
+        if (g_slist_find (pager->buttons, li->data) == NULL)
+          gtk_widget_destroy (GTK_WIDGET (li->data));
+      g_list_free (children);
 
-          button = xfce_panel_create_toggle_button ();
-          gtk_widget_add_events (GTK_WIDGET (button), GDK_SCROLL_MASK | GDK_SMOOTH_SCROLL_MASK);
-          if (workspace == active_ws)
-            gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (button), TRUE);
-          g_signal_connect (G_OBJECT (button), "toggled",
-              G_CALLBACK (pager_buttons_workspace_button_toggled), workspace);
-          g_signal_connect (G_OBJECT (button), "button-press-event",
-              G_CALLBACK (pager_buttons_button_press_event), NULL);
-          xfce_panel_plugin_add_action_widget (XFCE_PANEL_PLUGIN (panel_plugin), button);
-          gtk_widget_show (button);
+      /* diff the workspaces against the existing buttons, so only new
+       * workspaces get a button and the others are updated in place */
+      old_buttons = g_hash_table_new (g_direct_hash, g_direct_equal);
+      for (lp = pager->buttons; lp != NULL; lp = lp->next)
+        g_hash_table_insert (old_buttons, g_object_get_data (G_OBJECT (lp->data), "workspace"), lp->data);
 
-          label = gtk_label_new (NULL);
-          g_object_set_data (G_OBJECT (label), "numbering", GINT_TO_POINTER (pager->numbering));
-          g_signal_connect_object (G_OBJECT (workspace), "name-changed",
-              G_CALLBACK (pager_buttons_workspace_button_label), label, 0);
-          pager_buttons_workspace_button_label (workspace, label);
-          gtk_label_set_angle (GTK_LABEL (label),
-              pager->orientation == GTK_ORIENTATION_HORIZONTAL ? 0 : 270);
-          gtk_container_add (GTK_CONTAINER (button), label);
-          gtk_widget_show (label);
+      buttons = NULL;
 
-          pager->buttons = g_slist_prepend (pager->buttons, button);
+      for (li = workspaces, n = 0; li != NULL; li = li->next, n++)
+        {
+          workspace = WNCK_WORKSPACE (li->data);
 
           if (pager->orientation == GTK_ORIENTATION_HORIZONTAL)
             {
@@ -467,12 +563,48 @@ pager_buttons_rebuild_idle (gpointer user_data)
               col = n % cols;
             }
 
-          gtk_grid_attach (GTK_GRID (pager), button,
-                           row, col, 1, 1);
+          button = g_hash_table_lookup (old_buttons, workspace);
+          if (button != NULL)
+            {
+              g_hash_table_remove (old_buttons, workspace);
+
+              gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (button), workspace == active_ws);
+
+              /* only re-pack the button if its cell changed */
+              gtk_container_child_get (GTK_CONTAINER (pager), button,
+                                       "left-attach", &left, "top-attach", &top, NULL);
+              if (left != row || top != col)
+                gtk_container_child_set (GTK_CONTAINER (pager), button,
+                                         "left-attach", row, "top-attach", col, NULL);
+            }
+          else
+            {
+              button = pager_buttons_workspace_button_new (workspace, workspace == active_ws,
+                                                           panel_plugin);
+              gtk_grid_attach (GTK_GRID (pager), button,
+                               row, col, 1, 1);
+            }
+
+          /* the number in the label or fallback name might have changed,
+           * the label is only touched if the text is different */
+          label = gtk_bin_get_child (GTK_BIN (button));
+          g_object_set_data (G_OBJECT (label), "numbering", GINT_TO_POINTER (pager->numbering));
+          pager_buttons_workspace_button_label (workspace, label);
+          gtk_label_set_angle (GTK_LABEL (label),
+              pager->orientation == GTK_ORIENTATION_HORIZONTAL ? 0 : 270);
+
+          buttons = g_slist_prepend (buttons, button);
         }
-    }
 
-  pager->buttons = g_slist_reverse (pager->buttons);
+      /* buttons of workspaces that no longer exist */
+      g_hash_table_iter_init (&iter, old_buttons);
+      while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &button))
+        gtk_widget_destroy (button);
+      g_hash_table_destroy (old_buttons);
+
+      g_slist_free (pager->buttons);
+      pager->buttons = g_slist_reverse (buttons);
+    }
 
   leave:
 
@@ -508,7 +640,6 @@ pager_buttons_screen_workspace_changed (WnckScreen    *screen,
                                         WnckWorkspace *previous_workspace,
                                         PagerButtons  *pager)
 {
-  gint           active = -1, n;
   WnckWorkspace *active_ws;
   GSList        *li;
 
@@ -518,11 +649,10 @@ pager_buttons_screen_workspace_changed (WnckScreen    *screen,
   panel_return_if_fail (pager->wnck_screen == screen);
 
   active_ws = wnck_screen_get_active_workspace (screen);
-  if (G_LIKELY (active_ws != NULL))
-    active = wnck_workspace_get_number (active_ws);
 
-  for (li = pager->buttons, n = 0; li != NULL; li = li->next, n++)
-    gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (li->data), n == active);
+  for (li = pager->buttons; li != NULL; li = li->next)
+    gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (li->data),
+        g_object_get_data (G_OBJECT (li->data), "workspace") == active_ws);
 }
 
 
@@ -547,11 +677,25 @@ pager_buttons_screen_workspace_destroyed (WnckScreen    *screen,
                                           WnckWorkspace *destroyed_workspace,
                                           PagerButtons  *pager)
 {
+  GSList *li;
+
   panel_return_if_fail (WNCK_IS_SCREEN (screen));
   panel_return_if_fail (WNCK_IS_WORKSPACE (destroyed_workspace));
   panel_return_if_fail (XFCE_IS_PAGER_BUTTONS (pager));
   panel_return_if_fail (pager->wnck_screen == screen);
 
+  /* drop the button right away, the workspace is about to be freed
+   * and a new one could be allocated at the same address */
+  for (li = pager->buttons; li != NULL; li = li->next)
+    {
+      if (g_object_get_data (G_OBJECT (li->data), "workspace") == destroyed_workspace)
+        {
+          gtk_widget_destroy (GTK_WIDGET (li->data));
+          pager->buttons = g_slist_delete_link (pager->buttons, li);
+          break;
+        }
+    }
+
   pager_buttons_queue_rebuild (pager);
 }
 
@@ -565,8 +709,8 @@ pager_buttons_screen_viewports_changed (WnckScreen    *screen,
   panel_return_if_fail (XFCE_IS_PAGER_BUTTONS (pager));
   panel_return_if_fail (pager->wnck_screen == screen);
 
-  /* yes we are extremely lazy here, but this event is
-   * also emitted when the viewport setup changes... */
+  /* this event is also emitted when the viewport setup changes, the
+   * rebuild keeps the buttons if only the active viewport moved */
   if (pager->buttons == NULL)
     pager_buttons_queue_rebuild (pager);
 }
@@ -601,7 +745,8 @@ pager_buttons_workspace_button_label (WnckWorkspace *workspace,
                                        wnck_workspace_get_number (workspace) + 1,
                                        name);
 
-  gtk_label_set_text (GTK_LABEL (label), name);
+  if (g_strcmp0 (gtk_label_get_text (GTK_LABEL (label)), name) != 0)
+    gtk_label_set_text (GTK_LABEL (label), name);
 
   g_free (utf8);
   g_free (name_fallback);
@@ -0,0 +1,379 @@
+ #
+ # Copyright (C) 2024 The Xfce development team
+ #
+ # This program is free software; you can redistribute it and/or modify
+ # it under the terms of the GNU General Public License as published by
+ # the Free Software Foundation; either version 2 of the License, or
+ # (at your option) any later version.
+ #
+ # This program is distributed in the hope that it will be useful,
+ # but WITHOUT ANY WARRANTY; without even the implied warranty of
+ # MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ # GNU General Public License for more details.
+ #
+ # You should have received a copy of the GNU General Public License along
+ # with this program; if not, write to the Free Software Foundation, Inc.,
+ # 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ #
+
+
+"""StatusNotifierItem load generator for the Xfce Panel
+
+Registers a number of fake StatusNotifierItems with the running
+StatusNotifierWatcher and changes their icons, tooltips and status at a
+fixed rate. At the end a JSON summary is printed with the signals sent,
+the property calls the host made in response, the delay between a change
+signal and the first call for it, and the CPU time used by the host.
+
+Run it against a throwaway panel on a private session bus and X server:
+
+  dbus-run-session -- xvfb-run -a sh -c \\
+    'python3 sn-benchmark.py --panel xfce4-panel --items 20 --rate 10'
+
+With --paint the host runs with PANEL_DEBUG=systray and the summary
+also has the number of icon redraws and the time from an icon change to
+the paint that shows it, read from the host's debug output.
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import threading
+import time
+
+from gi.repository import Gio, GLib
+
+
+
+ITEM_XML = """
+<node>
+  <interface name="org.kde.StatusNotifierItem">
+    <property name="Category" type="s" access="read" />
+    <property name="Id" type="s" access="read" />
+    <property name="Title" type="s" access="read" />
+    <property name="Status" type="s" access="read" />
+    <property name="WindowId" type="u" access="read" />
+    <property name="IconThemePath" type="s" access="read" />
+    <property name="IconName" type="s" access="read" />
+    <property name="IconPixmap" type="a(iiay)" access="read" />
+    <property name="IconAccessibleDesc" type="s" access="read" />
+    <property name="OverlayIconName" type="s" access="read" />
+    <property name="OverlayIconPixmap" type="a(iiay)" access="read" />
+    <property name="AttentionIconName" type="s" access="read" />
+    <property name="AttentionIconPixmap" type="a(iiay)" access="read" />
+    <property name="AttentionAccessibleDesc" type="s" access="read" />
+    <property name="ToolTip" type="(sa(iiay)ss)" access="read" />
+    <property name="ItemIsMenu" type="b" access="read" />
+    <property name="Menu" type="o" access="read" />
+    <method name="ContextMenu">
+      <arg name="x" type="i" direction="in" />
+      <arg name="y" type="i" direction="in" />
+    </method>
+    <method name="Activate">
+      <arg name="x" type="i" direction="in" />
+      <arg name="y" type="i" direction="in" />
+    </method>
+    <method name="SecondaryActivate">
+      <arg name="x" type="i" direction="in" />
+      <arg name="y" type="i" direction="in" />
+    </method>
+    <method name="Scroll">
+      <arg name="delta" type="i" direction="in" />
+      <arg name="orientation" type="s" direction="in" />
+    </method>
+    <signal name="NewTitle" />
+    <signal name="NewIcon" />
+    <signal name="NewAttentionIcon" />
+    <signal name="NewOverlayIcon" />
+    <signal name="NewToolTip" />
+    <signal name="NewStatus">
+      <arg name="status" type="s" />
+    </signal>
+  </interface>
+</node>
+"""
+
+ITEM_INTERFACE = "org.kde.StatusNotifierItem"
+OBJECT_PATH_PREFIX = "/org/xfce/SnBenchmark/Item"
+N_FRAMES = 8
+
+
+
+def make_frames(sizes):
+    """Pre-render the animation so the generator itself stays cheap"""
+    frames = []
+    for frame in range(N_FRAMES):
+        level = 32 + frame * (192 // N_FRAMES)
+        pixmaps = []
+        for size in sizes:
+            pixel = bytes((255, level, 255 - level, (level * 3) % 256))
+            pixmaps.append((size, size, pixel * (size * size)))
+        frames.append(GLib.Variant("a(iiay)", pixmaps))
+    return frames
+
+
+
+class Stats():
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.signals = 0
+        self.get_calls = 0
+        self.get_all_calls = 0
+        self.messages = 0
+        self.latencies = []
+        self.pending = {}
+        self.redraws = 0
+        self.paints = []
+
+    def signal_sent(self, path, fetch):
+        with self.lock:
+            self.signals += 1
+            # only signals the host answers with a property call can be
+            # matched to one, a stale entry would inflate the next latency
+            if fetch:
+                self.pending.setdefault(path, time.monotonic())
+
+    def message_filter(self, connection, message, incoming):
+        # runs in the GDBus worker thread
+        with self.lock:
+            self.messages += 1
+            if (incoming
+                    and message.get_interface() == "org.freedesktop.DBus.Properties"
+                    and (message.get_path() or "").startswith(OBJECT_PATH_PREFIX)):
+                if message.get_member() == "GetAll":
+                    self.get_all_calls += 1
+                elif message.get_member() == "Get":
+                    self.get_calls += 1
+                since = self.pending.pop(message.get_path(), None)
+                if since is not None:
+                    self.latencies.append(time.monotonic() - since)
+        return message
+
+
+
+PAINT_RE = re.compile(r": sn-benchmark-\d+: redraw \d+, painted (\d+) us after")
+
+
+def read_paints(stream, stats):
+    """Collect the change to paint times from the host's debug output"""
+    for line in iter(stream.readline, b""):
+        match = PAINT_RE.search(line.decode(errors="replace"))
+        if match:
+            with stats.lock:
+                stats.redraws += 1
+                stats.paints.append(int(match.group(1)) / 1e6)
+
+
+
+class FakeItem():
+
+    def __init__(self, connection, index, frames, changes, stats):
+        self.connection = connection
+        self.index = index
+        self.path = "%s%d" % (OBJECT_PATH_PREFIX, index)
+        self.frames = frames
+        self.changes = changes
+        self.stats = stats
+        self.frame = 0
+        self.tick = 0
+        self.status = "Active"
+        self.tooltip = "Benchmark item %d" % index
+
+        node_info = Gio.DBusNodeInfo.new_for_xml(ITEM_XML)
+        self.registration_id = connection.register_object(
+            self.path, node_info.interfaces[0],
+            self.method_call, self.get_property, None)
+
+    def method_call(self, connection, sender, path, interface, method, parameters, invocation):
+        invocation.return_value(None)
+
+    def get_property(self, connection, sender, path, interface, name):
+        if name == "IconPixmap":
+            return self.frames[self.frame]
+        if name in ("OverlayIconPixmap", "AttentionIconPixmap"):
+            return GLib.Variant("a(iiay)", [])
+        if name == "ToolTip":
+            return GLib.Variant("(sa(iiay)ss)", ("", [], self.tooltip, ""))
+        if name == "Status":
+            return GLib.Variant("s", self.status)
+        if name == "WindowId":
+            return GLib.Variant("u", 0)
+        if name == "ItemIsMenu":
+            return GLib.Variant("b", False)
+        if name == "Menu":
+            return GLib.Variant("o", "/NO_DBUSMENU")
+        if name == "Id":
+            return GLib.Variant("s", "sn-benchmark-%d" % self.index)
+        if name == "Title":
+            return GLib.Variant("s", "SN Benchmark %d" % self.index)
+        if name == "Category":
+            return GLib.Variant("s", "ApplicationStatus")
+        return GLib.Variant("s", "")
+
+    def start(self, interval):
+        GLib.timeout_add(interval, self.change)
+        return GLib.SOURCE_REMOVE
+
+    def emit(self, signal, parameters=None):
+        # NewStatus carries the new status, the host does not fetch it
+        self.stats.signal_sent(self.path, parameters is None)
+        self.connection.emit_signal(None, self.path, ITEM_INTERFACE, signal, parameters)
+
+    def change(self):
+        change = self.changes[self.tick % len(self.changes)]
+        self.tick += 1
+
+        if change == "icon":
+            self.frame = (self.frame + 1) % len(self.frames)
+            self.emit("NewIcon")
+        elif change == "tooltip":
+            self.tooltip = "Benchmark item %d, update %d" % (self.index, self.tick)
+            self.emit("NewToolTip")
+        elif change == "status":
+            self.status = "NeedsAttention" if self.status == "Active" else "Active"
+            self.emit("NewStatus", GLib.Variant("(s)", (self.status,)))
+
+        return GLib.SOURCE_CONTINUE
+
+
+
+def host_pid(connection):
+    reply = connection.call_sync("org.freedesktop.DBus", "/org/freedesktop/DBus",
+                                 "org.freedesktop.DBus", "GetConnectionUnixProcessID",
+                                 GLib.Variant("(s)", ("org.kde.StatusNotifierWatcher",)),
+                                 GLib.VariantType("(u)"), Gio.DBusCallFlags.NONE, -1, None)
+    return reply.unpack()[0]
+
+
+def cpu_seconds(pid):
+    with open("/proc/%d/stat" % pid) as stat:
+        fields = stat.read().rsplit(")", 1)[1].split()
+    # utime and stime are fields 14 and 15, counted after the comm field
+    return (int(fields[11]) + int(fields[12])) / os.sysconf("SC_CLK_TCK")
+
+
+def percentile(values, fraction):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * fraction))]
+
+
+def wait_for_watcher(connection, timeout):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        reply = connection.call_sync("org.freedesktop.DBus", "/org/freedesktop/DBus",
+                                     "org.freedesktop.DBus", "NameHasOwner",
+                                     GLib.Variant("(s)", ("org.kde.StatusNotifierWatcher",)),
+                                     GLib.VariantType("(b)"), Gio.DBusCallFlags.NONE, -1, None)
+        if reply.unpack()[0]:
+            return True
+        time.sleep(0.1)
+    return False
+
+
+
+def main():
+    parser = argparse.ArgumentParser(description="StatusNotifierItem load generator")
+    parser.add_argument("--items", type=int, default=10, help="number of fake items")
+    parser.add_argument("--rate", type=float, default=10.0, help="changes per second per item")
+    parser.add_argument("--duration", type=float, default=30.0, help="seconds to measure")
+    parser.add_argument("--warmup", type=float, default=2.0, help="seconds before measuring")
+    parser.add_argument("--sizes", default="22,48,256", help="pixmap sizes sent with each icon")
+    parser.add_argument("--changes", default="icon,icon,icon,tooltip,status",
+                        help="round robin of changes: icon, tooltip, status")
+    parser.add_argument("--panel", help="command starting the host, killed at the end")
+    parser.add_argument("--pid", type=int, help="host process, by default the watcher owner")
+    parser.add_argument("--paint", action="store_true",
+                        help="also measure redraws from the debug output of --panel")
+    args = parser.parse_args()
+
+    if args.paint and not args.panel:
+        parser.error("--paint needs --panel")
+
+    connection = Gio.bus_get_sync(Gio.BusType.SESSION, None)
+    stats = Stats()
+    panel = None
+    if args.panel and args.paint:
+        env = dict(os.environ, PANEL_DEBUG="systray")
+        panel = subprocess.Popen(args.panel, shell=True, env=env, stderr=subprocess.PIPE)
+        threading.Thread(target=read_paints, args=(panel.stderr, stats), daemon=True).start()
+    elif args.panel:
+        panel = subprocess.Popen(args.panel, shell=True)
+
+    try:
+        if not wait_for_watcher(connection, 30):
+            print("No StatusNotifierWatcher on the session bus", file=sys.stderr)
+            return 1
+
+        pid = args.pid or host_pid(connection)
+        sizes = [int(size) for size in args.sizes.split(",")]
+        frames = make_frames(sizes)
+        changes = args.changes.split(",")
+        items = [FakeItem(connection, i, frames, changes, stats) for i in range(args.items)]
+
+        watcher = Gio.DBusProxy.new_sync(connection, Gio.DBusProxyFlags.NONE, None,
+                                         "org.kde.StatusNotifierWatcher", "/StatusNotifierWatcher",
+                                         "org.kde.StatusNotifierWatcher", None)
+        for item in items:
+            watcher.RegisterStatusNotifierItem("(s)", item.path)
+
+        loop = GLib.MainLoop()
+        interval = max(1, int(1000 / args.rate))
+        for item in items:
+            # spread the items over the interval
+            GLib.timeout_add(interval * item.index // max(1, args.items) + 1,
+                             item.start, interval)
+
+        def start_measuring():
+            with stats.lock:
+                stats.signals = stats.get_calls = stats.get_all_calls = stats.messages = 0
+                stats.latencies = []
+                stats.redraws = 0
+                stats.paints = []
+            stats.cpu_start = cpu_seconds(pid)
+            stats.time_start = time.monotonic()
+            GLib.timeout_add(int(args.duration * 1000), loop.quit)
+            return GLib.SOURCE_REMOVE
+
+        connection.add_filter(stats.message_filter)
+        GLib.timeout_add(int(args.warmup * 1000), start_measuring)
+        loop.run()
+
+        elapsed = time.monotonic() - stats.time_start
+        cpu = cpu_seconds(pid) - stats.cpu_start
+        with stats.lock:
+            result = {
+                "items": args.items,
+                "rate_hz": args.rate,
+                "duration_s": round(elapsed, 3),
+                "signals_per_s": round(stats.signals / elapsed, 1),
+                "host_get_calls": stats.get_calls,
+                "host_get_all_calls": stats.get_all_calls,
+                "messages_per_s": round(stats.messages / elapsed, 1),
+                "reaction_ms_p50": round(percentile(stats.latencies, 0.5) * 1000, 2),
+                "reaction_ms_p95": round(percentile(stats.latencies, 0.95) * 1000, 2),
+                "reaction_ms_max": round(max(stats.latencies, default=0) * 1000, 2),
+                "host_cpu_percent": round(100 * cpu / elapsed, 2),
+            }
+            if args.paint:
+                result.update({
+                    "paints_per_s": round(stats.redraws / elapsed, 1),
+                    "paint_ms_p50": round(percentile(stats.paints, 0.5) * 1000, 2),
+                    "paint_ms_p95": round(percentile(stats.paints, 0.95) * 1000, 2),
+                })
+        print(json.dumps(result))
+        return 0
+    finally:
+        if panel is not None:
+            panel.terminate()
+            panel.wait()
+
+
+
+if __name__ == '__main__':
+    sys.exit(main())
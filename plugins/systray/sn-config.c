@@ -49,6 +49,7 @@
 #define DEFAULT_PANEL_ORIENTATION  GTK_ORIENTATION_HORIZONTAL
 #define DEFAULT_PANEL_SIZE         28
 #define DEFAULT_HIDE_NEW_ITEMS     FALSE
+#define DEFAULT_OFFSCREEN_ICONS    FALSE
 
 
 
@@ -81,6 +82,7 @@ struct _SnConfig
   gboolean            symbolic_icons;
   gboolean            menu_is_primary;
   gboolean            hide_new_items;
+  gboolean            offscreen_icons;
   GList              *known_items;
   GHashTable         *hidden_items;
   GList              *known_legacy_items;
@@ -107,6 +109,7 @@ enum
   PROP_SYMBOLIC_ICONS,
   PROP_MENU_IS_PRIMARY,
   PROP_HIDE_NEW_ITEMS,
+  PROP_OFFSCREEN_ICONS,
   PROP_KNOWN_ITEMS,
   PROP_HIDDEN_ITEMS,
   PROP_KNOWN_LEGACY_ITEMS,
@@ -205,6 +208,13 @@ sn_config_class_init (SnConfigClass *klass)
                                                          G_PARAM_READWRITE |
                                                          G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (object_class,
+                                   PROP_OFFSCREEN_ICONS,
+                                   g_param_spec_boolean ("offscreen-icons", NULL, NULL,
+                                                         DEFAULT_OFFSCREEN_ICONS,
+                                                         G_PARAM_READWRITE |
+                                                         G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property (object_class,
                                    PROP_KNOWN_ITEMS,
                                    g_param_spec_boxed ("known-items",
@@ -288,6 +298,7 @@ sn_config_init (SnConfig *config)
   config->square_icons         = DEFAULT_SQUARE_ICONS;
   config->symbolic_icons       = DEFAULT_SYMBOLIC_ICONS;
   config->hide_new_items       = DEFAULT_HIDE_NEW_ITEMS;
+  config->offscreen_icons      = DEFAULT_OFFSCREEN_ICONS;
   config->known_items          = NULL;
   config->hidden_items         = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
   config->known_legacy_items   = NULL;
@@ -382,6 +393,10 @@ sn_config_get_property (GObject    *object,
       g_value_set_boolean (value, config->hide_new_items);
       break;
 
+    case PROP_OFFSCREEN_ICONS:
+      g_value_set_boolean (value, config->offscreen_icons);
+      break;
+
     case PROP_KNOWN_ITEMS:
       array = g_ptr_array_new_full (1, sn_config_free_array_element);
       for (li = config->known_items; li != NULL; li = li->next)
@@ -501,6 +516,15 @@ sn_config_set_property (GObject      *object,
         }
       break;
 
+    case PROP_OFFSCREEN_ICONS:
+      val = g_value_get_boolean (value);
+      if (config->offscreen_icons != val)
+        {
+          config->offscreen_icons = val;
+          g_signal_emit (G_OBJECT (config), sn_config_signals[CONFIGURATION_CHANGED], 0);
+        }
+      break;
+
     case PROP_KNOWN_ITEMS:
       g_list_free_full (config->known_items, g_free);
       config->known_items = NULL;
@@ -692,6 +716,16 @@ sn_config_get_menu_is_primary (SnConfig *config)
 
 
 
+gboolean
+sn_config_get_offscreen_icons (SnConfig *config)
+{
+  g_return_val_if_fail (XFCE_IS_SN_CONFIG (config), DEFAULT_OFFSCREEN_ICONS);
+
+  return config->offscreen_icons;
+}
+
+
+
 void
 sn_config_set_orientation (SnConfig       *config,
                            GtkOrientation  panel_orientation,
@@ -1145,6 +1179,10 @@ sn_config_new (const gchar *property_base)
       xfconf_g_property_bind (channel, property, G_TYPE_BOOLEAN, config, "hide-new-items");
       g_free (property);
 
+      property = g_strconcat (property_base, "/offscreen-icons", NULL);
+      xfconf_g_property_bind (channel, property, G_TYPE_BOOLEAN, config, "offscreen-icons");
+      g_free (property);
+
       property = g_strconcat (property_base, "/known-items", NULL);
       xfconf_g_property_bind (channel, property, XFCE_TYPE_SN_CONFIG_VALUE_ARRAY, config, "known-items");
       g_free (property);
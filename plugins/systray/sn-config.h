@@ -63,6 +63,8 @@ gboolean               sn_config_get_symbolic_icons            (SnConfig
 
 gboolean               sn_config_get_menu_is_primary           (SnConfig                *config);
 
+gboolean               sn_config_get_offscreen_icons           (SnConfig                *config);
+
 gint                   sn_config_get_icon_size                 (SnConfig                *config);
 
 gboolean               sn_config_get_icon_size_is_automatic    (SnConfig                *config);
@@ -119,6 +121,7 @@ gboolean               sn_config_legacy_items_clear            (SnConfig
 #define DEFAULT_PANEL_ORIENTATION  GTK_ORIENTATION_HORIZONTAL
 #define DEFAULT_PANEL_SIZE         28
 #define DEFAULT_HIDE_NEW_ITEMS     FALSE
+#define DEFAULT_OFFSCREEN_ICONS    FALSE
 
 
 
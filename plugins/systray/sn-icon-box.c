@@ -27,6 +27,7 @@
 
 #include <libxfce4panel/libxfce4panel.h>
 
+#include <common/panel-debug.h>
 #include "sn-icon-box.h"
 #include "sn-util.h"
 
@@ -45,6 +46,9 @@ static void                  sn_icon_box_get_preferred_height        (GtkWidget
 static void                  sn_icon_box_size_allocate               (GtkWidget               *widget,
                                                                       GtkAllocation           *allocation);
 
+static gboolean              sn_icon_box_draw                        (GtkWidget               *widget,
+                                                                      cairo_t                 *cr);
+
 static void                  sn_icon_box_remove                      (GtkContainer            *container,
                                                                       GtkWidget               *child);
 
@@ -70,6 +74,10 @@ struct _SnIconBox
 
   GtkWidget           *icon;
   GtkWidget           *overlay;
+
+  /* debug statistics, only taken with PANEL_DEBUG=systray */
+  guint                n_redraws;
+  gint64               changed_time;
 };
 
 G_DEFINE_TYPE (SnIconBox, sn_icon_box, GTK_TYPE_CONTAINER)
@@ -86,6 +94,7 @@ sn_icon_box_class_init (SnIconBoxClass *klass)
   widget_class->get_preferred_width = sn_icon_box_get_preferred_width;
   widget_class->get_preferred_height = sn_icon_box_get_preferred_height;
   widget_class->size_allocate = sn_icon_box_size_allocate;
+  widget_class->draw = sn_icon_box_draw;
 
   container_class = GTK_CONTAINER_CLASS (klass);
   container_class->remove = sn_icon_box_remove;
@@ -109,6 +118,9 @@ sn_icon_box_init (SnIconBox *box)
 
   box->icon = NULL;
   box->overlay = NULL;
+
+  box->n_redraws = 0;
+  box->changed_time = 0;
 }
 
 
@@ -339,12 +351,21 @@ sn_icon_box_icon_changed (GtkWidget *widget)
   gboolean      symbolic_icons;
 
   box = XFCE_SN_ICON_BOX (widget);
+
+  /* time from the first change to the paint that shows it */
+  if (box->changed_time == 0 && panel_debug_has_domain (PANEL_DEBUG_SYSTRAY))
+    box->changed_time = g_get_monotonic_time ();
+
   icon_theme = gtk_icon_theme_get_for_screen (gtk_widget_get_screen (GTK_WIDGET (widget)));
 
   sn_config_get_dimensions (box->config, &icon_size, NULL, NULL, NULL);
 
   symbolic_icons = sn_config_get_symbolic_icons (box->config);
 
+  /* let the item pick the pixmap closest to what we draw */
+  if (icon_size > 0)
+    sn_item_set_icon_size (box->item, icon_size * gtk_widget_get_scale_factor (widget));
+
   sn_item_get_icon (box->item, &theme_path,
                     &icon_name, &icon_pixbuf,
                     &overlay_icon_name, &overlay_icon_pixbuf);
@@ -450,3 +471,27 @@ sn_icon_box_size_allocate (GtkWidget     *widget,
   if (box->overlay != NULL)
     gtk_widget_size_allocate (box->overlay, allocation);
 }
+
+
+
+static gboolean
+sn_icon_box_draw (GtkWidget *widget,
+                  cairo_t   *cr)
+{
+  SnIconBox *box = XFCE_SN_ICON_BOX (widget);
+  gboolean   result;
+
+  result = GTK_WIDGET_CLASS (sn_icon_box_parent_class)->draw (widget, cr);
+
+  box->n_redraws++;
+  if (box->changed_time != 0)
+    {
+      panel_debug_filtered (PANEL_DEBUG_SYSTRAY,
+                            "%s: redraw %u, painted %" G_GINT64_FORMAT " us after the icon changed",
+                            sn_item_get_name (box->item), box->n_redraws,
+                            g_get_monotonic_time () - box->changed_time);
+      box->changed_time = 0;
+    }
+
+  return result;
+}
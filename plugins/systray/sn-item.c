@@ -25,6 +25,10 @@
 #include <string.h>
 #endif
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include <gio/gio.h>
 #ifdef HAVE_DBUSMENU
 #include <libdbusmenu-gtk/dbusmenu-gtk.h>
@@ -57,6 +61,16 @@ static void                  sn_item_get_all_properties_result       (GObject
                                                                       GAsyncResult            *res,
                                                                       gpointer                 user_data);
 
+static void                  sn_item_get_property_result             (GObject                 *source_object,
+                                                                      GAsyncResult            *res,
+                                                                      gpointer                 user_data);
+
+static void                  sn_item_update_property                 (SnItem                  *item,
+                                                                      const gchar             *name,
+                                                                      GVariant                *value);
+
+static void                  sn_item_emit_updates                    (SnItem                  *item);
+
 
 
 struct _SnItemClass
@@ -95,10 +109,18 @@ struct _SnItem
   GdkPixbuf           *attention_icon_pixbuf;
   GdkPixbuf           *overlay_icon_pixbuf;
   gchar               *icon_theme_path;
+  gint                 icon_size;
 
   gboolean             item_is_menu;
   gchar               *menu_object_path;
   GtkWidget           *cached_menu;
+
+  /* properties to fetch, calls in flight and the changes they found */
+  guint                pending_properties;
+  guint                refresh_timeout_id;
+  guint                n_calls;
+  guint                pending_updates;
+  guint                fetches_avoided;
 };
 
 G_DEFINE_TYPE (SnItem, sn_item, G_TYPE_OBJECT)
@@ -127,6 +149,93 @@ enum
 
 static guint sn_item_signals[LAST_SIGNAL] = { 0, };
 
+static GQuark sn_item_pixbuf_hash_quark = 0;
+
+
+
+/* delay between the first change signal of a burst and the fetch */
+#define SN_ITEM_REFRESH_DELAY (50)
+
+/* fetch everything with GetAll when more properties changed */
+#define SN_ITEM_MAX_GET_CALLS (4)
+
+enum
+{
+  SN_ITEM_PROPERTY_STATUS                  = 1 << 0,
+  SN_ITEM_PROPERTY_TITLE                   = 1 << 1,
+  SN_ITEM_PROPERTY_TOOLTIP                 = 1 << 2,
+  SN_ITEM_PROPERTY_ITEM_IS_MENU            = 1 << 3,
+  SN_ITEM_PROPERTY_MENU                    = 1 << 4,
+  SN_ITEM_PROPERTY_ICON_THEME_PATH         = 1 << 5,
+  SN_ITEM_PROPERTY_ICON_NAME               = 1 << 6,
+  SN_ITEM_PROPERTY_ICON_PIXMAP             = 1 << 7,
+  SN_ITEM_PROPERTY_ICON_DESC               = 1 << 8,
+  SN_ITEM_PROPERTY_ATTENTION_ICON_NAME     = 1 << 9,
+  SN_ITEM_PROPERTY_ATTENTION_ICON_PIXMAP   = 1 << 10,
+  SN_ITEM_PROPERTY_ATTENTION_DESC          = 1 << 11,
+  SN_ITEM_PROPERTY_OVERLAY_ICON_NAME       = 1 << 12,
+  SN_ITEM_PROPERTY_OVERLAY_ICON_PIXMAP     = 1 << 13,
+  SN_ITEM_PROPERTY_ALL                     = (1 << 14) - 1
+};
+
+/* in the order of the property flags above */
+static const gchar *sn_item_property_names[] =
+{
+  "Status",
+  "Title",
+  "ToolTip",
+  "ItemIsMenu",
+  "Menu",
+  "IconThemePath",
+  "IconName",
+  "IconPixmap",
+  "IconAccessibleDesc",
+  "AttentionIconName",
+  "AttentionIconPixmap",
+  "AttentionAccessibleDesc",
+  "OverlayIconName",
+  "OverlayIconPixmap"
+};
+
+static const struct
+{
+  const gchar *signal_name;
+  guint        properties;
+}
+sn_item_signal_properties[] =
+{
+  { "NewTitle", SN_ITEM_PROPERTY_TITLE },
+  { "NewIcon", SN_ITEM_PROPERTY_ICON_NAME
+               | SN_ITEM_PROPERTY_ICON_PIXMAP
+               | SN_ITEM_PROPERTY_ICON_DESC },
+  { "NewAttentionIcon", SN_ITEM_PROPERTY_ATTENTION_ICON_NAME
+                        | SN_ITEM_PROPERTY_ATTENTION_ICON_PIXMAP
+                        | SN_ITEM_PROPERTY_ATTENTION_DESC },
+  { "NewOverlayIcon", SN_ITEM_PROPERTY_OVERLAY_ICON_NAME
+                      | SN_ITEM_PROPERTY_OVERLAY_ICON_PIXMAP },
+  { "NewToolTip", SN_ITEM_PROPERTY_TOOLTIP },
+  { "NewStatus", SN_ITEM_PROPERTY_STATUS },
+  { "NewIconThemePath", SN_ITEM_PROPERTY_ICON_THEME_PATH },
+  { "NewMenu", SN_ITEM_PROPERTY_MENU | SN_ITEM_PROPERTY_ITEM_IS_MENU }
+};
+
+enum
+{
+  SN_ITEM_UPDATE_EXPOSED = 1 << 0,
+  SN_ITEM_UPDATE_TOOLTIP = 1 << 1,
+  SN_ITEM_UPDATE_ICON    = 1 << 2,
+  SN_ITEM_UPDATE_MENU    = 1 << 3
+};
+
+
+
+typedef struct
+{
+  SnItem              *item;
+  guint                property;
+}
+PropertyCallContext;
+
 
 
 typedef struct
@@ -249,6 +358,8 @@ sn_item_class_init (SnItemClass *klass)
                   0, NULL, NULL,
                   g_cclosure_marshal_VOID__VOID,
                   G_TYPE_NONE, 0);
+
+  sn_item_pixbuf_hash_quark = g_quark_from_static_string ("sn-item-pixbuf-hash");
 }
 
 
@@ -283,12 +394,19 @@ sn_item_init (SnItem *item)
   item->attention_icon_pixbuf = NULL;
   item->overlay_icon_pixbuf = NULL;
   item->icon_theme_path = NULL;
+  item->icon_size = 0;
 
   /* Ubuntu indicators don't support activate action and
      don't provide this option so it's enabled by default. */
   item->item_is_menu = TRUE;
   item->menu_object_path = NULL;
   item->cached_menu = NULL;
+
+  item->pending_properties = 0;
+  item->refresh_timeout_id = 0;
+  item->n_calls = 0;
+  item->pending_updates = 0;
+  item->fetches_avoided = 0;
 }
 
 
@@ -298,6 +416,9 @@ sn_item_finalize (GObject *object)
 {
   SnItem *item = XFCE_SN_ITEM (object);
 
+  if (item->refresh_timeout_id != 0)
+    g_source_remove (item->refresh_timeout_id);
+
   g_cancellable_cancel (item->cancellable);
   g_object_unref (item->cancellable);
 
@@ -534,6 +655,150 @@ sn_item_start (SnItem *item)
 
 
 
+static void
+sn_item_fetch_properties (SnItem *item)
+{
+  PropertyCallContext *context;
+  guint                properties;
+  guint                n_properties = 0;
+  guint                i;
+
+  properties = item->pending_properties;
+  item->pending_properties = 0;
+
+  if (properties == 0 || item->properties_proxy == NULL)
+    return;
+
+  for (i = 0; i < G_N_ELEMENTS (sn_item_property_names); i++)
+    if (properties & (1 << i))
+      n_properties++;
+
+  panel_debug_filtered (PANEL_DEBUG_SYSTRAY,
+                        "%s: Fetching %u properties for item '%s', %u fetches avoided",
+                        G_STRLOC, n_properties, item->id, item->fetches_avoided);
+
+  if (!item->initialized || n_properties > SN_ITEM_MAX_GET_CALLS)
+    {
+      item->n_calls++;
+      g_dbus_proxy_call (item->properties_proxy,
+                         "GetAll",
+                         g_variant_new ("(s)", "org.kde.StatusNotifierItem"),
+                         G_DBUS_CALL_FLAGS_NONE,
+                         -1,
+                         item->cancellable,
+                         sn_item_get_all_properties_result,
+                         item);
+      return;
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (sn_item_property_names); i++)
+    {
+      if (!(properties & (1 << i)))
+        continue;
+
+      context = g_slice_new (PropertyCallContext);
+      context->item = item;
+      context->property = i;
+
+      item->n_calls++;
+      g_dbus_proxy_call (item->properties_proxy,
+                         "Get",
+                         g_variant_new ("(ss)", "org.kde.StatusNotifierItem",
+                                        sn_item_property_names[i]),
+                         G_DBUS_CALL_FLAGS_NONE,
+                         -1,
+                         item->cancellable,
+                         sn_item_get_property_result,
+                         context);
+    }
+}
+
+
+
+static gboolean
+sn_item_refresh_timeout (gpointer user_data)
+{
+  sn_item_fetch_properties (user_data);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+sn_item_refresh_timeout_destroyed (gpointer user_data)
+{
+  SnItem *item = user_data;
+
+  item->refresh_timeout_id = 0;
+}
+
+
+
+static void
+sn_item_schedule_refresh (SnItem *item)
+{
+  /* the delay is not extended by later signals, so constantly animated
+   * icons are still refreshed at a steady rate */
+  if (item->refresh_timeout_id == 0)
+    item->refresh_timeout_id =
+      g_timeout_add_full (G_PRIORITY_DEFAULT, SN_ITEM_REFRESH_DELAY,
+                          sn_item_refresh_timeout, item,
+                          sn_item_refresh_timeout_destroyed);
+}
+
+
+
+static void
+sn_item_request_properties (SnItem   *item,
+                            guint     properties,
+                            gboolean  immediately)
+{
+  /* leave if the properties proxy has not yet been created */
+  if (item->properties_proxy == NULL)
+    return;
+
+  /* merged into a fetch that is already scheduled or running */
+  if (item->refresh_timeout_id != 0 || item->n_calls > 0)
+    item->fetches_avoided++;
+
+  item->pending_properties |= properties;
+
+  /* at most one request in flight, the rest is fetched when it finishes */
+  if (item->n_calls > 0)
+    return;
+
+  if (immediately)
+    {
+      if (item->refresh_timeout_id != 0)
+        g_source_remove (item->refresh_timeout_id);
+      sn_item_fetch_properties (item);
+    }
+  else
+    {
+      sn_item_schedule_refresh (item);
+    }
+}
+
+
+
+static void
+sn_item_call_finished (SnItem *item)
+{
+  g_return_if_fail (item->n_calls > 0);
+
+  if (--item->n_calls > 0)
+    return;
+
+  /* schedule before emitting, handlers may drop the last reference */
+  if (item->pending_properties != 0)
+    sn_item_schedule_refresh (item);
+
+  sn_item_emit_updates (item);
+}
+
+
+
 void
 sn_item_invalidate (SnItem   *item,
                     gboolean  force_update)
@@ -554,14 +819,7 @@ sn_item_invalidate (SnItem   *item,
         }
     }
 
-  g_dbus_proxy_call (item->properties_proxy,
-                     "GetAll",
-                     g_variant_new ("(s)", "org.kde.StatusNotifierItem"),
-                     G_DBUS_CALL_FLAGS_NONE,
-                     -1,
-                     item->cancellable,
-                     sn_item_get_all_properties_result,
-                     item);
+  sn_item_request_properties (item, SN_ITEM_PROPERTY_ALL, TRUE);
 }
 
 
@@ -573,7 +831,45 @@ sn_item_signal_received (GDBusProxy *proxy,
                          GVariant   *parameters,
                          gpointer    user_data)
 {
-  sn_item_invalidate (user_data, FALSE);
+  SnItem   *item = user_data;
+  GVariant *status;
+  guint     i;
+
+  /* NewStatus carries the new value, no need to ask for it */
+  if (item->initialized
+      && g_strcmp0 (signal_name, "NewStatus") == 0
+      && g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(s)")))
+    {
+      item->fetches_avoided++;
+      status = g_variant_get_child_value (parameters, 0);
+      sn_item_update_property (item, "Status", status);
+      g_variant_unref (status);
+
+      /* otherwise emitted with the results of the running request */
+      if (item->n_calls == 0)
+        sn_item_emit_updates (item);
+      return;
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (sn_item_signal_properties); i++)
+    {
+      if (g_strcmp0 (signal_name, sn_item_signal_properties[i].signal_name) == 0)
+        {
+          sn_item_request_properties (item, sn_item_signal_properties[i].properties, FALSE);
+          return;
+        }
+    }
+
+  /* unknown signal, refresh everything */
+  sn_item_request_properties (item, SN_ITEM_PROPERTY_ALL, FALSE);
+}
+
+
+
+static const guint64 *
+sn_item_pixbuf_get_hash (GdkPixbuf *pixbuf)
+{
+  return g_object_get_qdata (G_OBJECT (pixbuf), sn_item_pixbuf_hash_quark);
 }
 
 
@@ -582,9 +878,7 @@ static gboolean
 sn_item_pixbuf_equals (GdkPixbuf *p1,
                        GdkPixbuf *p2)
 {
-  guchar *p1p, *p2p;
-  guint   p1l, p2l;
-  guint   i;
+  const guint64 *h1, *h2;
 
   if (p1 == p2 || (p1 == NULL && p2 == NULL))
     return TRUE;
@@ -592,17 +886,83 @@ sn_item_pixbuf_equals (GdkPixbuf *p1,
   if ((p1 == NULL) != (p2 == NULL))
     return FALSE;
 
-  p1p = gdk_pixbuf_get_pixels_with_length (p1, &p1l);
-  p2p = gdk_pixbuf_get_pixels_with_length (p2, &p2l);
-
-  if (p1l != p2l)
+  if (gdk_pixbuf_get_width (p1) != gdk_pixbuf_get_width (p2)
+      || gdk_pixbuf_get_height (p1) != gdk_pixbuf_get_height (p2))
     return FALSE;
 
-  for (i = 0; i < p1l; i++)
-    if (p1p[i] != p2p[i])
-      return FALSE;
+  /* all pixmap pixbufs carry the hash of the data they were decoded from */
+  h1 = sn_item_pixbuf_get_hash (p1);
+  h2 = sn_item_pixbuf_get_hash (p2);
+
+  return h1 != NULL && h2 != NULL && *h1 == *h2;
+}
+
+
+
+static guint64
+sn_item_pixmap_hash (const guchar *data,
+                     gsize         size,
+                     gint          width,
+                     gint          height)
+{
+  guint64 hash = 14695981039346656037ULL;
+  guint64 word;
+  guint32 tail;
+  gsize   i;
+
+  /* FNV-1a over 64 bit words, seeded with the dimensions */
+  hash = (hash ^ (guint64) width) * 1099511628211ULL;
+  hash = (hash ^ (guint64) height) * 1099511628211ULL;
 
-  return TRUE;
+  for (i = 0; i + sizeof (word) <= size; i += sizeof (word))
+    {
+      memcpy (&word, data + i, sizeof (word));
+      hash = (hash ^ word) * 1099511628211ULL;
+    }
+
+  /* the size is a multiple of 4, so there is at most one pixel left */
+  if (i < size)
+    {
+      memcpy (&tail, data + i, sizeof (tail));
+      hash = (hash ^ tail) * 1099511628211ULL;
+    }
+
+  return hash ^ (hash >> 32);
+}
+
+
+
+static void
+sn_item_argb_to_rgba (guchar       *dest,
+                      const guchar *src,
+                      gsize         n_pixels)
+{
+  guint32 pixel;
+  gsize   i = 0;
+
+  /* bytes A, R, G, B become R, G, B, A, which is a rotation of the
+   * native 32 bit word by one byte */
+#if defined (__SSE2__) && G_BYTE_ORDER == G_LITTLE_ENDIAN
+  __m128i v;
+
+  for (; i + 4 <= n_pixels; i += 4)
+    {
+      v = _mm_loadu_si128 ((const __m128i *) (src + 4 * i));
+      v = _mm_or_si128 (_mm_srli_epi32 (v, 8), _mm_slli_epi32 (v, 24));
+      _mm_storeu_si128 ((__m128i *) (dest + 4 * i), v);
+    }
+#endif
+
+  for (; i < n_pixels; i++)
+    {
+      memcpy (&pixel, src + 4 * i, sizeof (pixel));
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+      pixel = (pixel >> 8) | (pixel << 24);
+#else
+      pixel = (pixel << 8) | (pixel >> 24);
+#endif
+      memcpy (dest + 4 * i, &pixel, sizeof (pixel));
+    }
 }
 
 
@@ -617,17 +977,23 @@ sn_item_free (guchar   *pixels,
 
 
 static GdkPixbuf *
-sn_item_extract_pixbuf (GVariant *variant)
+sn_item_extract_pixbuf (GVariant  *variant,
+                        gint       icon_size,
+                        GdkPixbuf *current)
 {
   GVariantIter  *iter;
   gint           width, height;
   gint           lwidth = 0, lheight = 0;
   GVariant      *array_value;
-  gconstpointer  data;
-  guchar        *array = NULL;
+  GVariant      *best_value = NULL;
+  gboolean       covers, best_covers = FALSE;
+  const guchar  *data;
+  guchar        *pixels;
   gsize          size;
-  guchar         alpha;
-  gint           i;
+  guint64        hash;
+  guint64       *stored_hash;
+  const guint64 *current_hash;
+  GdkPixbuf     *pixbuf;
 
   if (variant == NULL)
     return NULL;
@@ -637,71 +1003,77 @@ sn_item_extract_pixbuf (GVariant *variant)
   if (iter == NULL)
     return NULL;
 
-  while (g_variant_iter_loop (iter, "(ii@ay)", &width, &height, &array_value))
+  while (g_variant_iter_next (iter, "(ii@ay)", &width, &height, &array_value))
     {
-      if (width > 0 && height > 0 && array_value != NULL &&
-          width * height > lwidth * lheight)
+      /* sanity check */
+      if (width > 0 && height > 0
+          && g_variant_get_size (array_value) == 4 * (gsize) width * (gsize) height
+          && g_variant_get_data (array_value) != NULL)
         {
-          size = g_variant_get_size (array_value);
-          /* sanity check */
-          if (size == (gsize)(4 * width * height))
+          /* find the smallest image that covers the icon size, or the
+           * largest one if none does */
+          covers = icon_size > 0 && MAX (width, height) >= icon_size;
+          if (best_value == NULL
+              || (covers && (!best_covers || width * height < lwidth * lheight))
+              || (!covers && !best_covers && width * height > lwidth * lheight))
             {
-              /* find the largest image */
-              data = g_variant_get_data (array_value);
-              if (data != NULL)
-                {
-                  if (array != NULL)
-                    g_free (array);
-#if GLIB_CHECK_VERSION(2, 68, 0)
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-                  array = g_memdup2 (data, size);
-G_GNUC_END_IGNORE_DEPRECATIONS
-#else
-                  array = g_memdup (data, size);
-#endif
-                  lwidth = width;
-                  lheight = height;
-                }
+              if (best_value != NULL)
+                g_variant_unref (best_value);
+              best_value = g_variant_ref (array_value);
+              best_covers = covers;
+              lwidth = width;
+              lheight = height;
             }
         }
+
+      g_variant_unref (array_value);
     }
 
   g_variant_iter_free (iter);
 
-  if (array != NULL)
+  if (best_value == NULL)
+    return NULL;
+
+  data = g_variant_get_data (best_value);
+  size = g_variant_get_size (best_value);
+  hash = sn_item_pixmap_hash (data, size, lwidth, lheight);
+
+  /* apps resend identical pixmaps a lot, don't decode those again */
+  if (current != NULL
+      && gdk_pixbuf_get_width (current) == lwidth
+      && gdk_pixbuf_get_height (current) == lheight)
     {
-      /* argb to rgba */
-      for (i = 0; i < 4 * lwidth * lheight; i += 4)
+      current_hash = sn_item_pixbuf_get_hash (current);
+      if (current_hash != NULL && *current_hash == hash)
         {
-          alpha = array[i];
-          array[i] = array[i + 1];
-          array[i + 1] = array[i + 2];
-          array[i + 2] = array[i + 3];
-          array[i + 3] = alpha;
+          g_variant_unref (best_value);
+          return g_object_ref (current);
         }
-
-      return gdk_pixbuf_new_from_data (array, GDK_COLORSPACE_RGB,
-                                       TRUE, 8, lwidth, lheight, 4 * lwidth,
-                                       sn_item_free, NULL);
     }
 
-  return NULL;
+  /* convert straight from the message data, which stays owned by the variant */
+  pixels = g_malloc (size);
+  sn_item_argb_to_rgba (pixels, data, size / 4);
+  g_variant_unref (best_value);
+
+  pixbuf = gdk_pixbuf_new_from_data (pixels, GDK_COLORSPACE_RGB,
+                                     TRUE, 8, lwidth, lheight, 4 * lwidth,
+                                     sn_item_free, NULL);
+  stored_hash = g_new (guint64, 1);
+  *stored_hash = hash;
+  g_object_set_qdata_full (G_OBJECT (pixbuf), sn_item_pixbuf_hash_quark,
+                           stored_hash, g_free);
+
+  return pixbuf;
 }
 
 
 
 static void
-sn_item_get_all_properties_result (GObject      *source_object,
-                                   GAsyncResult *res,
-                                   gpointer      user_data)
+sn_item_update_property (SnItem      *item,
+                         const gchar *name,
+                         GVariant    *value)
 {
-  SnItem       *item = user_data;
-  GError       *error = NULL;
-  GVariant     *properties;
-  GVariantIter *iter = NULL;
-  const gchar  *name;
-  GVariant     *value;
-
   const gchar  *cstr_val1;
   gchar        *str_val1;
   gchar        *str_val2;
@@ -713,13 +1085,6 @@ sn_item_get_all_properties_result (GObject      *source_object,
   gboolean      update_icon = FALSE;
   gboolean      update_menu = FALSE;
 
-  properties = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
-  if (properties == NULL)
-    {
-      free_error_and_return_if_cancelled (error);
-      return;
-    }
-
   #define string_empty_null(s) ((s) != NULL ? (s) : "")
 
   #define update_new_string(val, entry, update_what) \
@@ -745,126 +1110,140 @@ sn_item_get_all_properties_result (GObject      *source_object,
       g_object_unref (val); \
     }
 
-  if (g_variant_check_format_string (properties, "(a{sv})", FALSE) == FALSE)
+  if (!g_strcmp0 (name, "Id"))
     {
-      g_warning ("Could not parse properties for StatusNotifierItem.");
-      return;
+      if (item->id == NULL)
+        item->id = g_variant_dup_string (value, NULL);
+    }
+  else if (!g_strcmp0 (name, "Status"))
+    {
+      cstr_val1 = g_variant_get_string (value, NULL);
+      update_new_string (cstr_val1, status, update_icon);
+      bool_val1 = g_strcmp0 (item->status, "Passive") != 0;
+      if (bool_val1 != item->exposed)
+        {
+          item->exposed = bool_val1;
+          update_exposed = TRUE;
+        }
+    }
+  else if (!g_strcmp0 (name, "Title"))
+    {
+      cstr_val1 = g_variant_get_string (value, NULL);
+      update_new_string (cstr_val1, title, update_tooltip);
+    }
+  else if (!g_strcmp0 (name, "ToolTip"))
+    {
+      cstr_val1 = g_variant_get_type_string (value);
+      if (!g_strcmp0 (cstr_val1, "(sa(iiay)ss)"))
+        {
+          g_variant_get (value, "(sa(iiay)ss)", NULL, NULL, &str_val1, &str_val2);
+          update_new_string (str_val1, tooltip_title, update_tooltip);
+          update_new_string (str_val2, tooltip_subtitle, update_tooltip);
+          g_free (str_val1);
+          g_free (str_val2);
+        }
+      else if (!g_strcmp0 (cstr_val1, "s"))
+        {
+          cstr_val1 = g_variant_get_string (value, NULL);
+          update_new_string (cstr_val1, tooltip_title, update_tooltip);
+          update_new_string (NULL, tooltip_subtitle, update_tooltip);
+        }
+      else
+        {
+          update_new_string (NULL, tooltip_title, update_tooltip);
+          update_new_string (NULL, tooltip_subtitle, update_tooltip);
+        }
+    }
+  else if (!g_strcmp0 (name, "ItemIsMenu"))
+    {
+      bool_val1 = g_variant_get_boolean (value);
+      if (bool_val1 != item->item_is_menu)
+        {
+          item->item_is_menu = bool_val1;
+          update_menu = TRUE;
+        }
+    }
+  else if (!g_strcmp0 (name, "Menu"))
+    {
+      cstr_val1 = g_variant_get_string (value, NULL);
+      update_new_string (cstr_val1, menu_object_path, update_menu);
+    }
+  else if (!g_strcmp0 (name, "IconThemePath"))
+    {
+      cstr_val1 = g_variant_get_string (value, NULL);
+      update_new_string (cstr_val1, icon_theme_path, update_icon);
+    }
+  else if (!g_strcmp0 (name, "IconName"))
+    {
+      cstr_val1 = g_variant_get_string (value, NULL);
+      update_new_string (cstr_val1, icon_name, update_icon);
+    }
+  else if (!g_strcmp0 (name, "IconPixmap"))
+    {
+      pb_val1 = sn_item_extract_pixbuf (value, item->icon_size, item->icon_pixbuf);
+      update_new_pixbuf (pb_val1, icon_pixbuf, update_icon);
+    }
+  else if (!g_strcmp0 (name, "IconAccessibleDesc"))
+    {
+      cstr_val1 = g_variant_get_string (value, NULL);
+      update_new_string (cstr_val1, icon_desc, update_tooltip);
+    }
+  else if (!g_strcmp0 (name, "AttentionIconName"))
+    {
+      cstr_val1 = g_variant_get_string (value, NULL);
+      update_new_string (cstr_val1, attention_icon_name, update_icon);
+    }
+  else if (!g_strcmp0 (name, "AttentionIconPixmap"))
+    {
+      pb_val1 = sn_item_extract_pixbuf (value, item->icon_size, item->attention_icon_pixbuf);
+      update_new_pixbuf (pb_val1, attention_icon_pixbuf, update_icon);
+    }
+  else if (!g_strcmp0 (name, "AttentionAccessibleDesc"))
+    {
+      cstr_val1 = g_variant_get_string (value, NULL);
+      update_new_string (cstr_val1, attention_desc, update_tooltip);
+    }
+  else if (!g_strcmp0 (name, "OverlayIconName"))
+    {
+      cstr_val1 = g_variant_get_string (value, NULL);
+      update_new_string (cstr_val1, overlay_icon_name, update_icon);
+    }
+  else if (!g_strcmp0 (name, "OverlayIconPixmap"))
+    {
+      pb_val1 = sn_item_extract_pixbuf (value, item->icon_size, item->overlay_icon_pixbuf);
+      update_new_pixbuf (pb_val1, overlay_icon_pixbuf, update_icon);
     }
-  g_variant_get (properties, "(a{sv})", &iter);
-
-  while (g_variant_iter_loop (iter, "{&sv}", &name, &value)) {
-    if (!g_strcmp0 (name, "Id"))
-      {
-        if (item->id == NULL)
-          item->id = g_variant_dup_string (value, NULL);
-      }
-    else if (!g_strcmp0 (name, "Status"))
-      {
-        cstr_val1 = g_variant_get_string (value, NULL);
-        update_new_string (cstr_val1, status, update_icon);
-        bool_val1 = g_strcmp0 (item->status, "Passive") != 0;
-        if (bool_val1 != item->exposed)
-          {
-            item->exposed = bool_val1;
-            update_exposed = TRUE;
-          }
-      }
-    else if (!g_strcmp0 (name, "Title"))
-      {
-        cstr_val1 = g_variant_get_string (value, NULL);
-        update_new_string (cstr_val1, title, update_tooltip);
-      }
-    else if (!g_strcmp0 (name, "ToolTip"))
-      {
-        cstr_val1 = g_variant_get_type_string (value);
-        if (!g_strcmp0 (cstr_val1, "(sa(iiay)ss)"))
-          {
-            g_variant_get (value, "(sa(iiay)ss)", NULL, NULL, &str_val1, &str_val2);
-            update_new_string (str_val1, tooltip_title, update_tooltip);
-            update_new_string (str_val2, tooltip_subtitle, update_tooltip);
-            g_free (str_val1);
-            g_free (str_val2);
-          }
-        else if (!g_strcmp0 (cstr_val1, "s"))
-          {
-            cstr_val1 = g_variant_get_string (value, NULL);
-            update_new_string (cstr_val1, tooltip_title, update_tooltip);
-            update_new_string (NULL, tooltip_subtitle, update_tooltip);
-          }
-        else
-          {
-            update_new_string (NULL, tooltip_title, update_tooltip);
-            update_new_string (NULL, tooltip_subtitle, update_tooltip);
-          }
-      }
-    else if (!g_strcmp0 (name, "ItemIsMenu"))
-      {
-        bool_val1 = g_variant_get_boolean (value);
-        if (bool_val1 != item->item_is_menu)
-          {
-            item->item_is_menu = bool_val1;
-            update_menu = TRUE;
-          }
-      }
-    else if (!g_strcmp0 (name, "Menu"))
-      {
-        cstr_val1 = g_variant_get_string (value, NULL);
-        update_new_string (cstr_val1, menu_object_path, update_menu);
-      }
-    else if (!g_strcmp0 (name, "IconThemePath"))
-      {
-        cstr_val1 = g_variant_get_string (value, NULL);
-        update_new_string (cstr_val1, icon_theme_path, update_icon);
-      }
-    else if (!g_strcmp0 (name, "IconName"))
-      {
-        cstr_val1 = g_variant_get_string (value, NULL);
-        update_new_string (cstr_val1, icon_name, update_icon);
-      }
-    else if (!g_strcmp0 (name, "IconPixmap"))
-      {
-        pb_val1 = sn_item_extract_pixbuf (value);
-        update_new_pixbuf (pb_val1, icon_pixbuf, update_icon);
-      }
-    else if (!g_strcmp0 (name, "IconAccessibleDesc"))
-      {
-        cstr_val1 = g_variant_get_string (value, NULL);
-        update_new_string (cstr_val1, icon_desc, update_tooltip);
-      }
-    else if (!g_strcmp0 (name, "AttentionIconName"))
-      {
-        cstr_val1 = g_variant_get_string (value, NULL);
-        update_new_string (cstr_val1, attention_icon_name, update_icon);
-      }
-    else if (!g_strcmp0 (name, "AttentionIconPixmap"))
-      {
-        pb_val1 = sn_item_extract_pixbuf (value);
-        update_new_pixbuf (pb_val1, attention_icon_pixbuf, update_icon);
-      }
-    else if (!g_strcmp0 (name, "AttentionAccessibleDesc"))
-      {
-        cstr_val1 = g_variant_get_string (value, NULL);
-        update_new_string (cstr_val1, attention_desc, update_tooltip);
-      }
-    else if (!g_strcmp0 (name, "OverlayIconName"))
-      {
-        cstr_val1 = g_variant_get_string (value, NULL);
-        update_new_string (cstr_val1, overlay_icon_name, update_icon);
-      }
-    else if (!g_strcmp0 (name, "OverlayIconPixmap"))
-      {
-        pb_val1 = sn_item_extract_pixbuf (value);
-        update_new_pixbuf (pb_val1, overlay_icon_pixbuf, update_icon);
-      }
-  }
-
-  g_variant_iter_free (iter);
-  g_variant_unref (properties);
 
   #undef update_new_pixbuf
   #undef update_new_string
   #undef string_empty_null
 
+  if (update_exposed)
+    item->pending_updates |= SN_ITEM_UPDATE_EXPOSED;
+  if (update_tooltip)
+    item->pending_updates |= SN_ITEM_UPDATE_TOOLTIP;
+  if (update_icon)
+    item->pending_updates |= SN_ITEM_UPDATE_ICON;
+  if (update_menu)
+    item->pending_updates |= SN_ITEM_UPDATE_MENU;
+}
+
+
+
+static void
+sn_item_emit_updates (SnItem *item)
+{
+  gboolean update_exposed;
+  gboolean update_tooltip;
+  gboolean update_icon;
+  gboolean update_menu;
+
+  update_exposed = (item->pending_updates & SN_ITEM_UPDATE_EXPOSED) != 0;
+  update_tooltip = (item->pending_updates & SN_ITEM_UPDATE_TOOLTIP) != 0;
+  update_icon = (item->pending_updates & SN_ITEM_UPDATE_ICON) != 0;
+  update_menu = (item->pending_updates & SN_ITEM_UPDATE_MENU) != 0;
+  item->pending_updates = 0;
+
   if (!item->initialized)
     {
       if (item->id != NULL)
@@ -910,6 +1289,82 @@ sn_item_get_all_properties_result (GObject      *source_object,
 
 
 
+static void
+sn_item_get_all_properties_result (GObject      *source_object,
+                                   GAsyncResult *res,
+                                   gpointer      user_data)
+{
+  SnItem       *item = user_data;
+  GError       *error = NULL;
+  GVariant     *properties;
+  GVariantIter *iter = NULL;
+  const gchar  *name;
+  GVariant     *value;
+
+  properties = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+  if (properties == NULL)
+    {
+      free_error_and_return_if_cancelled (error);
+      sn_item_call_finished (item);
+      return;
+    }
+
+  if (g_variant_check_format_string (properties, "(a{sv})", FALSE) == FALSE)
+    {
+      g_warning ("Could not parse properties for StatusNotifierItem.");
+      g_variant_unref (properties);
+      sn_item_call_finished (item);
+      return;
+    }
+  g_variant_get (properties, "(a{sv})", &iter);
+
+  while (g_variant_iter_loop (iter, "{&sv}", &name, &value))
+    sn_item_update_property (item, name, value);
+
+  g_variant_iter_free (iter);
+  g_variant_unref (properties);
+
+  sn_item_call_finished (item);
+}
+
+
+
+static void
+sn_item_get_property_result (GObject      *source_object,
+                             GAsyncResult *res,
+                             gpointer      user_data)
+{
+  PropertyCallContext *context = user_data;
+  SnItem              *item = context->item;
+  const gchar         *name = sn_item_property_names[context->property];
+  GError              *error = NULL;
+  GVariant            *result;
+  GVariant            *value;
+
+  g_slice_free (PropertyCallContext, context);
+
+  result = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+  if (result == NULL)
+    {
+      /* also the answer of items that do not implement the property */
+      free_error_and_return_if_cancelled (error);
+    }
+  else
+    {
+      if (g_variant_is_of_type (result, G_VARIANT_TYPE ("(v)")))
+        {
+          g_variant_get (result, "(v)", &value);
+          sn_item_update_property (item, name, value);
+          g_variant_unref (value);
+        }
+      g_variant_unref (result);
+    }
+
+  sn_item_call_finished (item);
+}
+
+
+
 const gchar *
 sn_item_get_name (SnItem *item)
 {
@@ -958,6 +1413,30 @@ sn_item_get_icon (SnItem       *item,
 
 
 
+void
+sn_item_set_icon_size (SnItem *item,
+                       gint    icon_size)
+{
+  g_return_if_fail (XFCE_IS_SN_ITEM (item));
+
+  if (item->icon_size == icon_size)
+    return;
+
+  item->icon_size = icon_size;
+
+  /* pixmaps were picked for the previous size, fetch them again */
+  if (item->icon_pixbuf != NULL
+      || item->attention_icon_pixbuf != NULL
+      || item->overlay_icon_pixbuf != NULL)
+    sn_item_request_properties (item,
+                                SN_ITEM_PROPERTY_ICON_PIXMAP
+                                | SN_ITEM_PROPERTY_ATTENTION_ICON_PIXMAP
+                                | SN_ITEM_PROPERTY_OVERLAY_ICON_PIXMAP,
+                                FALSE);
+}
+
+
+
 void
 sn_item_get_tooltip (SnItem       *item,
                      const gchar **title,
@@ -49,6 +49,9 @@ void                   sn_item_get_icon                        (SnItem
                                                                 const gchar            **overlay_icon_name,
                                                                 GdkPixbuf              **overlay_icon_pixbuf);
 
+void                   sn_item_set_icon_size                   (SnItem                  *item,
+                                                                gint                     icon_size);
+
 void                   sn_item_get_tooltip                     (SnItem                  *item,
 	                                                           const gchar            **title,
 	                                                           const gchar            **subtitle);
@@ -119,6 +119,9 @@ struct _SystrayManager
   /* orientation of the tray */
   GtkOrientation  orientation;
 
+  /* redirect all new icons offscreen */
+  guint           offscreen : 1;
+
   /* list of pending messages */
   GSList         *messages;
 
@@ -223,6 +226,7 @@ systray_manager_init (SystrayManager *manager)
 {
   manager->invisible = NULL;
   manager->orientation = GTK_ORIENTATION_HORIZONTAL;
+  manager->offscreen = FALSE;
   manager->messages = NULL;
   manager->sockets = g_hash_table_new (NULL, NULL);
 
@@ -687,7 +691,7 @@ systray_manager_handle_dock_request (SystrayManager      *manager,
 
   /* create the socket */
   screen = gtk_widget_get_screen (manager->invisible);
-  socket = systray_socket_new (screen, window);
+  socket = systray_socket_new (screen, window, manager->offscreen);
   if (G_UNLIKELY (socket == NULL))
     return;
 
@@ -883,6 +887,19 @@ systray_manager_set_orientation (SystrayManager *manager,
 
 
 
+void
+systray_manager_set_offscreen (SystrayManager *manager,
+                               gboolean        offscreen)
+{
+  panel_return_if_fail (XFCE_IS_SYSTRAY_MANAGER (manager));
+
+  /* only applies to icons docked from now on, the sockets of the
+   * current icons are already realized */
+  manager->offscreen = !!offscreen;
+}
+
+
+
 /**
  * tray messages
  **/
@@ -69,5 +69,8 @@ void            systray_manager_set_colors           (SystrayManager *manager,
 void            systray_manager_set_orientation      (SystrayManager      *manager,
                                                       GtkOrientation       orientation);
 
+void            systray_manager_set_offscreen        (SystrayManager      *manager,
+                                                      gboolean             offscreen);
+
 
 #endif /* !__SYSTRAY_MANAGER_H__ */
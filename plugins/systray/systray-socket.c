@@ -235,7 +235,8 @@ systray_socket_draw (GtkWidget *widget,
 
 GtkWidget *
 systray_socket_new (GdkScreen       *screen,
-                    Window           window)
+                    Window           window,
+                    gboolean         offscreen)
 {
   SystraySocket     *socket;
   GdkDisplay        *display;
@@ -276,9 +277,15 @@ systray_socket_new (GdkScreen       *screen,
 G_GNUC_BEGIN_IGNORE_DEPRECATIONS
   supports_composite = gdk_display_supports_composite (gdk_screen_get_display (screen));
 G_GNUC_END_IGNORE_DEPRECATIONS
-  if (red_prec + blue_prec + green_prec < gdk_visual_get_depth (visual)
+  if ((red_prec + blue_prec + green_prec < gdk_visual_get_depth (visual)
+       || offscreen)
       && supports_composite)
-    socket->is_composited = TRUE;
+    {
+      /* the socket window is redirected offscreen by gdk, damage of the
+       * client only invalidates the icon's area in the box, which paints
+       * it in systray_plugin_box_draw_icon() */
+      socket->is_composited = TRUE;
+    }
 
   return GTK_WIDGET (socket);
 }
@@ -309,15 +316,13 @@ systray_socket_force_redraw (SystraySocket *socket)
       xev.xexpose.height = allocation.height;
       xev.xexpose.count = 0;
 
+      /* no need to sync, gdk ignores the asynchronous errors of the
+       * requests made in the trap without a round-trip */
       gdk_x11_display_error_trap_push (display);
       XSendEvent (GDK_DISPLAY_XDISPLAY (display),
                   xev.xexpose.window,
                   False, ExposureMask,
                   &xev);
-      /* We have to sync to reliably catch errors from the XSendEvent(),
-       * since that is asynchronous.
-       */
-      XSync (GDK_DISPLAY_XDISPLAY (display), False);
       gdk_x11_display_error_trap_pop_ignored (display);
     }
 }
@@ -40,7 +40,8 @@ GType            systray_socket_get_type      (void) G_GNUC_CONST;
 void             systray_socket_register_type (GTypeModule     *type_module);
 
 GtkWidget       *systray_socket_new           (GdkScreen       *screen,
-                                               Window           window) G_GNUC_MALLOC;
+                                               Window           window,
+                                               gboolean         offscreen) G_GNUC_MALLOC;
 
 void             systray_socket_force_redraw  (SystraySocket   *socket);
 
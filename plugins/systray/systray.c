@@ -77,6 +77,10 @@ void  systray_plugin_configuration_changed  (SnConfig           *config,
   single_row = sn_config_get_single_row (config);
   systray_box_set_single_row (XFCE_SYSTRAY_BOX (plugin->systray_box), single_row);
 
+  /* offscreen-icons */
+  if (plugin->manager != NULL)
+    systray_manager_set_offscreen (plugin->manager, sn_config_get_offscreen_icons (config));
+
   /* known-legacy-items */
   {
     g_slist_free_full (plugin->names_ordered, g_free);
@@ -132,6 +136,8 @@ systray_plugin_screen_changed_idle (gpointer user_data)
       G_CALLBACK (systray_plugin_icon_removed), plugin);
   g_signal_connect (G_OBJECT (plugin->manager), "lost-selection",
       G_CALLBACK (systray_plugin_lost_selection), plugin);
+  systray_manager_set_offscreen (plugin->manager,
+      sn_config_get_offscreen_icons (plugin->config));
 
   /* try to register the systray */
   screen = gtk_widget_get_screen (GTK_WIDGET (plugin));
@@ -257,13 +263,17 @@ systray_plugin_box_draw_icon (GtkWidget *child,
 {
   cairo_t       *cr = user_data;
   GtkAllocation  alloc;
+  GdkRectangle   clip;
 
   if (systray_socket_is_composited (XFCE_SYSTRAY_SOCKET (child)))
     {
       gtk_widget_get_allocation (child, &alloc);
 
-      /* skip hidden (see offscreen in box widget) icons */
-      if (alloc.x > -1 && alloc.y > -1)
+      /* skip hidden (see offscreen in box widget) icons and icons outside
+       * the area to redraw, a damaged icon only invalidates its own area */
+      if (alloc.x > -1 && alloc.y > -1
+          && gdk_cairo_get_clip_rectangle (cr, &clip)
+          && gdk_rectangle_intersect (&alloc, &clip, NULL))
         {
           // FIXME
           gdk_cairo_set_source_window (cr, gtk_widget_get_window (child),
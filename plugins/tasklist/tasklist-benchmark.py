@@ -0,0 +1,424 @@
+ #
+ # Copyright (C) 2024 The Xfce development team
+ #
+ # This program is free software; you can redistribute it and/or modify
+ # it under the terms of the GNU General Public License as published by
+ # the Free Software Foundation; either version 2 of the License, or
+ # (at your option) any later version.
+ #
+ # This program is distributed in the hope that it will be useful,
+ # but WITHOUT ANY WARRANTY; without even the implied warranty of
+ # MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ # GNU General Public License for more details.
+ #
+ # You should have received a copy of the GNU General Public License along
+ # with this program; if not, write to the Free Software Foundation, Inc.,
+ # 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ #
+
+
+"""Synthetic window benchmark for the tasklist and window menu plugins
+
+Starts a test panel hosting only the tasklist and the window menu, acts
+as a minimal window manager on the X server (it publishes the client
+list, workspaces and active window, nothing is managed for real) and
+maps a number of windows whose titles, icons, urgency and workspace
+churn at a fixed rate. At the end a JSON document is written with the
+CPU time and peak RSS of the panel, the main loop latency, the stalls
+reported by the panel watchdog and the statistics the two plugins print
+with PANEL_DEBUG, including the X requests they sent.
+
+Run it on a private X server and session bus, so the panel configuration
+written by this script is the one xfconfd loads:
+
+  dbus-run-session -- xvfb-run -a -s '-screen 0 1920x1080x24' \\
+    python3 tasklist-benchmark.py --windows 500 --output 500.json
+
+Requires python-xlib and PyGObject.
+"""
+
+import argparse
+import json
+import os
+import re
+import shlex
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+from gi.repository import Gio, GLib
+from Xlib import X, Xatom, display
+
+
+
+PANEL_CONFIG = """<?xml version="1.0" encoding="UTF-8"?>
+
+<channel name="xfce4-panel" version="1.0">
+  <property name="configver" type="int" value="2"/>
+  <property name="panels" type="array">
+    <value type="int" value="1"/>
+    <property name="panel-1" type="empty">
+      <property name="position" type="string" value="p=8;x=0;y=0"/>
+      <property name="length" type="uint" value="100"/>
+      <property name="position-locked" type="bool" value="true"/>
+      <property name="size" type="uint" value="30"/>
+      <property name="plugin-ids" type="array">
+        <value type="int" value="1"/>
+        <value type="int" value="2"/>
+      </property>
+    </property>
+  </property>
+  <property name="plugins" type="empty">
+    <property name="plugin-1" type="string" value="tasklist">
+      <property name="grouping" type="uint" value="%(grouping)d"/>
+      <property name="include-all-workspaces" type="bool" value="%(all_workspaces)s"/>
+    </property>
+    <property name="plugin-2" type="string" value="windowmenu"/>
+  </property>
+</channel>
+"""
+
+STATS_LINE = re.compile(r"\((tasklist|windowmenu)\): \S+: stats (\{.*\})$")
+
+# fields of the plugin statistics that are not summed over the intervals
+STATS_MAXIMA = ("windows", "menu_items", "max_rss_kb",
+                "max_update_latency_us", "max_menu_update_us")
+
+N_CLASSES = 12
+ICON_SIZE = 32
+
+
+
+class WindowManager():
+    """Just enough of the EWMH for libwnck to list and track the windows"""
+
+    def __init__(self, n_workspaces):
+        self.display = display.Display()
+        self.screen = self.display.screen()
+        self.root = self.screen.root
+        self.n_workspaces = n_workspaces
+        self.windows = []
+        self.active = 0
+
+        self.check = self.root.create_window(-10, -10, 1, 1, 0, X.CopyFromParent)
+        self.set_property(self.check, "_NET_SUPPORTING_WM_CHECK", Xatom.WINDOW, [self.check.id])
+        self.set_property(self.check, "_NET_WM_NAME", "UTF8_STRING", b"tasklist-benchmark")
+        self.set_property(self.root, "_NET_SUPPORTING_WM_CHECK", Xatom.WINDOW, [self.check.id])
+        self.set_property(self.root, "_NET_SUPPORTED", Xatom.ATOM,
+                          [self.atom(name) for name in (
+                              "_NET_CLIENT_LIST", "_NET_CLIENT_LIST_STACKING",
+                              "_NET_NUMBER_OF_DESKTOPS", "_NET_CURRENT_DESKTOP",
+                              "_NET_ACTIVE_WINDOW", "_NET_WM_NAME", "_NET_WM_ICON",
+                              "_NET_WM_DESKTOP", "_NET_WM_STATE",
+                              "_NET_WM_STATE_DEMANDS_ATTENTION",
+                              "_NET_WM_WINDOW_TYPE", "_NET_WM_WINDOW_TYPE_NORMAL")])
+        self.set_property(self.root, "_NET_NUMBER_OF_DESKTOPS", Xatom.CARDINAL, [n_workspaces])
+        self.set_property(self.root, "_NET_CURRENT_DESKTOP", Xatom.CARDINAL, [0])
+        self.display.flush()
+
+    def atom(self, name):
+        return self.display.intern_atom(name)
+
+    def set_property(self, window, name, type_name, data):
+        type_atom = type_name if isinstance(type_name, int) else self.atom(type_name)
+        window.change_property(self.atom(name), type_atom,
+                               8 if isinstance(data, bytes) else 32, data)
+
+    def add_window(self, window):
+        self.windows.append(window)
+        self.update_client_list()
+
+    def update_client_list(self):
+        ids = [window.xwindow.id for window in self.windows]
+        self.set_property(self.root, "_NET_CLIENT_LIST", Xatom.WINDOW, ids)
+        self.set_property(self.root, "_NET_CLIENT_LIST_STACKING", Xatom.WINDOW, ids)
+
+    def activate_next(self):
+        self.active = (self.active + 1) % len(self.windows)
+        window = self.windows[self.active]
+        self.set_property(self.root, "_NET_CURRENT_DESKTOP", Xatom.CARDINAL, [window.workspace])
+        self.set_property(self.root, "_NET_ACTIVE_WINDOW", Xatom.WINDOW, [window.xwindow.id])
+
+    def flush(self):
+        self.display.flush()
+
+
+
+class FakeWindow():
+
+    def __init__(self, wm, index, icons):
+        self.wm = wm
+        self.index = index
+        self.icons = icons
+        self.tick = 0
+        self.icon = index % len(icons)
+        self.workspace = index % wm.n_workspaces
+        self.urgent = False
+
+        self.xwindow = wm.root.create_window(0, 0, 200, 100, 0, X.CopyFromParent)
+        app = "benchmark-app-%d" % (index % N_CLASSES)
+        self.xwindow.set_wm_class(app, app.capitalize())
+        wm.set_property(self.xwindow, "_NET_WM_WINDOW_TYPE", Xatom.ATOM,
+                        [wm.atom("_NET_WM_WINDOW_TYPE_NORMAL")])
+        wm.set_property(self.xwindow, "_NET_WM_DESKTOP", Xatom.CARDINAL, [self.workspace])
+        wm.set_property(self.xwindow, "_NET_WM_ICON", Xatom.CARDINAL, icons[self.icon])
+        self.set_title()
+        self.xwindow.map()
+        wm.add_window(self)
+
+    def set_title(self):
+        title = "Benchmark window %d, update %d" % (self.index, self.tick)
+        self.xwindow.set_wm_name(title)
+        self.wm.set_property(self.xwindow, "_NET_WM_NAME", "UTF8_STRING", title.encode())
+
+    def change(self, change):
+        self.tick += 1
+        if change == "title":
+            self.set_title()
+        elif change == "icon":
+            self.icon = (self.icon + 1) % len(self.icons)
+            self.wm.set_property(self.xwindow, "_NET_WM_ICON", Xatom.CARDINAL, self.icons[self.icon])
+        elif change == "urgency":
+            self.urgent = not self.urgent
+            state = [self.wm.atom("_NET_WM_STATE_DEMANDS_ATTENTION")] if self.urgent else []
+            self.wm.set_property(self.xwindow, "_NET_WM_STATE", Xatom.ATOM, state)
+        elif change == "workspace":
+            self.workspace = (self.workspace + 1) % self.wm.n_workspaces
+            self.wm.set_property(self.xwindow, "_NET_WM_DESKTOP", Xatom.CARDINAL, [self.workspace])
+        elif change == "active":
+            self.wm.activate_next()
+
+
+
+def make_icons(n):
+    """Pre-render the icons so the generator itself stays cheap"""
+    icons = []
+    for i in range(n):
+        level = (i * 256 // n) & 0xff
+        pixel = 0xff000000 | (level << 16) | ((255 - level) << 8) | ((level * 3) & 0xff)
+        icons.append([ICON_SIZE, ICON_SIZE] + [pixel] * (ICON_SIZE * ICON_SIZE))
+    return icons
+
+
+def write_panel_config(config_home, args):
+    channel_dir = os.path.join(config_home, "xfce4", "xfconf", "xfce-perchannel-xml")
+    os.makedirs(channel_dir, exist_ok=True)
+    with open(os.path.join(channel_dir, "xfce4-panel.xml"), "w") as config:
+        config.write(PANEL_CONFIG % {
+            "grouping": 1 if args.grouping else 0,
+            "all_workspaces": "true" if args.all_workspaces else "false",
+        })
+
+
+def update_activation_environment(connection, environment):
+    """xfconfd is started by the bus, so it needs the test config home too"""
+    connection.call_sync("org.freedesktop.DBus", "/org/freedesktop/DBus",
+                         "org.freedesktop.DBus", "UpdateActivationEnvironment",
+                         GLib.Variant("(a{ss})", (environment,)),
+                         None, Gio.DBusCallFlags.NONE, -1, None)
+
+
+def wait_for_name(connection, name, timeout):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        reply = connection.call_sync("org.freedesktop.DBus", "/org/freedesktop/DBus",
+                                     "org.freedesktop.DBus", "NameHasOwner",
+                                     GLib.Variant("(s)", (name,)),
+                                     GLib.VariantType("(b)"), Gio.DBusCallFlags.NONE, -1, None)
+        if reply.unpack()[0]:
+            return True
+        time.sleep(0.1)
+    return False
+
+
+def get_stall_summary(connection):
+    """Handled in the panel main loop, so the round trip is its latency"""
+    reply = connection.call_sync("org.xfce.Panel", "/org/xfce/Panel",
+                                 "org.xfce.Panel", "GetStallSummary", None,
+                                 GLib.VariantType("(a(suxxau))"), Gio.DBusCallFlags.NONE,
+                                 10000, None)
+    return reply.unpack()[0]
+
+
+def cpu_seconds(pid):
+    with open("/proc/%d/stat" % pid) as stat:
+        fields = stat.read().rsplit(")", 1)[1].split()
+    # utime and stime are fields 14 and 15, counted after the comm field
+    return (int(fields[11]) + int(fields[12])) / os.sysconf("SC_CLK_TCK")
+
+
+def peak_rss_kb(pid):
+    with open("/proc/%d/status" % pid) as status:
+        for line in status:
+            if line.startswith("VmHWM:"):
+                return int(line.split()[1])
+    return 0
+
+
+def percentile(values, fraction):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * fraction))]
+
+
+def summarize_stats(objects):
+    summary = {}
+    for stats in objects:
+        for key, value in stats.items():
+            if key in STATS_MAXIMA:
+                summary[key] = max(summary.get(key, 0), value)
+            else:
+                summary[key] = summary.get(key, 0) + value
+    summary["intervals"] = len(objects)
+    return summary
+
+
+
+class PanelMonitor():
+
+    def __init__(self, panel):
+        self.lock = threading.Lock()
+        self.measuring = False
+        self.stats = {"tasklist": [], "windowmenu": []}
+        self.latencies = []
+        self.reader = threading.Thread(target=self.read_stderr, args=(panel.stderr,), daemon=True)
+        self.reader.start()
+
+    def read_stderr(self, stream):
+        for line in stream:
+            match = STATS_LINE.search(line.rstrip("\n"))
+            if match is None:
+                continue
+            with self.lock:
+                if self.measuring:
+                    self.stats[match.group(1)].append(json.loads(match.group(2)))
+
+    def ping(self, connection, interval, stop):
+        while not stop.is_set():
+            start = time.monotonic()
+            get_stall_summary(connection)
+            with self.lock:
+                if self.measuring:
+                    self.latencies.append(time.monotonic() - start)
+            stop.wait(interval)
+
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Tasklist and window menu benchmark")
+    parser.add_argument("--windows", type=int, default=50, help="number of windows")
+    parser.add_argument("--rate", type=float, default=200.0, help="window changes per second")
+    parser.add_argument("--duration", type=float, default=30.0, help="seconds to measure")
+    parser.add_argument("--warmup", type=float, default=5.0, help="seconds before measuring")
+    parser.add_argument("--workspaces", type=int, default=4, help="number of workspaces")
+    parser.add_argument("--changes", default="title,title,title,icon,urgency,workspace,active",
+                        help="round robin of changes: title, icon, urgency, workspace, active")
+    parser.add_argument("--grouping", action="store_true", help="group the tasklist buttons")
+    parser.add_argument("--all-workspaces", action="store_true",
+                        help="show the windows of all workspaces in the tasklist")
+    parser.add_argument("--popup-windowmenu", action="store_true",
+                        help="keep the window menu open while measuring")
+    parser.add_argument("--panel", default="xfce4-panel", help="command starting the panel")
+    parser.add_argument("--output", help="JSON file to write, by default standard output")
+    args = parser.parse_args()
+
+    connection = Gio.bus_get_sync(Gio.BusType.SESSION, None)
+    config_home = tempfile.mkdtemp(prefix="tasklist-benchmark-")
+    write_panel_config(config_home, args)
+    update_activation_environment(connection, {"XDG_CONFIG_HOME": config_home})
+
+    wm = WindowManager(args.workspaces)
+    icons = make_icons(16)
+    windows = [FakeWindow(wm, i, icons) for i in range(args.windows)]
+    wm.activate_next()
+    wm.flush()
+
+    environment = dict(os.environ, XDG_CONFIG_HOME=config_home,
+                       PANEL_DEBUG="tasklist,windowmenu")
+    panel = subprocess.Popen("exec " + args.panel, shell=True, env=environment,
+                             stderr=subprocess.PIPE, universal_newlines=True)
+    monitor = PanelMonitor(panel)
+    stop = threading.Event()
+
+    try:
+        if not wait_for_name(connection, "org.xfce.Panel", 30):
+            print("The panel did not show up on the session bus", file=sys.stderr)
+            return 1
+
+        pinger = threading.Thread(target=monitor.ping, args=(connection, 0.1, stop), daemon=True)
+        pinger.start()
+
+        changes = args.changes.split(",")
+        interval = 1.0 / args.rate
+        n_changes = n_measured = 0
+        next_change = time.monotonic()
+        warmup_end = next_change + args.warmup
+        start = end = None
+        cpu_start = 0.0
+
+        while end is None or time.monotonic() < end:
+            now = time.monotonic()
+            if start is None and now >= warmup_end:
+                if args.popup_windowmenu:
+                    subprocess.call(shlex.split(args.panel)[:1]
+                                    + ["--plugin-event=windowmenu:popup:bool:false"])
+                with monitor.lock:
+                    monitor.measuring = True
+                start = now
+                end = start + args.duration
+                cpu_start = cpu_seconds(panel.pid)
+                n_measured = n_changes
+
+            # catch up if we fell behind, the flush sends them at once
+            while next_change <= now:
+                window = windows[n_changes % len(windows)]
+                window.change(changes[(n_changes // len(windows)) % len(changes)])
+                n_changes += 1
+                next_change += interval
+            wm.flush()
+            time.sleep(max(0.0, min(next_change - time.monotonic(), 0.01)))
+
+        elapsed = time.monotonic() - start
+        cpu = cpu_seconds(panel.pid) - cpu_start
+        stalls = get_stall_summary(connection)
+
+        with monitor.lock:
+            monitor.measuring = False
+            result = {
+                "windows": args.windows,
+                "workspaces": args.workspaces,
+                "rate_hz": args.rate,
+                "changes": changes,
+                "duration_s": round(elapsed, 3),
+                "changes_sent": n_changes - n_measured,
+                "panel_cpu_percent": round(100 * cpu / elapsed, 2),
+                "panel_max_rss_kb": peak_rss_kb(panel.pid),
+                "main_loop_latency_ms_p50": round(percentile(monitor.latencies, 0.5) * 1000, 2),
+                "main_loop_latency_ms_p95": round(percentile(monitor.latencies, 0.95) * 1000, 2),
+                "main_loop_latency_ms_max": round(max(monitor.latencies, default=0) * 1000, 2),
+                "stalls": [{"source": source, "count": count, "total_us": total,
+                            "max_us": maximum, "histogram": histogram}
+                           for source, count, total, maximum, histogram in stalls],
+                "tasklist": summarize_stats(monitor.stats["tasklist"]),
+                "windowmenu": summarize_stats(monitor.stats["windowmenu"]),
+            }
+
+        if args.output:
+            with open(args.output, "w") as output:
+                json.dump(result, output, indent=2)
+                output.write("\n")
+        else:
+            print(json.dumps(result))
+        return 0
+    finally:
+        stop.set()
+        panel.terminate()
+        panel.wait()
+
+
+
+if __name__ == '__main__':
+    sys.exit(main())
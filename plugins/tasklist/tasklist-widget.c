@@ -26,6 +26,9 @@
 #ifdef HAVE_MATH_H
 #include <math.h>
 #endif
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
 
 #include <gtk/gtk.h>
 #include <libxfce4ui/libxfce4ui.h>
@@ -33,9 +36,11 @@
 #include <libxfce4panel/libxfce4panel.h>
 #include <common/panel-private.h>
 #include <common/panel-debug.h>
+#include <common/panel-probes.h>
 
 #ifdef GDK_WINDOWING_X11
 #include <X11/Xlib.h>
+#include <X11/Xatom.h>
 #include <gdk/gdkx.h>
 #include <X11/extensions/shape.h>
 #endif
@@ -114,8 +119,15 @@ struct _XfceTasklist
   WnckScreen           *screen;
   GdkDisplay           *display;
 
-  /* window children in the tasklist */
-  GList                *windows;
+  /* window children in the tasklist, in button order */
+  GSequence            *windows;
+
+  /* window children of the wnck windows in the tasklist */
+  GHashTable           *window_children;
+
+  /* window children ordered by the last time they were focused,
+   * the first ones are pushed in the overflow menu first */
+  GSequence            *overflow_ranking;
 
   /* windows we monitor, but that are excluded from the tasklist */
   GSList               *skipped_windows;
@@ -126,6 +138,9 @@ struct _XfceTasklist
   /* classgroups of all the windows in the taskbar */
   GHashTable           *class_groups;
 
+  /* icons shared by the buttons, see XfceTasklistIcon */
+  GHashTable           *icon_cache;
+
   /* normal or iconbox style */
   guint                 show_labels : 1;
 
@@ -182,6 +197,32 @@ struct _XfceTasklist
   /* idle monitor geometry update */
   guint                 update_monitor_geometry_id;
 
+  /* idle update of buttons that became visible with outdated contents */
+  guint                 materialize_id;
+
+  /* windows with a changed name or icon, updated once per frame */
+  GSList               *pending_children;
+  guint                 update_buttons_id;
+
+  /* the last allocation and whether the buttons need to be layed out
+   * again, if not a size allocate only allocates the buttons again */
+  GtkAllocation         last_allocation;
+  guint                 layout_dirty : 1;
+
+  /* statistics for the debug output, reported once per second */
+  guint                 stats_timeout_id;
+  gint64                stats_timestamp;
+  guint                 stats_name_changes;
+  guint                 stats_icon_changes;
+  guint                 stats_updates;
+  guint                 stats_sorts;
+  guint                 stats_layouts;
+  guint                 stats_layouts_skipped;
+  gint64                stats_pending_since;
+  gint64                stats_max_latency;
+  gint64                stats_cpu_time;
+  gulong                stats_request_serial;
+
   /* button grouping */
   guint                 grouping : 1;
 
@@ -217,6 +258,26 @@ typedef enum
 }
 XfceTasklistChildType;
 
+typedef struct _XfceTasklistIcon XfceTasklistIcon;
+struct _XfceTasklistIcon
+{
+  /* lookup key: the icon of the window or class group, compared
+   * by content, or the class name if the icon was looked up in the
+   * icon theme, at the size of the wnck icon */
+  GdkPixbuf              *source;
+  gchar                  *name;
+  gint                    size;
+  gint                    scale_factor;
+  guint                   hash;
+
+  /* the icon shown in the buttons */
+  GdkPixbuf              *pixbuf;
+  cairo_surface_t        *surface;
+
+  /* number of buttons using the icon */
+  guint                   ref_count;
+};
+
 typedef struct _XfceTasklistChild XfceTasklistChild;
 struct _XfceTasklistChild
 {
@@ -226,14 +287,16 @@ struct _XfceTasklistChild
   /* pointer to the tasklist */
   XfceTasklist           *tasklist;
 
-  /* button widgets */
+  /* button widgets, TODO only create these for windows that fit in
+   * the tasklist and recycle them through a pool, see the commit log */
   GtkWidget              *button;
   GtkWidget              *box;
   GtkWidget              *icon;
   GtkWidget              *label;
 
-  /* we use a surface for icon rendering so keep original pixbuf around */
-  GdkPixbuf              *pixbuf;
+  /* we use a surface for icon rendering so keep original pixbuf around,
+   * both are shared with other buttons showing the same icon */
+  XfceTasklistIcon       *cached_icon;
 
   /* drag motion window activate */
   guint                   motion_timeout_id;
@@ -246,6 +309,23 @@ struct _XfceTasklistChild
   /* last time this window was focused */
   gint64                  last_focused;
 
+  /* last icon geometry sent to the window manager */
+  GdkRectangle            icon_geometry;
+
+  /* position in the tasklist and the overflow ranking */
+  GSequenceIter          *windows_iter;
+  GSequenceIter          *ranking_iter;
+
+  /* the icon or label of the button is outdated because the window
+   * changed while the button was not visible in the tasklist */
+  guint                   icon_dirty : 1;
+  guint                   name_dirty : 1;
+
+  /* the name changed so the button might need to move, and
+   * the child is queued in the tasklist pending children */
+  guint                   sort_dirty : 1;
+  guint                   pending : 1;
+
   /* list of windows in case of a group button */
   GSList                 *windows;
   gint                    n_windows;
@@ -271,6 +351,9 @@ static void               xfce_tasklist_set_property                     (GObjec
                                                                           const GValue         *value,
                                                                           GParamSpec           *pspec);
 static void               xfce_tasklist_finalize                         (GObject              *object);
+static guint              xfce_tasklist_icon_hash                        (gconstpointer         key);
+static gboolean           xfce_tasklist_icon_equal                       (gconstpointer         a,
+                                                                          gconstpointer         b);
 static void               xfce_tasklist_get_preferred_length             (GtkWidget            *widget,
                                                                           gint                 *minimum_length,
                                                                           gint                 *natural_length);
@@ -285,6 +368,7 @@ static void               xfce_tasklist_size_allocate                    (GtkWid
 static void               xfce_tasklist_style_updated                    (GtkWidget            *widget);
 static void               xfce_tasklist_realize                          (GtkWidget            *widget);
 static void               xfce_tasklist_unrealize                        (GtkWidget            *widget);
+static void               xfce_tasklist_map                              (GtkWidget            *widget);
 static gboolean           xfce_tasklist_scroll_event                     (GtkWidget            *widget,
                                                                           GdkEventScroll       *event);
 static void               xfce_tasklist_remove                           (GtkContainer         *container,
@@ -325,6 +409,13 @@ static void               xfce_tasklist_skipped_windows_state_changed    (WnckWi
                                                                           XfceTasklist         *tasklist);
 static void               xfce_tasklist_sort                             (XfceTasklist         *tasklist,
                                                                           gboolean              sort_groups);
+static gboolean           xfce_tasklist_sort_child                       (XfceTasklistChild    *child);
+static void               xfce_tasklist_queue_layout                     (XfceTasklist         *tasklist);
+static gboolean           xfce_tasklist_update_buttons                   (GtkWidget            *widget,
+                                                                          GdkFrameClock        *frame_clock,
+                                                                          gpointer              user_data);
+static gboolean           xfce_tasklist_report_stats                     (gpointer              data);
+static void               xfce_tasklist_report_stats_destroyed           (gpointer              data);
 static void               xfce_tasklist_group_button_sort                (XfceTasklistChild    *group_child);
 static gboolean           xfce_tasklist_update_icon_geometries           (gpointer              data);
 static void               xfce_tasklist_update_icon_geometries_destroyed (gpointer              data);
@@ -340,6 +431,10 @@ static void               xfce_tasklist_wireframe_update                 (XfceTa
 /* tasklist buttons */
 static inline gboolean    xfce_tasklist_button_visible                   (XfceTasklistChild    *child,
                                                                           WnckWorkspace         *active_ws);
+static inline gboolean    xfce_tasklist_button_on_screen                 (XfceTasklistChild    *child);
+static void               xfce_tasklist_button_materialize               (XfceTasklistChild    *child);
+static void               xfce_tasklist_button_icon_changed              (WnckWindow           *window,
+                                                                          XfceTasklistChild    *child);
 static gint               xfce_tasklist_button_compare                   (gconstpointer         child_a,
                                                                           gconstpointer         child_b,
                                                                           gpointer              user_data);
@@ -388,6 +483,10 @@ G_DEFINE_TYPE (XfceTasklist, xfce_tasklist, GTK_TYPE_CONTAINER)
 
 
 
+static GQuark child_quark = 0;
+
+
+
 static void
 xfce_tasklist_class_init (XfceTasklistClass *klass)
 {
@@ -407,6 +506,7 @@ xfce_tasklist_class_init (XfceTasklistClass *klass)
   gtkwidget_class->style_updated = xfce_tasklist_style_updated;
   gtkwidget_class->realize = xfce_tasklist_realize;
   gtkwidget_class->unrealize = xfce_tasklist_unrealize;
+  gtkwidget_class->map = xfce_tasklist_map;
   gtkwidget_class->scroll_event = xfce_tasklist_scroll_event;
 
   gtkcontainer_class = GTK_CONTAINER_CLASS (klass);
@@ -415,6 +515,8 @@ xfce_tasklist_class_init (XfceTasklistClass *klass)
   gtkcontainer_class->forall = xfce_tasklist_forall;
   gtkcontainer_class->child_type = xfce_tasklist_child_type;
 
+  child_quark = g_quark_from_static_string ("xfce-tasklist-child");
+
   g_object_class_install_property (gobject_class,
                                    PROP_GROUPING,
                                    g_param_spec_boolean ("grouping",
@@ -603,7 +705,9 @@ xfce_tasklist_init (XfceTasklist *tasklist)
 
   tasklist->locked = 0;
   tasklist->screen = NULL;
-  tasklist->windows = NULL;
+  tasklist->windows = g_sequence_new (NULL);
+  tasklist->window_children = g_hash_table_new (g_direct_hash, g_direct_equal);
+  tasklist->overflow_ranking = g_sequence_new (NULL);
   tasklist->skipped_windows = NULL;
   tasklist->mode = XFCE_PANEL_PLUGIN_MODE_HORIZONTAL;
   tasklist->nrows = 1;
@@ -627,6 +731,16 @@ xfce_tasklist_init (XfceTasklist *tasklist)
 #endif
   tasklist->update_icon_geometries_id = 0;
   tasklist->update_monitor_geometry_id = 0;
+  tasklist->materialize_id = 0;
+  tasklist->pending_children = NULL;
+  tasklist->update_buttons_id = 0;
+  tasklist->layout_dirty = TRUE;
+  tasklist->stats_timeout_id = 0;
+
+  /* report the statistics once per second while debugging */
+  if (panel_debug_has_domain (PANEL_DEBUG_TASKLIST))
+    tasklist->stats_timeout_id = g_timeout_add_seconds_full (G_PRIORITY_LOW, 1, xfce_tasklist_report_stats,
+                                                             tasklist, xfce_tasklist_report_stats_destroyed);
   tasklist->max_button_length = DEFAULT_MAX_BUTTON_LENGTH;
   tasklist->min_button_length = DEFAULT_MIN_BUTTON_LENGTH;
   tasklist->max_button_size = DEFAULT_BUTTON_SIZE;
@@ -638,6 +752,7 @@ xfce_tasklist_init (XfceTasklist *tasklist)
   tasklist->class_groups = g_hash_table_new_full (g_direct_hash, g_direct_equal,
                                                   (GDestroyNotify) g_object_unref,
                                                   (GDestroyNotify) xfce_tasklist_group_button_remove);
+  tasklist->icon_cache = g_hash_table_new (xfce_tasklist_icon_hash, xfce_tasklist_icon_equal);
 
   /* add style class for the tasklist widget */
   context = gtk_widget_get_style_context (GTK_WIDGET (tasklist));
@@ -707,6 +822,167 @@ xfce_tasklist_get_window_icon (WnckWindow *window,
 
 
 
+static guint
+xfce_tasklist_icon_hash (gconstpointer key)
+{
+  const XfceTasklistIcon *icon = key;
+
+  return icon->hash;
+}
+
+
+
+static gboolean
+xfce_tasklist_icon_equal (gconstpointer a,
+                          gconstpointer b)
+{
+  const XfceTasklistIcon *icon_a = a, *icon_b = b;
+  gsize                   length;
+
+  if (icon_a->hash != icon_b->hash
+      || icon_a->size != icon_b->size
+      || icon_a->scale_factor != icon_b->scale_factor)
+    return FALSE;
+
+  if (icon_a->name != NULL || icon_b->name != NULL)
+    return g_strcmp0 (icon_a->name, icon_b->name) == 0;
+
+  if (icon_a->source == icon_b->source)
+    return TRUE;
+
+  /* windows of the same application have their own copy of the icon */
+  length = gdk_pixbuf_get_byte_length (icon_a->source);
+  return gdk_pixbuf_get_width (icon_a->source) == gdk_pixbuf_get_width (icon_b->source)
+         && gdk_pixbuf_get_height (icon_a->source) == gdk_pixbuf_get_height (icon_b->source)
+         && gdk_pixbuf_get_rowstride (icon_a->source) == gdk_pixbuf_get_rowstride (icon_b->source)
+         && gdk_pixbuf_get_n_channels (icon_a->source) == gdk_pixbuf_get_n_channels (icon_b->source)
+         && length == gdk_pixbuf_get_byte_length (icon_b->source)
+         && memcmp (gdk_pixbuf_read_pixels (icon_a->source),
+                    gdk_pixbuf_read_pixels (icon_b->source), length) == 0;
+}
+
+
+
+static XfceTasklistIcon *
+xfce_tasklist_icon_lookup (XfceTasklist *tasklist,
+                           GdkPixbuf    *source,
+                           WnckWindow   *window)
+{
+  XfceTasklistIcon  key = { 0 };
+  XfceTasklistIcon *icon;
+  const guint8     *pixels;
+  gsize             i, length;
+  GdkPixbuf        *pixbuf;
+
+  panel_return_val_if_fail (GDK_IS_PIXBUF (source), NULL);
+  panel_return_val_if_fail (window == NULL || WNCK_IS_WINDOW (window), NULL);
+
+  key.source = source;
+  key.size = gdk_pixbuf_get_width (source);
+  key.scale_factor = gtk_widget_get_scale_factor (GTK_WIDGET (tasklist));
+
+  /* for fallback icons we look in the theme, once per class */
+  if (window != NULL && wnck_window_get_icon_is_fallback (window))
+    key.name = (gchar *) wnck_window_get_class_instance_name (window);
+
+  if (key.name != NULL)
+    {
+      key.hash = g_str_hash (key.name);
+    }
+  else
+    {
+      /* djb hash of the icon data */
+      pixels = gdk_pixbuf_read_pixels (source);
+      length = gdk_pixbuf_get_byte_length (source);
+      for (i = 0, key.hash = 5381; i < length; i++)
+        key.hash = (key.hash << 5) + key.hash + pixels[i];
+    }
+  key.hash ^= key.size ^ (key.scale_factor << 16);
+
+  icon = g_hash_table_lookup (tasklist->icon_cache, &key);
+  if (icon != NULL)
+    {
+      icon->ref_count++;
+      return icon;
+    }
+
+  if (key.name != NULL)
+    pixbuf = xfce_tasklist_get_window_icon_from_theme (window, source);
+  else
+    pixbuf = source;
+
+  if (pixbuf == source)
+    g_object_ref (pixbuf);
+
+  icon = g_slice_new0 (XfceTasklistIcon);
+  icon->source = g_object_ref (source);
+  icon->name = g_strdup (key.name);
+  icon->size = key.size;
+  icon->scale_factor = key.scale_factor;
+  icon->hash = key.hash;
+  icon->pixbuf = pixbuf;
+  icon->surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, key.scale_factor, NULL);
+  icon->ref_count = 1;
+
+  g_hash_table_add (tasklist->icon_cache, icon);
+
+  panel_debug_filtered (PANEL_DEBUG_TASKLIST, "%u icons in the cache",
+                        g_hash_table_size (tasklist->icon_cache));
+
+  return icon;
+}
+
+
+
+static void
+xfce_tasklist_icon_theme_changed (GtkIconTheme *icon_theme,
+                                  XfceTasklist *tasklist)
+{
+  GSequenceIter     *iter;
+  XfceTasklistChild *child;
+
+  panel_return_if_fail (GTK_IS_ICON_THEME (icon_theme));
+  panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
+
+  /* the fallback icons were loaded from the old theme, drop them from
+   * the cache, the buttons release their icon when it is updated */
+  g_hash_table_remove_all (tasklist->icon_cache);
+
+  for (iter = g_sequence_get_begin_iter (tasklist->windows);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
+    {
+      child = g_sequence_get (iter);
+      if (child->type != CHILD_TYPE_GROUP)
+        xfce_tasklist_button_icon_changed (child->window, child);
+    }
+}
+
+
+
+static void
+xfce_tasklist_icon_release (XfceTasklist     *tasklist,
+                            XfceTasklistIcon *icon)
+{
+  panel_return_if_fail (icon->ref_count > 0);
+
+  if (--icon->ref_count > 0)
+    return;
+
+  /* the icon is no longer in the cache if the icon theme changed, and
+   * an equal icon might have been added since */
+  if (g_hash_table_lookup (tasklist->icon_cache, icon) == icon)
+    g_hash_table_remove (tasklist->icon_cache, icon);
+
+  cairo_surface_destroy (icon->surface);
+  g_object_unref (icon->pixbuf);
+  g_object_unref (icon->source);
+  g_free (icon->name);
+  g_slice_free (XfceTasklistIcon, icon);
+}
+
+
+
 static void
 xfce_tasklist_get_property (GObject    *object,
                             guint       prop_id,
@@ -885,7 +1161,7 @@ xfce_tasklist_finalize (GObject *object)
   XfceTasklist *tasklist = XFCE_TASKLIST (object);
 
   /* data that should already be freed when disconnecting the screen */
-  panel_return_if_fail (tasklist->windows == NULL);
+  panel_return_if_fail (g_sequence_is_empty (tasklist->windows));
   panel_return_if_fail (tasklist->skipped_windows == NULL);
   panel_return_if_fail (tasklist->screen == NULL);
 
@@ -894,10 +1170,25 @@ xfce_tasklist_finalize (GObject *object)
     g_source_remove (tasklist->update_icon_geometries_id);
   if (tasklist->update_monitor_geometry_id != 0)
     g_source_remove (tasklist->update_monitor_geometry_id);
+  if (tasklist->materialize_id != 0)
+    g_source_remove (tasklist->materialize_id);
+  if (tasklist->update_buttons_id != 0)
+    gtk_widget_remove_tick_callback (GTK_WIDGET (tasklist), tasklist->update_buttons_id);
+  g_slist_free (tasklist->pending_children);
+  if (tasklist->stats_timeout_id != 0)
+    g_source_remove (tasklist->stats_timeout_id);
 
   /* free the class group hash table */
   g_hash_table_destroy (tasklist->class_groups);
 
+  /* the icons are released when the buttons are removed */
+  g_hash_table_destroy (tasklist->icon_cache);
+
+  /* free the window index */
+  g_sequence_free (tasklist->windows);
+  g_sequence_free (tasklist->overflow_ranking);
+  g_hash_table_destroy (tasklist->window_children);
+
 #ifdef GDK_WINDOWING_X11
   /* destroy the wireframe window */
   xfce_tasklist_wireframe_destroy (tasklist);
@@ -964,13 +1255,15 @@ xfce_tasklist_get_preferred_length (GtkWidget *widget,
   gint               n_windows;
   GtkRequisition     child_req;
   gint               length;
-  GList             *li;
+  GSequenceIter     *iter;
   XfceTasklistChild *child;
   gint               child_height = 0;
 
-  for (li = tasklist->windows, n_windows = 0; li != NULL; li = li->next)
+  for (iter = g_sequence_get_begin_iter (tasklist->windows), n_windows = 0;
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
     {
-      child = li->data;
+      child = g_sequence_get (iter);
 
       if (gtk_widget_get_visible (child->button))
         {
@@ -1028,7 +1321,8 @@ xfce_tasklist_get_preferred_length (GtkWidget *widget,
 
 static gint
 xfce_tasklist_size_sort_window (gconstpointer a,
-                                gconstpointer b)
+                                gconstpointer b,
+                                gpointer      user_data)
 {
   const XfceTasklistChild *child_a = a;
   const XfceTasklistChild *child_b = b;
@@ -1050,8 +1344,7 @@ xfce_tasklist_size_layout (XfceTasklist  *tasklist,
   gint               rows;
   gint               min_button_length;
   gint               cols;
-  GSList            *windows_scored = NULL, *lp;
-  GList             *li;
+  GSequenceIter     *iter;
   XfceTasklistChild *child;
   gint               max_button_length;
   gint               n_buttons;
@@ -1083,9 +1376,11 @@ xfce_tasklist_size_layout (XfceTasklist  *tasklist,
 
   /* unset overflow items, we decide about that again
    * later */
-  for (li = tasklist->windows; li != NULL; li = li->next)
+  for (iter = g_sequence_get_begin_iter (tasklist->overflow_ranking);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
     {
-      child = li->data;
+      child = g_sequence_get (iter);
       if (child->type == CHILD_TYPE_OVERFLOW_MENU)
         child->type = CHILD_TYPE_WINDOW;
     }
@@ -1098,19 +1393,6 @@ xfce_tasklist_size_layout (XfceTasklist  *tasklist,
     }
   else
     {
-      /* we need to group something, first create a list with the
-       * windows most suitable for grouping at the beginning that are
-       * (should be) currently visible */
-      for (li = tasklist->windows; li != NULL; li = li->next)
-        {
-          child = li->data;
-          if (child->type == CHILD_TYPE_WINDOW && gtk_widget_get_visible (child->button))
-            {
-              windows_scored = g_slist_insert_sorted (windows_scored, child,
-                                                      xfce_tasklist_size_sort_window);
-            }
-        }
-
       if (xfce_tasklist_deskbar (tasklist) || !tasklist->show_labels)
         max_button_length = min_button_length;
       else if (tasklist->max_button_length != -1)
@@ -1127,20 +1409,25 @@ xfce_tasklist_size_layout (XfceTasklist  *tasklist,
       /* yet still within the specified limits) */
       n_buttons_target = (alloc->width - ARROW_BUTTON_SIZE) / min_button_length * rows;
 
-      /* we now push the windows with the lowest score in the
-       * overflow menu */
+      /* we now push the (visible) windows with the lowest score in
+       * the overflow menu, the ranking is kept sorted by the last
+       * time the windows were focused */
       if (n_buttons > n_buttons_target)
         {
           panel_debug (PANEL_DEBUG_TASKLIST,
                        "Putting %d windows in overflow menu",
                        n_buttons - n_buttons_target);
 
-          for (lp = windows_scored;
-               n_buttons > n_buttons_target && lp != NULL;
-               lp = lp->next, n_buttons--)
+          for (iter = g_sequence_get_begin_iter (tasklist->overflow_ranking);
+               n_buttons > n_buttons_target && !g_sequence_iter_is_end (iter);
+               iter = g_sequence_iter_next (iter))
             {
-              child = lp->data;
-              child->type = CHILD_TYPE_OVERFLOW_MENU;
+              child = g_sequence_get (iter);
+              if (child->type == CHILD_TYPE_WINDOW && gtk_widget_get_visible (child->button))
+                {
+                  child->type = CHILD_TYPE_OVERFLOW_MENU;
+                  n_buttons--;
+                }
             }
 
           /* Try to position the arrow widget at the end of the allocation area  *
@@ -1150,8 +1437,6 @@ xfce_tasklist_size_layout (XfceTasklist  *tasklist,
                                  n_buttons_target * max_button_length / rows);
         }
 
-      g_slist_free (windows_scored);
-
       cols = n_buttons / rows;
       if (cols * rows < n_buttons)
         cols++;
@@ -1163,6 +1448,45 @@ xfce_tasklist_size_layout (XfceTasklist  *tasklist,
 
 
 
+static gboolean
+xfce_tasklist_materialize_idle (gpointer data)
+{
+  XfceTasklist      *tasklist = XFCE_TASKLIST (data);
+  GSequenceIter     *iter;
+  XfceTasklistChild *child;
+  guint              n = 0;
+
+  panel_return_val_if_fail (XFCE_IS_TASKLIST (tasklist), G_SOURCE_REMOVE);
+
+  for (iter = g_sequence_get_begin_iter (tasklist->windows);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
+    {
+      child = g_sequence_get (iter);
+      if ((child->icon_dirty || child->name_dirty)
+          && child->type == CHILD_TYPE_WINDOW
+          && gtk_widget_get_visible (child->button))
+        {
+          xfce_tasklist_button_materialize (child);
+          n++;
+        }
+    }
+
+  panel_debug_filtered (PANEL_DEBUG_TASKLIST, "updated %u outdated buttons", n);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+xfce_tasklist_materialize_idle_destroyed (gpointer data)
+{
+  XFCE_TASKLIST (data)->materialize_id = 0;
+}
+
+
+
 static void
 xfce_tasklist_size_allocate (GtkWidget     *widget,
                              GtkAllocation *allocation)
@@ -1171,7 +1495,7 @@ xfce_tasklist_size_allocate (GtkWidget     *widget,
   gint               rows, cols;
   gint               row;
   GtkAllocation      area = *allocation;
-  GList             *li;
+  GSequenceIter     *iter;
   XfceTasklistChild *child;
   gint               i;
   GtkAllocation      child_alloc;
@@ -1180,12 +1504,42 @@ xfce_tasklist_size_allocate (GtkWidget     *widget,
   gint               area_x, area_width;
   gint               arrow_position;
   GtkRequisition     child_req;
+  gboolean           materialize = FALSE;
 
   panel_return_if_fail (gtk_widget_get_visible (tasklist->arrow_button));
 
   /* set widget allocation */
   gtk_widget_set_allocation (widget, allocation);
 
+  if (!tasklist->layout_dirty
+      && gdk_rectangle_equal (allocation, &tasklist->last_allocation))
+    {
+      /* only the contents of the buttons changed (e.g. a new label that
+       * is ellipsized in the same button), so keep their geometry */
+      gtk_widget_get_allocation (tasklist->arrow_button, &child_alloc);
+      gtk_widget_size_allocate (tasklist->arrow_button, &child_alloc);
+
+      for (iter = g_sequence_get_begin_iter (tasklist->windows);
+           !g_sequence_iter_is_end (iter);
+           iter = g_sequence_iter_next (iter))
+        {
+          child = g_sequence_get (iter);
+          if (gtk_widget_get_visible (child->button))
+            {
+              gtk_widget_get_allocation (child->button, &child_alloc);
+              gtk_widget_size_allocate (child->button, &child_alloc);
+            }
+        }
+
+      tasklist->stats_layouts_skipped++;
+
+      return;
+    }
+
+  tasklist->last_allocation = *allocation;
+  tasklist->layout_dirty = FALSE;
+  tasklist->stats_layouts++;
+
   /* swap integers with vertical orientation */
   if (!xfce_tasklist_horizontal (tasklist))
     TRANSPOSE_AREA (area);
@@ -1231,9 +1585,11 @@ xfce_tasklist_size_allocate (GtkWidget     *widget,
   h = area.height / rows;
 
   /* allocate all the children */
-  for (li = tasklist->windows, i = 0; li != NULL; li = li->next)
+  for (iter = g_sequence_get_begin_iter (tasklist->windows), i = 0;
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
     {
-      child = li->data;
+      child = g_sequence_get (iter);
 
       /* skip hidden buttons */
       if (!gtk_widget_get_visible (child->button))
@@ -1287,6 +1643,11 @@ xfce_tasklist_size_allocate (GtkWidget     *widget,
           if (!xfce_tasklist_horizontal (tasklist))
             TRANSPOSE_AREA (child_alloc);
 
+          /* the button is visible now, update it if it changed while
+           * it was hidden or in a menu */
+          if (child->icon_dirty || child->name_dirty)
+            materialize = TRUE;
+
           /* increase the position counter */
           i++;
         }
@@ -1307,6 +1668,12 @@ xfce_tasklist_size_allocate (GtkWidget     *widget,
   if (tasklist->update_icon_geometries_id == 0)
     tasklist->update_icon_geometries_id = g_idle_add_full (G_PRIORITY_LOW, xfce_tasklist_update_icon_geometries,
                                                            tasklist, xfce_tasklist_update_icon_geometries_destroyed);
+
+  /* update outdated buttons, not during the allocation because that
+   * would queue another resize */
+  if (materialize && tasklist->materialize_id == 0)
+    tasklist->materialize_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE, xfce_tasklist_materialize_idle,
+                                                tasklist, xfce_tasklist_materialize_idle_destroyed);
 }
 
 
@@ -1351,7 +1718,7 @@ xfce_tasklist_style_updated (GtkWidget *widget)
 
       tasklist->max_button_size = max_button_size;
 
-      gtk_widget_queue_resize (widget);
+      xfce_tasklist_queue_layout (tasklist);
     }
 }
 
@@ -1383,32 +1750,46 @@ xfce_tasklist_unrealize (GtkWidget *widget)
 
 
 
+static void
+xfce_tasklist_map (GtkWidget *widget)
+{
+  XfceTasklist *tasklist = XFCE_TASKLIST (widget);
+
+  (*GTK_WIDGET_CLASS (xfce_tasklist_parent_class)->map) (widget);
+
+  /* the frame clock does not tick while we are unmapped, so apply the
+   * changes queued in the meantime now instead of waiting for the
+   * next frame */
+  if (tasklist->update_buttons_id != 0)
+    {
+      gtk_widget_remove_tick_callback (widget, tasklist->update_buttons_id);
+      xfce_tasklist_update_buttons (widget, gtk_widget_get_frame_clock (widget), NULL);
+    }
+}
+
+
+
 static gboolean
 xfce_tasklist_scroll_event (GtkWidget      *widget,
                             GdkEventScroll *event)
 {
   XfceTasklist        *tasklist = XFCE_TASKLIST (widget);
   XfceTasklistChild   *child = NULL;
-  GList               *li, *lnew = NULL;
+  GSequenceIter       *iter, *inew = NULL;
   GdkScrollDirection  scrolling_direction;
   gboolean            wrap_windows = tasklist->wrap_windows;
 
-  if (!tasklist->window_scrolling)
+  if (!tasklist->window_scrolling || tasklist->screen == NULL)
     return TRUE;
 
   /* get the current active button */
-  for (li = tasklist->windows; li != NULL; li = li->next)
-    {
-      child = li->data;
-
-      if (gtk_widget_get_visible (child->button)
-          && child->window != NULL && wnck_window_is_active (child->window))
-        break;
-    }
-
-  if (G_UNLIKELY (li == NULL))
+  child = g_hash_table_lookup (tasklist->window_children,
+                               wnck_screen_get_active_window (tasklist->screen));
+  if (G_UNLIKELY (child == NULL || !gtk_widget_get_visible (child->button)))
     return TRUE;
 
+  iter = child->windows_iter;
+
   if (event->direction != GDK_SCROLL_SMOOTH)
     scrolling_direction = event->direction;
   else if (event->delta_y < 0)
@@ -1429,23 +1810,23 @@ xfce_tasklist_scroll_event (GtkWidget      *widget,
     {
     case GDK_SCROLL_UP:
       /* find previous button on the tasklist */
-      for (lnew = g_list_previous (li); ; lnew = lnew->prev)
+      for (inew = iter; ; )
         {
-          if (lnew == NULL)
+          if (g_sequence_iter_is_begin (inew))
             {
               /* wrap only once if the first button is reached */
-              if (wrap_windows)
+              if (!wrap_windows)
                 {
-                  lnew = g_list_last (li);
-                  wrap_windows = FALSE;
-                  if (lnew == NULL)
-                    break;
+                  inew = NULL;
+                  break;
                 }
-              else
-                break;
+
+              inew = g_sequence_get_end_iter (tasklist->windows);
+              wrap_windows = FALSE;
             }
 
-          child = lnew->data;
+          inew = g_sequence_iter_prev (inew);
+          child = g_sequence_get (inew);
           if (child->window != NULL
               && gtk_widget_get_visible (child->button))
             break;
@@ -1455,23 +1836,23 @@ xfce_tasklist_scroll_event (GtkWidget      *widget,
 
     case GDK_SCROLL_DOWN:
       /* find the next button on the tasklist */
-      for (lnew = g_list_next (li); ; lnew = lnew->next)
+      for (inew = iter; ; )
         {
-          if (lnew == NULL)
+          inew = g_sequence_iter_next (inew);
+          if (g_sequence_iter_is_end (inew))
             {
               /* wrap only once if the last button is reached */
-              if (wrap_windows)
+              if (!wrap_windows)
                 {
-                  lnew = g_list_first (li);
-                  wrap_windows = FALSE;
-                  if (lnew == NULL)
-                    break;
+                  inew = NULL;
+                  break;
                 }
-              else
-                break;
+
+              inew = g_sequence_get_begin_iter (tasklist->windows);
+              wrap_windows = FALSE;
             }
 
-          child = lnew->data;
+          child = g_sequence_get (inew);
           if (child->window != NULL
               && gtk_widget_get_visible (child->button))
             break;
@@ -1493,8 +1874,8 @@ xfce_tasklist_scroll_event (GtkWidget      *widget,
 
     }
 
-  if (lnew != NULL)
-    xfce_tasklist_button_activate (lnew->data, event->time);
+  if (inew != NULL)
+    xfce_tasklist_button_activate (g_sequence_get (inew), event->time);
 
   return TRUE;
 }
@@ -1517,38 +1898,47 @@ xfce_tasklist_remove (GtkContainer *container,
   XfceTasklist      *tasklist = XFCE_TASKLIST (container);
   gboolean           was_visible;
   XfceTasklistChild *child;
-  GList             *li;
 
-  for (li = tasklist->windows; li != NULL; li = li->next)
+  child = g_object_get_qdata (G_OBJECT (widget), child_quark);
+  panel_return_if_fail (child != NULL && child->button == widget);
+  panel_return_if_fail (child->tasklist == tasklist);
+
+  g_sequence_remove (child->windows_iter);
+  child->windows_iter = NULL;
+
+  if (child->ranking_iter != NULL)
     {
-      child = li->data;
+      g_sequence_remove (child->ranking_iter);
+      child->ranking_iter = NULL;
+    }
 
-      if (child->button == widget)
-        {
-          tasklist->windows = g_list_delete_link (tasklist->windows, li);
+  if (child->window != NULL
+      && g_hash_table_lookup (tasklist->window_children, child->window) == child)
+    g_hash_table_remove (tasklist->window_children, child->window);
 
-          was_visible = gtk_widget_get_visible (widget);
+  g_object_set_qdata (G_OBJECT (widget), child_quark, NULL);
 
-          gtk_widget_unparent (child->button);
+  if (child->pending)
+    tasklist->pending_children = g_slist_remove (tasklist->pending_children, child);
 
-          if (child->motion_timeout_id != 0)
-            g_source_remove (child->motion_timeout_id);
+  was_visible = gtk_widget_get_visible (widget);
 
-          if (child->pixbuf != NULL)
-            g_object_unref (child->pixbuf);
+  gtk_widget_unparent (child->button);
 
-          /* allow time for signal handlers connected to the destroy/dispose signals of
-           * child members to run, they could refer to these members via child, e.g.
-           * child->button as above to test for equality */
-          g_idle_add (xfce_tasklist_free_child, child);
+  if (child->motion_timeout_id != 0)
+    g_source_remove (child->motion_timeout_id);
 
-          /* queue a resize if needed */
-          if (G_LIKELY (was_visible))
-            gtk_widget_queue_resize (GTK_WIDGET (container));
+  if (child->cached_icon != NULL)
+    xfce_tasklist_icon_release (tasklist, child->cached_icon);
 
-          break;
-        }
-    }
+  /* allow time for signal handlers connected to the destroy/dispose signals of
+   * child members to run, they could refer to these members via child, e.g.
+   * child->button as above to test for equality */
+  g_idle_add (xfce_tasklist_free_child, child);
+
+  /* queue a resize if needed */
+  if (G_LIKELY (was_visible))
+    xfce_tasklist_queue_layout (tasklist);
 }
 
 
@@ -1560,16 +1950,16 @@ xfce_tasklist_forall (GtkContainer *container,
                       gpointer      callback_data)
 {
   XfceTasklist      *tasklist = XFCE_TASKLIST (container);
-  GList             *children = tasklist->windows;
+  GSequenceIter     *iter = g_sequence_get_begin_iter (tasklist->windows);
   XfceTasklistChild *child;
 
   if (include_internals)
     (* callback) (tasklist->arrow_button, callback_data);
 
-  while (children != NULL)
+  while (!g_sequence_iter_is_end (iter))
     {
-      child = children->data;
-      children = children->next;
+      child = g_sequence_get (iter);
+      iter = g_sequence_iter_next (iter);
 
       (* callback) (child->button, callback_data);
     }
@@ -1609,7 +1999,7 @@ static void
 xfce_tasklist_arrow_button_toggled (GtkWidget    *button,
                                     XfceTasklist *tasklist)
 {
-  GList             *li;
+  GSequenceIter     *iter;
   XfceTasklistChild *child;
   GtkWidget         *mi;
   GtkWidget         *menu;
@@ -1624,9 +2014,11 @@ xfce_tasklist_arrow_button_toggled (GtkWidget    *button,
       g_signal_connect (G_OBJECT (menu), "selection-done",
           G_CALLBACK (xfce_tasklist_arrow_button_menu_destroy), tasklist);
 
-      for (li = tasklist->windows; li != NULL; li = li->next)
+      for (iter = g_sequence_get_begin_iter (tasklist->windows);
+           !g_sequence_iter_is_end (iter);
+           iter = g_sequence_iter_next (iter))
         {
-          child = li->data;
+          child = g_sequence_get (iter);
 
           if (child->type != CHILD_TYPE_OVERFLOW_MENU)
             continue;
@@ -1685,6 +2077,10 @@ xfce_tasklist_connect_screen (XfceTasklist *tasklist)
   g_signal_connect (G_OBJECT (tasklist->screen), "viewports-changed",
       G_CALLBACK (xfce_tasklist_viewports_changed), tasklist);
 
+  /* monitor icon theme changes */
+  g_signal_connect (G_OBJECT (gtk_icon_theme_get_default ()), "changed",
+      G_CALLBACK (xfce_tasklist_icon_theme_changed), tasklist);
+
   /* update the viewport if not all monitors are shown */
   if (!tasklist->all_monitors)
   {
@@ -1699,7 +2095,7 @@ static void
 xfce_tasklist_disconnect_screen (XfceTasklist *tasklist)
 {
   GSList            *li, *lnext;
-  GList             *wi, *wnext;
+  GSequenceIter     *wi, *wnext;
   XfceTasklistChild *child;
   guint              n;
 
@@ -1711,6 +2107,10 @@ xfce_tasklist_disconnect_screen (XfceTasklist *tasklist)
       G_OBJECT (gtk_widget_get_toplevel (GTK_WIDGET (tasklist))),
       G_CALLBACK (xfce_tasklist_configure_event), tasklist);
 
+  /* disconnect icon theme signal */
+  g_signal_handlers_disconnect_by_func (G_OBJECT (gtk_icon_theme_get_default ()),
+      G_CALLBACK (xfce_tasklist_icon_theme_changed), tasklist);
+
   /* disconnect monitor signals */
   n = g_signal_handlers_disconnect_matched (G_OBJECT (tasklist->screen),
       G_SIGNAL_MATCH_DATA, 0, 0, NULL, NULL, tasklist);
@@ -1728,10 +2128,12 @@ xfce_tasklist_disconnect_screen (XfceTasklist *tasklist)
     }
 
   /* remove all the windows */
-  for (wi = tasklist->windows; wi != NULL; wi = wnext)
+  for (wi = g_sequence_get_begin_iter (tasklist->windows);
+       !g_sequence_iter_is_end (wi);
+       wi = wnext)
     {
-      wnext = wi->next;
-      child = wi->data;
+      wnext = g_sequence_iter_next (wi);
+      child = g_sequence_get (wi);
 
       /* do a fake window remove */
       panel_return_if_fail (child->type != CHILD_TYPE_GROUP);
@@ -1739,7 +2141,7 @@ xfce_tasklist_disconnect_screen (XfceTasklist *tasklist)
       xfce_tasklist_window_removed (tasklist->screen, child->window, tasklist);
     }
 
-  panel_assert (tasklist->windows == NULL);
+  panel_assert (g_sequence_is_empty (tasklist->windows));
   panel_assert (tasklist->skipped_windows == NULL);
 
   tasklist->screen = NULL;
@@ -1772,7 +2174,7 @@ xfce_tasklist_active_window_changed (WnckScreen   *screen,
 {
   WnckWindow        *active_window;
   WnckClassGroup    *class_group = NULL;
-  GList             *li;
+  GSequenceIter     *iter;
   XfceTasklistChild *child;
 
   panel_return_if_fail (WNCK_IS_SCREEN (screen));
@@ -1786,14 +2188,24 @@ xfce_tasklist_active_window_changed (WnckScreen   *screen,
   /* lock the taskbar */
   xfce_taskbar_lock (tasklist);
 
-  for (li = tasklist->windows; li != NULL; li = li->next)
+  for (iter = g_sequence_get_begin_iter (tasklist->windows);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
     {
-      child = li->data;
+      child = g_sequence_get (iter);
 
       /* update timestamp for window */
       if (child->window == active_window)
         {
           child->last_focused = g_get_real_time ();
+          if (child->ranking_iter != NULL)
+            g_sequence_sort_changed (child->ranking_iter,
+                                     xfce_tasklist_size_sort_window, NULL);
+
+          /* move the window out of the overflow menu */
+          if (child->type == CHILD_TYPE_OVERFLOW_MENU)
+            xfce_tasklist_queue_layout (tasklist);
+
           /* the active window is in a group, so find the group button */
           if (child->type == CHILD_TYPE_GROUP_MENU)
             {
@@ -1808,9 +2220,11 @@ xfce_tasklist_active_window_changed (WnckScreen   *screen,
   /* set the toggle button state for the group button */
   if (class_group)
     {
-      for (li = tasklist->windows; li != NULL; li = li->next)
+      for (iter = g_sequence_get_begin_iter (tasklist->windows);
+           !g_sequence_iter_is_end (iter);
+           iter = g_sequence_iter_next (iter))
       {
-        child = li->data;
+        child = g_sequence_get (iter);
         if (child->type == CHILD_TYPE_GROUP
           && child->class_group == class_group)
           {
@@ -1833,31 +2247,45 @@ xfce_tasklist_active_workspace_changed (WnckScreen    *screen,
                                         WnckWorkspace *previous_workspace,
                                         XfceTasklist  *tasklist)
 {
-  GList             *windows, *li;
+  GPtrArray         *windows;
+  GSequenceIter     *iter;
   WnckWorkspace     *active_ws;
   XfceTasklistChild *child;
+  guint              i;
 
   panel_return_if_fail (WNCK_IS_SCREEN (screen));
   panel_return_if_fail (previous_workspace == NULL || WNCK_IS_WORKSPACE (previous_workspace));
   panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
   panel_return_if_fail (tasklist->screen == screen);
 
-  /* leave when we are locked or show all workspaces. the null
-   * check for @previous_workspace is used to update the tasklist
-   * on setting changes */
-  if (xfce_taskbar_is_locked (tasklist)
-      || (previous_workspace != NULL
-          && tasklist->all_workspaces))
+  /* leave when we are locked */
+  if (xfce_taskbar_is_locked (tasklist))
+    return;
+
+  /* pinned windows are sorted in the active workspace */
+  if (tasklist->all_workspaces)
+    xfce_tasklist_sort (tasklist, FALSE);
+
+  /* leave when we show all workspaces. the null check for
+   * @previous_workspace is used to update the tasklist on
+   * setting changes */
+  if (previous_workspace != NULL
+      && tasklist->all_workspaces)
     return;
 
   /* walk all the children and update their visibility: make a copy of the window list
    * here because changing the buttons visibility can change the group buttons visibility,
    * which in turn can change the list order */
   active_ws = wnck_screen_get_active_workspace (screen);
-  windows = g_list_copy (tasklist->windows);
-  for (li = windows; li != NULL; li = li->next)
+  windows = g_ptr_array_sized_new (g_sequence_get_length (tasklist->windows));
+  for (iter = g_sequence_get_begin_iter (tasklist->windows);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
+    g_ptr_array_add (windows, g_sequence_get (iter));
+
+  for (i = 0; i < windows->len; i++)
     {
-      child = li->data;
+      child = g_ptr_array_index (windows, i);
 
       if (child->type != CHILD_TYPE_GROUP)
         {
@@ -1867,7 +2295,7 @@ xfce_tasklist_active_workspace_changed (WnckScreen    *screen,
             gtk_widget_hide (child->button);
         }
     }
-  g_list_free (windows);
+  g_ptr_array_free (windows, TRUE);
 }
 
 
@@ -1897,12 +2325,18 @@ xfce_tasklist_window_added (WnckScreen   *screen,
       return;
     }
 
+  PANEL_PROBE1 (tasklist_window_add_start, wnck_window_get_xid (window));
+
   /* create new window button */
   child = xfce_tasklist_button_new (window, tasklist);
 
-  /* initial visibility of the function */
+  /* initial visibility of the function, the button contents are only
+   * filled in once the button is visible */
   if (xfce_tasklist_button_visible (child, wnck_screen_get_active_workspace (screen)))
-    gtk_widget_show (child->button);
+    {
+      gtk_widget_show (child->button);
+      xfce_tasklist_button_materialize (child);
+    }
 
   if (G_LIKELY (child->class_group != NULL))
     {
@@ -1942,7 +2376,9 @@ xfce_tasklist_window_added (WnckScreen   *screen,
   if (wnck_window_needs_attention (window))
     xfce_tasklist_button_state_changed (window, URGENT_FLAGS, URGENT_FLAGS, child);
 
-  gtk_widget_queue_resize (GTK_WIDGET (tasklist));
+  xfce_tasklist_queue_layout (tasklist);
+
+  PANEL_PROBE1 (tasklist_window_add_end, wnck_window_get_xid (window));
 }
 
 
@@ -1952,7 +2388,6 @@ xfce_tasklist_window_removed (WnckScreen   *screen,
                               WnckWindow   *window,
                               XfceTasklist *tasklist)
 {
-  GList             *li;
   GSList            *lp;
   XfceTasklistChild *child;
   guint              n;
@@ -1973,44 +2408,42 @@ xfce_tasklist_window_removed (WnckScreen   *screen,
       return;
     }
 
+  PANEL_PROBE1 (tasklist_window_remove_start, wnck_window_get_xid (window));
+
   /* remove the child from the taskbar */
-  for (li = tasklist->windows; li != NULL; li = li->next)
+  child = g_hash_table_lookup (tasklist->window_children, window);
+  if (child != NULL)
     {
-      child = li->data;
-
-      if (child->window == window)
+      if (child->class_group != NULL)
         {
-          if (child->class_group != NULL)
-            {
-              panel_return_if_fail (WNCK_IS_CLASS_GROUP (child->class_group));
-              g_object_unref (G_OBJECT (child->class_group));
-            }
+          panel_return_if_fail (WNCK_IS_CLASS_GROUP (child->class_group));
+          g_object_unref (G_OBJECT (child->class_group));
+        }
 
-          /* disconnect from all the window watch functions */
-          panel_return_if_fail (WNCK_IS_WINDOW (window));
-          n = g_signal_handlers_disconnect_matched (G_OBJECT (window),
-              G_SIGNAL_MATCH_DATA, 0, 0, NULL, NULL, child);
+      /* disconnect from all the window watch functions */
+      panel_return_if_fail (WNCK_IS_WINDOW (window));
+      n = g_signal_handlers_disconnect_matched (G_OBJECT (window),
+          G_SIGNAL_MATCH_DATA, 0, 0, NULL, NULL, child);
 
 #ifdef GDK_WINDOWING_X11
-          /* hide the wireframe */
-          if (G_UNLIKELY (n > 6 && tasklist->show_wireframes))
-            {
-              xfce_tasklist_wireframe_hide (tasklist);
-              n--;
-            }
+      /* hide the wireframe */
+      if (G_UNLIKELY (n > 6 && tasklist->show_wireframes))
+        {
+          xfce_tasklist_wireframe_hide (tasklist);
+          n--;
+        }
 #endif
 
-          panel_return_if_fail (n == 6);
-
-          /* destroy the button, this will free the child data in the
-           * container remove function */
-          gtk_widget_destroy (child->button);
+      panel_return_if_fail (n == 6);
 
-          break;
-        }
+      /* destroy the button, this will free the child data in the
+       * container remove function */
+      gtk_widget_destroy (child->button);
     }
 
-    gtk_widget_queue_resize (GTK_WIDGET (tasklist));
+    xfce_tasklist_queue_layout (tasklist);
+
+  PANEL_PROBE1 (tasklist_window_remove_end, wnck_window_get_xid (window));
 }
 
 
@@ -2063,80 +2496,356 @@ xfce_tasklist_sort (XfceTasklist *tasklist,
 {
   panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
 
+  PANEL_PROBE1 (tasklist_sort_start, sort_groups);
+
   if (tasklist->sort_order != XFCE_TASKLIST_SORT_ORDER_DND)
     {
-      tasklist->windows = g_list_sort_with_data (tasklist->windows,
-                                                 xfce_tasklist_button_compare,
-                                                 tasklist);
+      g_sequence_sort (tasklist->windows, xfce_tasklist_button_compare, tasklist);
       if (sort_groups && tasklist->grouping)
-        for (GList *lp = tasklist->windows; lp != NULL; lp = lp->next)
+        for (GSequenceIter *iter = g_sequence_get_begin_iter (tasklist->windows);
+             !g_sequence_iter_is_end (iter);
+             iter = g_sequence_iter_next (iter))
           {
-            XfceTasklistChild *child = lp->data;
+            XfceTasklistChild *child = g_sequence_get (iter);
 
             if (child->type == CHILD_TYPE_GROUP)
               xfce_tasklist_group_button_sort (child);
           }
     }
 
+  PANEL_PROBE1 (tasklist_sort_end, sort_groups);
+
+  xfce_tasklist_queue_layout (tasklist);
+}
+
+
+
+static gboolean
+xfce_tasklist_sort_child (XfceTasklistChild *child)
+{
+  XfceTasklist  *tasklist = child->tasklist;
+  GSequenceIter *sibling;
+  gboolean       sorted = TRUE;
+
+  panel_return_val_if_fail (XFCE_IS_TASKLIST (tasklist), FALSE);
+
+  if (tasklist->sort_order == XFCE_TASKLIST_SORT_ORDER_DND
+      || child->windows_iter == NULL)
+    return FALSE;
+
+  PANEL_PROBE (tasklist_sort_child_start);
+
+  /* nothing to do if the button is still in order with its neighbours,
+   * for example if the sort order does not depend on the window title */
+  if (!g_sequence_iter_is_begin (child->windows_iter))
+    {
+      sibling = g_sequence_iter_prev (child->windows_iter);
+      sorted = xfce_tasklist_button_compare (g_sequence_get (sibling), child, tasklist) <= 0;
+    }
+
+  if (sorted)
+    {
+      sibling = g_sequence_iter_next (child->windows_iter);
+      if (!g_sequence_iter_is_end (sibling))
+        sorted = xfce_tasklist_button_compare (child, g_sequence_get (sibling), tasklist) <= 0;
+    }
+
+  if (!sorted)
+    {
+      /* only the title or timestamp of this window changed, so move it to
+       * its new position instead of sorting the whole tasklist. changes
+       * that affect the order of other buttons (workspaces, class group
+       * names) use xfce_tasklist_sort() */
+      g_sequence_sort_changed (child->windows_iter, xfce_tasklist_button_compare, tasklist);
+      xfce_tasklist_queue_layout (tasklist);
+    }
+
+  PANEL_PROBE1 (tasklist_sort_child_end, !sorted);
+
+  return !sorted;
+}
+
+
+
+static void
+xfce_tasklist_queue_layout (XfceTasklist *tasklist)
+{
+  panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
+
+  /* the position or number of buttons changed */
+  tasklist->layout_dirty = TRUE;
   gtk_widget_queue_resize (GTK_WIDGET (tasklist));
 }
 
 
 
+static gboolean
+xfce_tasklist_report_stats (gpointer data)
+{
+  XfceTasklist  *tasklist = XFCE_TASKLIST (data);
+  gint64         timestamp;
+  gint64         cpu_time = 0;
+  glong          max_rss = 0;
+  gulong         request_serial = 0;
+#ifdef HAVE_SYS_RESOURCE_H
+  struct rusage  usage;
+#endif
+
+  timestamp = g_get_monotonic_time ();
+
+#ifdef HAVE_SYS_RESOURCE_H
+  /* cpu time and peak memory usage of the process hosting the tasklist */
+  if (getrusage (RUSAGE_SELF, &usage) == 0)
+    {
+      cpu_time = (gint64) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * G_USEC_PER_SEC
+                 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+      max_rss = usage.ru_maxrss;
+    }
+#endif
+
+#ifdef GDK_WINDOWING_X11
+  /* the request serial tells how many requests were sent to the X server */
+  if (GDK_IS_X11_DISPLAY (gtk_widget_get_display (GTK_WIDGET (tasklist))))
+    request_serial = NextRequest (GDK_DISPLAY_XDISPLAY (gtk_widget_get_display (GTK_WIDGET (tasklist))));
+#endif
+
+  /* print the statistics as a single json object at the end of the
+   * line, so runs of tasklist-benchmark.py can be compared */
+  if (tasklist->stats_timestamp > 0)
+    panel_debug_filtered (PANEL_DEBUG_TASKLIST,
+                          "%p: stats {\"interval_ms\": %" G_GINT64_FORMAT ", "
+                          "\"windows\": %d, \"name_changes\": %u, \"icon_changes\": %u, "
+                          "\"button_updates\": %u, \"sorts\": %u, \"layouts\": %u, "
+                          "\"layouts_skipped\": %u, \"max_update_latency_us\": %" G_GINT64_FORMAT ", "
+                          "\"cpu_time_us\": %" G_GINT64_FORMAT ", \"x_requests\": %lu, "
+                          "\"max_rss_kb\": %ld}",
+                          tasklist, (timestamp - tasklist->stats_timestamp) / 1000,
+                          g_sequence_get_length (tasklist->windows),
+                          tasklist->stats_name_changes, tasklist->stats_icon_changes,
+                          tasklist->stats_updates, tasklist->stats_sorts,
+                          tasklist->stats_layouts, tasklist->stats_layouts_skipped,
+                          tasklist->stats_max_latency,
+                          cpu_time - tasklist->stats_cpu_time,
+                          request_serial - tasklist->stats_request_serial,
+                          max_rss);
+
+  tasklist->stats_timestamp = timestamp;
+  tasklist->stats_cpu_time = cpu_time;
+  tasklist->stats_request_serial = request_serial;
+  tasklist->stats_max_latency = 0;
+  tasklist->stats_name_changes = 0;
+  tasklist->stats_icon_changes = 0;
+  tasklist->stats_updates = 0;
+  tasklist->stats_sorts = 0;
+  tasklist->stats_layouts = 0;
+  tasklist->stats_layouts_skipped = 0;
+
+  return G_SOURCE_CONTINUE;
+}
+
+
+
+static void
+xfce_tasklist_report_stats_destroyed (gpointer data)
+{
+  XFCE_TASKLIST (data)->stats_timeout_id = 0;
+}
+
+
+
+static gboolean
+xfce_tasklist_update_buttons (GtkWidget     *widget,
+                              GdkFrameClock *frame_clock,
+                              gpointer       user_data)
+{
+  XfceTasklist      *tasklist = XFCE_TASKLIST (widget);
+  GSList            *pending, *li;
+  XfceTasklistChild *child;
+
+  pending = tasklist->pending_children;
+  tasklist->pending_children = NULL;
+
+  for (li = pending; li != NULL; li = li->next)
+    {
+      child = li->data;
+      child->pending = FALSE;
+
+      if (child->sort_dirty)
+        {
+          child->sort_dirty = FALSE;
+          if (xfce_tasklist_sort_child (child))
+            tasklist->stats_sorts++;
+        }
+
+      /* hidden buttons keep their outdated contents until they are shown */
+      if ((child->icon_dirty || child->name_dirty)
+          && xfce_tasklist_button_on_screen (child))
+        {
+          xfce_tasklist_button_materialize (child);
+          tasklist->stats_updates++;
+        }
+    }
+
+  g_slist_free (pending);
+
+  /* time between the first queued change and applying it */
+  if (tasklist->stats_pending_since > 0)
+    {
+      tasklist->stats_max_latency = MAX (tasklist->stats_max_latency,
+                                         g_get_monotonic_time () - tasklist->stats_pending_since);
+      tasklist->stats_pending_since = 0;
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+xfce_tasklist_update_buttons_destroyed (gpointer data)
+{
+  XFCE_TASKLIST (data)->update_buttons_id = 0;
+}
+
+
+
+static void
+xfce_tasklist_button_queue_update (XfceTasklistChild *child)
+{
+  XfceTasklist *tasklist = child->tasklist;
+
+  panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
+
+  if (!child->pending)
+    {
+      if (tasklist->pending_children == NULL)
+        tasklist->stats_pending_since = g_get_monotonic_time ();
+
+      child->pending = TRUE;
+      tasklist->pending_children = g_slist_prepend (tasklist->pending_children, child);
+    }
+
+  /* windows can change their name many times per second, only update
+   * the buttons once per frame */
+  if (tasklist->update_buttons_id == 0)
+    tasklist->update_buttons_id = gtk_widget_add_tick_callback (GTK_WIDGET (tasklist),
+                                                                xfce_tasklist_update_buttons,
+                                                                tasklist,
+                                                                xfce_tasklist_update_buttons_destroyed);
+}
+
+
+
+static gboolean
+xfce_tasklist_child_set_icon_geometry (XfceTasklistChild  *child,
+                                       const GdkRectangle *geometry)
+{
+#ifdef GDK_WINDOWING_X11
+  gulong data[4];
+#endif
+
+  panel_return_val_if_fail (WNCK_IS_WINDOW (child->window), FALSE);
+
+  /* nothing to do if the window manager already knows this geometry */
+  if (gdk_rectangle_equal (&child->icon_geometry, geometry))
+    return FALSE;
+
+  child->icon_geometry = *geometry;
+
+#ifdef GDK_WINDOWING_X11
+  /* write the property ourselves, wnck_window_set_icon_geometry() does a
+   * round-trip for each window, the caller syncs once for the whole batch */
+  data[0] = geometry->x;
+  data[1] = geometry->y;
+  data[2] = geometry->width;
+  data[3] = geometry->height;
+
+  XChangeProperty (GDK_DISPLAY_XDISPLAY (child->tasklist->display),
+                   wnck_window_get_xid (child->window),
+                   gdk_x11_get_xatom_by_name_for_display (child->tasklist->display,
+                                                          "_NET_WM_ICON_GEOMETRY"),
+                   XA_CARDINAL, 32, PropModeReplace, (guchar *) data, 4);
+#else
+  wnck_window_set_icon_geometry (child->window, geometry->x, geometry->y,
+                                 geometry->width, geometry->height);
+#endif
+
+  return TRUE;
+}
+
+
+
 static gboolean
 xfce_tasklist_update_icon_geometries (gpointer data)
 {
 
   XfceTasklist      *tasklist = XFCE_TASKLIST (data);
-  GList             *li;
+  GSequenceIter     *iter;
   GSList            *lp;
   gint               root_x, root_y;
   GtkWidget         *toplevel;
+  guint              n_changed = 0;
+
+  panel_return_val_if_fail (XFCE_IS_TASKLIST (tasklist), G_SOURCE_REMOVE);
+
+  if (G_UNLIKELY (tasklist->display == NULL))
+    return G_SOURCE_REMOVE;
 
   toplevel = gtk_widget_get_toplevel (GTK_WIDGET (tasklist));
   gtk_window_get_position (GTK_WINDOW (toplevel), &root_x, &root_y);
-  panel_return_val_if_fail (XFCE_IS_TASKLIST (tasklist), G_SOURCE_REMOVE);
 
-  for (li = tasklist->windows; li != NULL; li = li->next)
+#ifdef GDK_WINDOWING_X11
+  /* windows can disappear before the window manager sees the new geometry */
+  gdk_x11_display_error_trap_push (tasklist->display);
+#endif
+
+  for (iter = g_sequence_get_begin_iter (tasklist->windows);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
     {
-      XfceTasklistChild *child, *child2;
+      XfceTasklistChild *child;
       GtkAllocation      alloc;
 
-      child = li->data;
+      child = g_sequence_get (iter);
 
       switch (child->type)
         {
         case CHILD_TYPE_WINDOW:
           gtk_widget_get_allocation (child->button, &alloc);
-          wnck_window_set_icon_geometry (child->window, alloc.x + root_x,
-                                         alloc.y + root_y, alloc.width,
-                                         alloc.height);
           break;
 
         case CHILD_TYPE_GROUP:
           gtk_widget_get_allocation (child->button, &alloc);
+          alloc.x += root_x;
+          alloc.y += root_y;
           for (lp = child->windows; lp != NULL; lp = lp->next)
-            {
-              child2 = lp->data;
-              wnck_window_set_icon_geometry (child2->window, alloc.x + root_x,
-                                             alloc.y + root_y, alloc.width,
-                                             alloc.height);
-            }
-          break;
+            n_changed += xfce_tasklist_child_set_icon_geometry (lp->data, &alloc);
+          continue;
 
         case CHILD_TYPE_OVERFLOW_MENU:
           gtk_widget_get_allocation (tasklist->arrow_button, &alloc);
-          wnck_window_set_icon_geometry (child->window, alloc.x + root_x,
-                                         alloc.y + root_y, alloc.width,
-                                         alloc.height);
           break;
 
         case CHILD_TYPE_GROUP_MENU:
+        default:
           /* we already handled those in the group button */
-          break;
+          continue;
         };
+
+      alloc.x += root_x;
+      alloc.y += root_y;
+      n_changed += xfce_tasklist_child_set_icon_geometry (child, &alloc);
     }
 
+#ifdef GDK_WINDOWING_X11
+  /* flush all the property changes at once */
+  gdk_x11_display_error_trap_pop_ignored (tasklist->display);
+#endif
+  if (n_changed > 0)
+    gdk_display_flush (tasklist->display);
+
+  panel_debug_filtered (PANEL_DEBUG_TASKLIST, "updated %u icon geometries", n_changed);
+
   return G_SOURCE_REMOVE;
 }
 
@@ -2299,6 +3008,15 @@ xfce_tasklist_child_drag_end_event (GtkWidget      *widget,
 
 
 
+static void
+xfce_tasklist_child_visible_changed (XfceTasklist *tasklist)
+{
+  /* the number of buttons in the tasklist changed */
+  tasklist->layout_dirty = TRUE;
+}
+
+
+
 static XfceTasklistChild *
 xfce_tasklist_child_new (XfceTasklist *tasklist)
 {
@@ -2312,9 +3030,15 @@ xfce_tasklist_child_new (XfceTasklist *tasklist)
   child = g_slice_new0 (XfceTasklistChild);
   child->tasklist = tasklist;
 
+  /* force the first icon geometry update */
+  child->icon_geometry.width = -1;
+
   /* create the window button */
   child->button = xfce_arrow_button_new (GTK_ARROW_NONE);
+  g_object_set_qdata (G_OBJECT (child->button), child_quark, child);
   gtk_widget_set_parent (child->button, GTK_WIDGET (tasklist));
+  g_signal_connect_swapped (G_OBJECT (child->button), "notify::visible",
+                            G_CALLBACK (xfce_tasklist_child_visible_changed), tasklist);
   gtk_button_set_relief (GTK_BUTTON (child->button),
                          tasklist->button_relief);
   gtk_widget_add_events (GTK_WIDGET(child->button), GDK_SCROLL_MASK
@@ -2335,7 +3059,7 @@ xfce_tasklist_child_new (XfceTasklist *tasklist)
                                 tasklist->minimized_icon_lucency % 100);
   gtk_css_provider_load_from_data (provider, css_string, -1, NULL);
   child->icon = gtk_image_new ();
-  child->pixbuf = NULL;
+  child->cached_icon = NULL;
   gtk_style_context_add_provider (gtk_widget_get_style_context (child->icon),
                                   GTK_STYLE_PROVIDER (provider),
                                   GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
@@ -2751,38 +3475,112 @@ force_box_layout_update (XfceTasklistChild *child)
 
 
 static void
-xfce_tasklist_button_icon_changed (WnckWindow        *window,
-                                   XfceTasklistChild *child)
+xfce_tasklist_child_set_icon (XfceTasklistChild *child,
+                              GdkPixbuf         *source,
+                              WnckWindow        *window)
+{
+  XfceTasklistIcon *icon = NULL;
+  gint              old_width = -1, old_height = -1;
+
+  if (G_LIKELY (source != NULL))
+    icon = xfce_tasklist_icon_lookup (child->tasklist, source, window);
+
+  if (child->cached_icon != NULL)
+    {
+      old_width = gdk_pixbuf_get_width (child->cached_icon->pixbuf);
+      old_height = gdk_pixbuf_get_height (child->cached_icon->pixbuf);
+      xfce_tasklist_icon_release (child->tasklist, child->cached_icon);
+    }
+
+  /* nothing changed if we got the same shared icon */
+  if (icon != NULL && icon == child->cached_icon)
+    return;
+
+  child->cached_icon = icon;
+
+  if (icon != NULL)
+    {
+      gtk_image_set_from_surface (GTK_IMAGE (child->icon), icon->surface);
+
+      if (old_width != gdk_pixbuf_get_width (icon->pixbuf)
+          || old_height != gdk_pixbuf_get_height (icon->pixbuf))
+        force_box_layout_update (child);
+    }
+  else
+    {
+      gtk_image_clear (GTK_IMAGE (child->icon));
+      force_box_layout_update (child);
+    }
+}
+
+
+
+static inline gboolean
+xfce_tasklist_button_on_screen (XfceTasklistChild *child)
+{
+  XfceTasklistChild *group_child = NULL;
+
+  /* whether the button is shown in the tasklist or in an open menu,
+   * the proxy menu items are bound to the button contents */
+  if (!gtk_widget_get_visible (child->button))
+    return FALSE;
+
+  switch (child->type)
+    {
+    case CHILD_TYPE_WINDOW:
+      return TRUE;
+
+    case CHILD_TYPE_OVERFLOW_MENU:
+      return child->tasklist->arrow_button != NULL
+             && gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (child->tasklist->arrow_button));
+
+    case CHILD_TYPE_GROUP_MENU:
+      if (child->class_group != NULL)
+        group_child = g_hash_table_lookup (child->tasklist->class_groups, child->class_group);
+      return group_child != NULL
+             && gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (group_child->button));
+
+    default:
+      return FALSE;
+    }
+}
+
+
+
+static void
+xfce_tasklist_button_icon_update (XfceTasklistChild *child)
 {
   GtkStyleContext *context;
   GdkPixbuf       *pixbuf;
-  cairo_surface_t *surface;
   XfceTasklist    *tasklist = child->tasklist;
-  gint             icon_size, scale_factor, old_width = -1, old_height = -1;
+  WnckWindow      *window = child->window;
+  gint             icon_size;
 
   panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
   panel_return_if_fail (GTK_IS_WIDGET (child->icon));
   panel_return_if_fail (WNCK_IS_WINDOW (window));
-  panel_return_if_fail (child->window == window);
+
+  child->icon_dirty = FALSE;
 
   /* 0 means icons are disabled */
   if (tasklist->minimized_icon_lucency == 0)
     return;
 
   icon_size = xfce_panel_plugin_get_icon_size (xfce_tasklist_get_panel_plugin (tasklist));
-  scale_factor = gtk_widget_get_scale_factor (GTK_WIDGET (child->tasklist));
   context = gtk_widget_get_style_context (GTK_WIDGET (child->icon));
 
-  /* get the window icon */
-  pixbuf = xfce_tasklist_get_window_icon (child->window, icon_size, child->type);
+  /* get the window icon, shared with the other windows showing the
+   * same icon */
+  if (child->type == CHILD_TYPE_GROUP_MENU || icon_size < WNCK_DEFAULT_ICON_SIZE)
+    pixbuf = wnck_window_get_mini_icon (window);
+  else
+    pixbuf = wnck_window_get_icon (window);
+
+  xfce_tasklist_child_set_icon (child, pixbuf, window);
+
   /* leave when there is no valid pixbuf */
   if (G_UNLIKELY (pixbuf == NULL))
-    {
-      g_clear_object (&child->pixbuf);
-      gtk_image_clear (GTK_IMAGE (child->icon));
-      force_box_layout_update (child);
-      return;
-    }
+    return;
 
   /* create a spotlight version of the icon when minimized */
   if (!tasklist->only_minimized
@@ -2798,36 +3596,38 @@ xfce_tasklist_button_icon_changed (WnckWindow        *window,
         gtk_style_context_remove_class (context, "minimized");
     }
 
-  if (child->pixbuf != NULL)
-    {
-       old_width = gdk_pixbuf_get_width (child->pixbuf);
-       old_height = gdk_pixbuf_get_height (child->pixbuf);
-       g_object_unref (child->pixbuf);
-    }
+}
 
-  child->pixbuf = pixbuf;
-  surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, scale_factor, NULL);
-  gtk_image_set_from_surface (GTK_IMAGE (child->icon), surface);
-  cairo_surface_destroy (surface);
 
-  if (old_width != gdk_pixbuf_get_width (pixbuf) || old_height != gdk_pixbuf_get_height (pixbuf))
-    force_box_layout_update (child);
+
+static void
+xfce_tasklist_button_icon_changed (WnckWindow        *window,
+                                   XfceTasklistChild *child)
+{
+  panel_return_if_fail (WNCK_IS_WINDOW (window));
+  panel_return_if_fail (child->window == window);
+
+  /* loading and scaling the icon is expensive, so postpone it until
+   * the next frame and only if the button is visible or shown in a menu */
+  child->icon_dirty = TRUE;
+  child->tasklist->stats_icon_changes++;
+  xfce_tasklist_button_queue_update (child);
 }
 
 
 
 static void
-xfce_tasklist_button_name_changed (WnckWindow        *window,
-                                   XfceTasklistChild *child)
+xfce_tasklist_button_name_update (XfceTasklistChild *child)
 {
   const gchar     *name;
   gchar           *label = NULL;
   GtkStyleContext *ctx;
 
-  panel_return_if_fail (window == NULL || child->window == window);
   panel_return_if_fail (WNCK_IS_WINDOW (child->window));
   panel_return_if_fail (XFCE_IS_TASKLIST (child->tasklist));
 
+  child->name_dirty = FALSE;
+
   name = wnck_window_get_name (child->window);
   gtk_widget_set_tooltip_text (GTK_WIDGET (child->button), name);
   gtk_widget_set_has_tooltip (GTK_WIDGET (child->button), child->tasklist->show_tooltips);
@@ -2852,15 +3652,57 @@ xfce_tasklist_button_name_changed (WnckWindow        *window,
         gtk_style_context_add_class (ctx, "label-hidden");
     }
 
-  gtk_label_set_text (GTK_LABEL (child->label), name);
+  /* setting the same text would still queue a resize */
+  if (g_strcmp0 (gtk_label_get_text (GTK_LABEL (child->label)), name) != 0)
+    gtk_label_set_text (GTK_LABEL (child->label), name);
   gtk_label_set_ellipsize (GTK_LABEL (child->label), child->tasklist->ellipsize_mode);
 
   g_free (label);
+}
+
+
+
+static void
+xfce_tasklist_button_name_changed (WnckWindow        *window,
+                                   XfceTasklistChild *child)
+{
+  panel_return_if_fail (window == NULL || child->window == window);
+  panel_return_if_fail (WNCK_IS_WINDOW (child->window));
 
   /* if window is null, we have not inserted the button the in
    * tasklist, so no need to sort, because we insert with sorting */
-  if (window != NULL)
-    xfce_tasklist_sort (child->tasklist, FALSE);
+  if (window == NULL)
+    {
+      /* only relabel buttons that are visible, the others are updated
+       * when they appear in the tasklist or a menu */
+      if (xfce_tasklist_button_on_screen (child))
+        xfce_tasklist_button_name_update (child);
+      else
+        child->name_dirty = TRUE;
+
+      return;
+    }
+
+  /* coalesce name changes, the label and position in the tasklist
+   * are updated at most once per frame */
+  child->name_dirty = TRUE;
+  child->sort_dirty = TRUE;
+  child->tasklist->stats_name_changes++;
+  xfce_tasklist_button_queue_update (child);
+}
+
+
+
+static void
+xfce_tasklist_button_materialize (XfceTasklistChild *child)
+{
+  panel_return_if_fail (child->type != CHILD_TYPE_GROUP);
+
+  if (child->icon_dirty)
+    xfce_tasklist_button_icon_update (child);
+
+  if (child->name_dirty)
+    xfce_tasklist_button_name_update (child);
 }
 
 
@@ -2992,6 +3834,8 @@ xfce_tasklist_button_workspace_changed (WnckWindow        *window,
   panel_return_if_fail (child->window == window);
   panel_return_if_fail (XFCE_IS_TASKLIST (child->tasklist));
 
+  /* the workspace order also depends on the active workspace for
+   * pinned windows, so don't assume the other buttons are in order */
   xfce_tasklist_sort (tasklist, FALSE);
   xfce_tasklist_active_window_changed (tasklist->screen, window, tasklist);
   if (!tasklist->all_workspaces)
@@ -3353,6 +4197,9 @@ xfce_tasklist_button_proxy_menu_item (XfceTasklistChild *child,
   panel_return_val_if_fail (GTK_IS_LABEL (child->label), NULL);
   panel_return_val_if_fail (WNCK_IS_WINDOW (child->window), NULL);
 
+  /* the menu item mirrors the button, so bring it up-to-date */
+  xfce_tasklist_button_materialize (child);
+
   mi = panel_image_menu_item_new ();
   g_object_bind_property (G_OBJECT (child->label), "label",
                           G_OBJECT (mi), "label",
@@ -3619,7 +4466,7 @@ xfce_tasklist_button_drag_data_received (GtkWidget         *button,
                                          guint              drag_time,
                                          XfceTasklistChild *child2)
 {
-  GList             *li, *sibling;
+  GSequenceIter     *iter, *sibling;
   gulong             xid;
   XfceTasklistChild *child;
   XfceTasklist      *tasklist = XFCE_TASKLIST (child2->tasklist);
@@ -3632,29 +4479,30 @@ xfce_tasklist_button_drag_data_received (GtkWidget         *button,
 
   gtk_widget_get_allocation (button, &allocation);
 
-  sibling = g_list_find (tasklist->windows, child2);
+  sibling = child2->windows_iter;
   panel_return_if_fail (sibling != NULL);
 
   if ((xfce_tasklist_horizontal (tasklist) && x >= allocation.width / 2)
       || (!xfce_tasklist_horizontal (tasklist) && y >= allocation.height / 2))
-    sibling = g_list_next (sibling);
+    sibling = g_sequence_iter_next (sibling);
 
   xid = *((gulong *) (gpointer) gtk_selection_data_get_data (selection_data));
-  for (li = tasklist->windows; li != NULL; li = li->next)
+  for (iter = g_sequence_get_begin_iter (tasklist->windows);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
     {
-      child = li->data;
+      child = g_sequence_get (iter);
 
-      if (sibling != li /* drop on end previous button */
+      if (sibling != iter /* drop on end previous button */
           && child != child2 /* drop on the same button */
-          && g_list_next (li) != sibling /* drop start of next button */
+          && g_sequence_iter_next (iter) != sibling /* drop start of next button */
           && child->window != NULL
           && wnck_window_get_xid (child->window) == xid)
         {
           /* swap items */
-          tasklist->windows = g_list_delete_link (tasklist->windows, li);
-          tasklist->windows = g_list_insert_before (tasklist->windows, sibling, child);
+          g_sequence_move (iter, sibling);
 
-          gtk_widget_queue_resize (GTK_WIDGET (tasklist));
+          xfce_tasklist_queue_layout (tasklist);
 
           break;
         }
@@ -3724,9 +4572,13 @@ xfce_tasklist_button_new (WnckWindow   *window,
   xfce_tasklist_button_name_changed (NULL, child);
 
   /* insert */
-  tasklist->windows = g_list_insert_sorted_with_data (tasklist->windows, child,
-                                                      xfce_tasklist_button_compare,
-                                                      tasklist);
+  child->windows_iter = g_sequence_insert_sorted (tasklist->windows, child,
+                                                  xfce_tasklist_button_compare,
+                                                  tasklist);
+  child->ranking_iter = g_sequence_insert_sorted (tasklist->overflow_ranking, child,
+                                                  xfce_tasklist_size_sort_window,
+                                                  NULL);
+  g_hash_table_insert (tasklist->window_children, window, child);
 
   return child;
 }
@@ -4024,11 +4876,11 @@ xfce_tasklist_group_button_button_draw (GtkWidget         *widget,
           pango_font_description_free (desc);
         }
 
-      if (group_child->pixbuf != NULL)
+      if (group_child->cached_icon != NULL)
         {
           gint scale_factor = gtk_widget_get_scale_factor (GTK_WIDGET (group_child->tasklist));
-          icon_pixbuf_rect.width = gdk_pixbuf_get_width (group_child->pixbuf) / scale_factor;
-          icon_pixbuf_rect.height = gdk_pixbuf_get_height (group_child->pixbuf) / scale_factor;
+          icon_pixbuf_rect.width = gdk_pixbuf_get_width (group_child->cached_icon->pixbuf) / scale_factor;
+          icon_pixbuf_rect.height = gdk_pixbuf_get_height (group_child->cached_icon->pixbuf) / scale_factor;
         }
 
       pango_layout_get_pixel_extents (n_windows_layout, &ink_extent, &log_extent);
@@ -4234,7 +5086,9 @@ xfce_tasklist_group_button_name_changed (WnckClassGroup    *class_group,
   gtk_label_set_text (GTK_LABEL (group_child->label), name);
 
   /* don't sort if there is no need to update the sorting (ie. only number
-   * of windows is changed or button is not inserted in the tasklist yet */
+   * of windows is changed or button is not inserted in the tasklist yet,
+   * the window buttons of the group are sorted by the group name too,
+   * so sort the whole tasklist */
   if (class_group != NULL)
     xfce_tasklist_sort (group_child->tasklist, FALSE);
 }
@@ -4247,10 +5101,9 @@ xfce_tasklist_group_button_icon_changed (WnckClassGroup    *class_group,
 {
   GtkStyleContext   *context;
   GdkPixbuf         *pixbuf;
-  cairo_surface_t   *surface;
   GSList            *li;
   gboolean           all_minimized_in_group = TRUE;
-  gint               icon_size, scale_factor;
+  gint               icon_size;
 
   panel_return_if_fail (XFCE_IS_TASKLIST (group_child->tasklist));
   panel_return_if_fail (WNCK_IS_CLASS_GROUP (class_group));
@@ -4263,7 +5116,6 @@ xfce_tasklist_group_button_icon_changed (WnckClassGroup    *class_group,
     return;
 
   icon_size = xfce_panel_plugin_get_icon_size (xfce_tasklist_get_panel_plugin (group_child->tasklist));
-  scale_factor = gtk_widget_get_scale_factor (GTK_WIDGET (group_child->tasklist));
   context = gtk_widget_get_style_context (GTK_WIDGET (group_child->icon));
 
   /* get the class group icon */
@@ -4297,31 +5149,7 @@ xfce_tasklist_group_button_icon_changed (WnckClassGroup    *class_group,
         gtk_style_context_remove_class (context, "minimized");
     }
 
-  if (G_LIKELY (pixbuf != NULL))
-    {
-      gint old_width = -1, old_height = -1;
-
-      if (group_child->pixbuf != NULL)
-        {
-          old_width = gdk_pixbuf_get_width (group_child->pixbuf);
-          old_height = gdk_pixbuf_get_height (group_child->pixbuf);
-          g_object_unref (group_child->pixbuf);
-        }
-
-      group_child->pixbuf = g_object_ref (pixbuf);
-      surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, scale_factor, NULL);
-      gtk_image_set_from_surface (GTK_IMAGE (group_child->icon), surface);
-      cairo_surface_destroy (surface);
-
-      if (old_width != gdk_pixbuf_get_width (pixbuf) || old_height != gdk_pixbuf_get_height (pixbuf))
-        force_box_layout_update (group_child);
-    }
-  else
-    {
-      g_clear_object (&group_child->pixbuf);
-      gtk_image_clear (GTK_IMAGE (group_child->icon));
-      force_box_layout_update (group_child);
-    }
+  xfce_tasklist_child_set_icon (group_child, pixbuf, NULL);
 }
 
 
@@ -4341,7 +5169,7 @@ xfce_tasklist_group_button_remove (XfceTasklistChild *group_child)
   panel_return_if_fail (XFCE_IS_TASKLIST (group_child->tasklist));
   panel_return_if_fail (WNCK_IS_CLASS_GROUP (group_child->class_group));
   panel_return_if_fail (group_child->type == CHILD_TYPE_GROUP);
-  panel_return_if_fail (g_list_find (group_child->tasklist->windows, group_child) != NULL);
+  panel_return_if_fail (group_child->windows_iter != NULL);
 
   /* disconnect from all the group watch functions */
   n = g_signal_handlers_disconnect_matched (G_OBJECT (group_child->class_group),
@@ -4376,15 +5204,10 @@ xfce_tasklist_group_button_keep_dnd_position (XfceTasklistChild *group_child,
                                               XfceTasklistChild *sibling,
                                               XfceTasklistChild *moved)
 {
-  XfceTasklist *tasklist = group_child->tasklist;
+  panel_return_if_fail (sibling->windows_iter != NULL);
+  panel_return_if_fail (moved->windows_iter != NULL);
 
-  tasklist->windows = g_list_remove (tasklist->windows, moved);
-  for (GList *lp = tasklist->windows; lp != NULL; lp = lp->next)
-    if (lp->data == sibling)
-      {
-        tasklist->windows = g_list_insert_before (tasklist->windows, lp, moved);
-        break;
-      }
+  g_sequence_move (moved->windows_iter, sibling->windows_iter);
 }
 
 
@@ -4445,6 +5268,8 @@ xfce_tasklist_group_button_child_visible_changed (XfceTasklistChild *group_child
         child->type = type;
     }
 
+  group_child->tasklist->layout_dirty = TRUE;
+
   xfce_tasklist_group_button_name_changed (group_child->class_group, group_child);
 
   /* update group button urgency blinking if needed: do this last as it may change window
@@ -4577,9 +5402,9 @@ xfce_tasklist_group_button_new (WnckClassGroup *class_group,
   xfce_tasklist_group_button_name_changed (NULL, child);
 
   /* insert */
-  tasklist->windows = g_list_insert_sorted_with_data (tasklist->windows, child,
-                                                      xfce_tasklist_button_compare,
-                                                      tasklist);
+  child->windows_iter = g_sequence_insert_sorted (tasklist->windows, child,
+                                                  xfce_tasklist_button_compare,
+                                                  tasklist);
 
   return child;
 }
@@ -4640,7 +5465,7 @@ static void
 xfce_tasklist_set_button_relief (XfceTasklist   *tasklist,
                                  GtkReliefStyle  button_relief)
 {
-  GList             *li;
+  GSequenceIter     *iter;
   XfceTasklistChild *child;
 
   panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
@@ -4650,9 +5475,11 @@ xfce_tasklist_set_button_relief (XfceTasklist   *tasklist,
       tasklist->button_relief = button_relief;
 
       /* change the relief of all buttons in the list */
-      for (li = tasklist->windows; li != NULL; li = li->next)
+      for (iter = g_sequence_get_begin_iter (tasklist->windows);
+           !g_sequence_iter_is_end (iter);
+           iter = g_sequence_iter_next (iter))
         {
-          child = li->data;
+          child = g_sequence_get (iter);
           gtk_button_set_relief (GTK_BUTTON (child->button),
                                  button_relief);
         }
@@ -4669,7 +5496,7 @@ static void
 xfce_tasklist_set_show_labels (XfceTasklist *tasklist,
                                gboolean      show_labels)
 {
-  GList             *li;
+  GSequenceIter     *iter;
   XfceTasklistChild *child;
 
   panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
@@ -4681,9 +5508,11 @@ xfce_tasklist_set_show_labels (XfceTasklist *tasklist,
       tasklist->show_labels = show_labels;
 
       /* change the mode of all the buttons */
-      for (li = tasklist->windows; li != NULL; li = li->next)
+      for (iter = g_sequence_get_begin_iter (tasklist->windows);
+           !g_sequence_iter_is_end (iter);
+           iter = g_sequence_iter_next (iter))
         {
-          child = li->data;
+          child = g_sequence_get (iter);
 
           /* show or hide the label */
           if (show_labels)
@@ -4709,7 +5538,7 @@ xfce_tasklist_set_show_labels (XfceTasklist *tasklist,
             xfce_tasklist_group_button_icon_changed (child->class_group, child);
           else
             xfce_tasklist_button_icon_changed (child->window, child);
-          gtk_widget_queue_resize (GTK_WIDGET (tasklist));
+          xfce_tasklist_queue_layout (tasklist);
         }
     }
 }
@@ -4757,7 +5586,7 @@ static void
 xfce_tasklist_set_label_decorations (XfceTasklist *tasklist,
                                      gboolean      label_decorations)
 {
-  GList             *li;
+  GSequenceIter     *iter;
   XfceTasklistChild *child;
 
   panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
@@ -4766,9 +5595,11 @@ xfce_tasklist_set_label_decorations (XfceTasklist *tasklist,
     {
       tasklist->label_decorations = label_decorations;
 
-      for (li = tasklist->windows; li != NULL; li = li->next)
+      for (iter = g_sequence_get_begin_iter (tasklist->windows);
+           !g_sequence_iter_is_end (iter);
+           iter = g_sequence_iter_next (iter))
         {
-          child = li->data;
+          child = g_sequence_get (iter);
           xfce_tasklist_button_name_changed (NULL, child);
         }
     }
@@ -4801,15 +5632,17 @@ static void
 xfce_tasklist_update_orientation (XfceTasklist *tasklist)
 {
   gboolean           horizontal;
-  GList             *li;
+  GSequenceIter     *iter;
   XfceTasklistChild *child;
 
   horizontal = !xfce_tasklist_vertical (tasklist);
 
   /* update the tasklist */
-  for (li = tasklist->windows; li != NULL; li = li->next)
+  for (iter = g_sequence_get_begin_iter (tasklist->windows);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
     {
-      child = li->data;
+      child = g_sequence_get (iter);
 
       /* update task box */
       gtk_orientable_set_orientation (GTK_ORIENTABLE (child->box),
@@ -4832,7 +5665,7 @@ xfce_tasklist_update_orientation (XfceTasklist *tasklist)
         }
     }
 
-  gtk_widget_queue_resize (GTK_WIDGET (tasklist));
+  xfce_tasklist_queue_layout (tasklist);
 }
 
 
@@ -4847,7 +5680,7 @@ xfce_tasklist_set_nrows (XfceTasklist *tasklist,
   if (tasklist->nrows != nrows)
     {
       tasklist->nrows = nrows;
-      gtk_widget_queue_resize (GTK_WIDGET (tasklist));
+      xfce_tasklist_queue_layout (tasklist);
     }
 }
 
@@ -4872,19 +5705,21 @@ void
 xfce_tasklist_set_size (XfceTasklist *tasklist,
                         gint          size)
 {
-  GList *li;
+  GSequenceIter *iter;
 
   panel_return_if_fail (XFCE_IS_TASKLIST (tasklist));
 
   if (tasklist->size != size)
     {
       tasklist->size = size;
-      gtk_widget_queue_resize (GTK_WIDGET (tasklist));
+      xfce_tasklist_queue_layout (tasklist);
     }
 
-  for (li = tasklist->windows; li != NULL; li = li->next)
+  for (iter = g_sequence_get_begin_iter (tasklist->windows);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
     {
-      XfceTasklistChild *child = li->data;
+      XfceTasklistChild *child = g_sequence_get (iter);
       if (child->type == CHILD_TYPE_GROUP)
         xfce_tasklist_group_button_icon_changed (child->class_group, child);
       else
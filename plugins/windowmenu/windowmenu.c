@@ -28,6 +28,7 @@
 #include <common/panel-utils.h>
 #include <gdk/gdkkeysyms.h>
 #include <common/panel-private.h>
+#include <common/panel-debug.h>
 
 #include "windowmenu.h"
 #include "windowmenu-dialog_ui.h"
@@ -38,6 +39,9 @@
 #define DEFAULT_ELLIPSIZE_MODE  (PANGO_ELLIPSIZE_MIDDLE)
 #define URGENT_FLAGS            (WNCK_WINDOW_STATE_DEMANDS_ATTENTION | \
                                  WNCK_WINDOW_STATE_URGENT)
+#define SECTION_FLAGS           (WNCK_WINDOW_STATE_SKIP_PAGER | \
+                                 WNCK_WINDOW_STATE_SKIP_TASKLIST | \
+                                 WNCK_WINDOW_STATE_STICKY)
 
 struct _WindowMenuPluginClass
 {
@@ -65,10 +69,31 @@ struct _WindowMenuPlugin
   /* urgent window counter */
   gint                urgent_windows;
 
+  /* the window list menu, kept between popups together with
+   * the menu item of each window */
+  GtkWidget          *menu;
+  GHashTable         *menu_items;
+
+  /* window items that changed while the menu was hidden, and whether
+   * the windows, workspaces or settings shown in the menu changed */
+  GSList             *dirty_items;
+  guint               menu_dirty : 1;
+
   /* gtk style properties */
   gint                minimized_icon_lucency;
   PangoEllipsizeMode  ellipsize_mode;
   gint                max_width_chars;
+
+  /* statistics for the debug output, reported once per second */
+  guint               stats_timeout_id;
+  gint64              stats_timestamp;
+  guint               stats_active_changes;
+  guint               stats_icon_updates;
+  guint               stats_item_updates;
+  guint               stats_items_deferred;
+  guint               stats_menu_updates;
+  guint               stats_menu_rebuilds;
+  gint64              stats_max_menu_update;
 };
 
 enum
@@ -128,6 +153,12 @@ static void      window_menu_plugin_windows_connect         (WindowMenuPlugin
                                                              gboolean            traverse_windows);
 static void      window_menu_plugin_menu                    (GtkWidget          *button,
                                                              WindowMenuPlugin   *plugin);
+static void      window_menu_plugin_menu_items_free         (gpointer            data);
+static void      window_menu_plugin_menu_invalidate         (WindowMenuPlugin   *plugin);
+static void      window_menu_plugin_menu_disconnect         (WindowMenuPlugin   *plugin);
+static void      window_menu_plugin_menu_connect            (WindowMenuPlugin   *plugin);
+static void      window_menu_plugin_menu_window_item_dirty  (WnckWindow         *window,
+                                                             WindowMenuPlugin   *plugin);
 
 
 
@@ -137,6 +168,7 @@ XFCE_PANEL_DEFINE_PLUGIN_RESIDENT (WindowMenuPlugin, window_menu_plugin)
 
 
 static GQuark window_quark = 0;
+static GQuark dirty_quark = 0;
 
 
 
@@ -224,6 +256,7 @@ window_menu_plugin_class_init (WindowMenuPluginClass *klass)
                                                              G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
   window_quark = g_quark_from_static_string ("window-list-window-quark");
+  dirty_quark = g_quark_from_static_string ("window-list-dirty-quark");
 }
 
 
@@ -236,6 +269,47 @@ G_GNUC_BEGIN_IGNORE_DEPRECATIONS
   wnck_set_default_icon_size (WNCK_DEFAULT_ICON_SIZE * scale_factor);
   wnck_set_default_mini_icon_size (WNCK_DEFAULT_MINI_ICON_SIZE * scale_factor);
 G_GNUC_END_IGNORE_DEPRECATIONS
+
+  /* the icons of the menu items are scaled for the old factor */
+  if (plugin->menu_items != NULL)
+    g_hash_table_remove_all (plugin->menu_items);
+  window_menu_plugin_menu_invalidate (plugin);
+}
+
+
+
+static gboolean
+window_menu_plugin_report_stats (gpointer data)
+{
+  WindowMenuPlugin *plugin = XFCE_WINDOW_MENU_PLUGIN (data);
+  gint64            timestamp;
+
+  timestamp = g_get_monotonic_time ();
+
+  /* same format as the tasklist statistics, see tasklist-benchmark.py */
+  if (plugin->stats_timestamp > 0)
+    panel_debug_filtered (PANEL_DEBUG_WINDOWMENU,
+                          "%p: stats {\"interval_ms\": %" G_GINT64_FORMAT ", "
+                          "\"menu_items\": %u, \"active_changes\": %u, \"icon_updates\": %u, "
+                          "\"item_updates\": %u, \"items_deferred\": %u, \"menu_updates\": %u, "
+                          "\"menu_rebuilds\": %u, \"max_menu_update_us\": %" G_GINT64_FORMAT "}",
+                          plugin, (timestamp - plugin->stats_timestamp) / 1000,
+                          plugin->menu_items != NULL ? g_hash_table_size (plugin->menu_items) : 0,
+                          plugin->stats_active_changes, plugin->stats_icon_updates,
+                          plugin->stats_item_updates, plugin->stats_items_deferred,
+                          plugin->stats_menu_updates, plugin->stats_menu_rebuilds,
+                          plugin->stats_max_menu_update);
+
+  plugin->stats_timestamp = timestamp;
+  plugin->stats_active_changes = 0;
+  plugin->stats_icon_updates = 0;
+  plugin->stats_item_updates = 0;
+  plugin->stats_items_deferred = 0;
+  plugin->stats_menu_updates = 0;
+  plugin->stats_menu_rebuilds = 0;
+  plugin->stats_max_menu_update = 0;
+
+  return G_SOURCE_CONTINUE;
 }
 
 
@@ -252,6 +326,17 @@ window_menu_plugin_init (WindowMenuPlugin *plugin)
   plugin->minimized_icon_lucency = DEFAULT_ICON_LUCENCY;
   plugin->ellipsize_mode = DEFAULT_ELLIPSIZE_MODE;
   plugin->max_width_chars = DEFAULT_MAX_WIDTH_CHARS;
+  plugin->menu = NULL;
+  plugin->menu_items = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+                                              window_menu_plugin_menu_items_free);
+  plugin->dirty_items = NULL;
+  plugin->menu_dirty = TRUE;
+
+  /* report the statistics once per second while debugging */
+  if (panel_debug_has_domain (PANEL_DEBUG_WINDOWMENU))
+    plugin->stats_timeout_id = g_timeout_add_seconds_full (G_PRIORITY_LOW, 1,
+                                                           window_menu_plugin_report_stats,
+                                                           plugin, NULL);
 
   /* create the widgets */
   plugin->button = xfce_arrow_button_new (GTK_ARROW_NONE);
@@ -350,10 +435,12 @@ window_menu_plugin_set_property (GObject      *object,
 
     case PROP_WORKSPACE_ACTIONS:
       plugin->workspace_actions = g_value_get_boolean (value);
+      window_menu_plugin_menu_invalidate (plugin);
       break;
 
     case PROP_WORKSPACE_NAMES:
       plugin->workspace_names = g_value_get_boolean (value);
+      window_menu_plugin_menu_invalidate (plugin);
       break;
 
     case PROP_URGENTCY_NOTIFICATION:
@@ -370,11 +457,15 @@ window_menu_plugin_set_property (GObject      *object,
               else
                 window_menu_plugin_windows_disconnect (plugin);
             }
+
+          /* the urgent windows section depends on the counter */
+          window_menu_plugin_menu_invalidate (plugin);
         }
       break;
 
     case PROP_ALL_WORKSPACES:
       plugin->all_workspaces = g_value_get_boolean (value);
+      window_menu_plugin_menu_invalidate (plugin);
       break;
 
     default:
@@ -399,6 +490,11 @@ window_menu_plugin_style_updated (GtkWidget *widget)
                         "ellipsize-mode", &plugin->ellipsize_mode,
                         "max-width-chars", &plugin->max_width_chars,
                         NULL);
+
+  /* the menu items are recreated with the new style on the next popup */
+  if (plugin->menu_items != NULL)
+    g_hash_table_remove_all (plugin->menu_items);
+  window_menu_plugin_menu_invalidate (plugin);
 }
 
 
@@ -429,6 +525,10 @@ window_menu_plugin_screen_changed (GtkWidget *widget,
       /* disconnect from the previous screen */
       g_signal_handlers_disconnect_by_func (G_OBJECT (plugin->screen),
           window_menu_plugin_active_window_changed, plugin);
+      window_menu_plugin_menu_disconnect (plugin);
+
+      /* drop the menu items of the old windows */
+      g_hash_table_remove_all (plugin->menu_items);
     }
 
   /* set the new screen */
@@ -437,6 +537,7 @@ window_menu_plugin_screen_changed (GtkWidget *widget,
   /* connect signal to monitor this screen */
   g_signal_connect (G_OBJECT (plugin->screen), "active-window-changed",
       G_CALLBACK (window_menu_plugin_active_window_changed), plugin);
+  window_menu_plugin_menu_connect (plugin);
 
   if (plugin->urgentcy_notification)
     window_menu_plugin_windows_connect (plugin, TRUE);
@@ -497,9 +598,23 @@ window_menu_plugin_free_data (XfcePanelPlugin *panel_plugin)
       /* disconnect from the screen */
       g_signal_handlers_disconnect_by_func (G_OBJECT (plugin->screen),
           window_menu_plugin_active_window_changed, plugin);
+      window_menu_plugin_menu_disconnect (plugin);
 
       plugin->screen = NULL;
     }
+
+  if (plugin->stats_timeout_id != 0)
+    {
+      g_source_remove (plugin->stats_timeout_id);
+      plugin->stats_timeout_id = 0;
+    }
+
+  /* destroy the menu and the window items */
+  g_hash_table_destroy (plugin->menu_items);
+  plugin->menu_items = NULL;
+
+  if (plugin->menu != NULL)
+    gtk_widget_destroy (plugin->menu);
 }
 
 
@@ -656,6 +771,8 @@ window_menu_plugin_set_icon (WindowMenuPlugin *plugin,
   if (! wnck_window_is_active (window))
     return;
 
+  plugin->stats_icon_updates++;
+
   gtk_widget_set_tooltip_text (plugin->icon, wnck_window_get_name (window));
 
   icon_size = xfce_panel_plugin_get_icon_size (XFCE_PANEL_PLUGIN (plugin));
@@ -695,6 +812,15 @@ window_menu_plugin_active_window_changed (WnckScreen       *screen,
   panel_return_if_fail (WNCK_IS_SCREEN (screen));
   panel_return_if_fail (plugin->screen == screen);
 
+  plugin->stats_active_changes++;
+
+  /* the active window is shown in bold in the menu */
+  if (previous_window != NULL)
+    window_menu_plugin_menu_window_item_dirty (previous_window, plugin);
+  window = wnck_screen_get_active_window (screen);
+  if (window != NULL)
+    window_menu_plugin_menu_window_item_dirty (window, plugin);
+
   /* only do this when the icon is visible */
   if (plugin->button_style == BUTTON_STYLE_ICON)
     {
@@ -1019,23 +1145,27 @@ window_menu_plugin_menu_window_item_activate (GtkWidget        *mi,
 
 
 
-static GtkWidget *
-window_menu_plugin_menu_window_item_new (WnckWindow           *window,
-                                         WindowMenuPlugin     *plugin,
-                                         PangoFontDescription *italic,
-                                         PangoFontDescription *bold,
-                                         gint                  icon_w,
-                                         gint                  icon_h)
+static void
+window_menu_plugin_menu_window_item_update (GtkWidget        *mi,
+                                            WindowMenuPlugin *plugin)
 {
+  WnckWindow  *window;
   const gchar *name, *tooltip;
   gchar       *label_text = NULL;
   gchar       *utf8 = NULL;
   gchar       *decorated = NULL;
-  GtkWidget   *mi, *label, *image;
+  GtkWidget   *label, *image = NULL;
   GdkPixbuf   *pixbuf, *lucent = NULL, *scaled = NULL;
   gint         scale_factor;
+  gint         icon_w, icon_h;
 
-  panel_return_val_if_fail (WNCK_IS_WINDOW (window), NULL);
+  panel_return_if_fail (GTK_IS_MENU_ITEM (mi));
+
+  window = g_object_get_qdata (G_OBJECT (mi), window_quark);
+  panel_return_if_fail (WNCK_IS_WINDOW (window));
+
+  g_object_set_qdata (G_OBJECT (mi), dirty_quark, NULL);
+  plugin->stats_item_updates++;
 
   /* try to get an utf-8 valid name */
   name = wnck_window_get_name (window);
@@ -1054,17 +1184,11 @@ window_menu_plugin_menu_window_item_new (WnckWindow           *window,
   else if (wnck_window_is_minimized (window))
     name = decorated = g_strdup_printf ("[%s]", name);
 
-  /* create the menu item */
-  mi = panel_image_menu_item_new_with_label (name);
   gtk_widget_set_tooltip_text (mi, tooltip);
-  g_object_set_qdata (G_OBJECT (mi), window_quark, window);
-  g_signal_connect (G_OBJECT (mi), "button-release-event",
-      G_CALLBACK (window_menu_plugin_menu_window_item_activate), plugin);
-
 
-  /* make the label pretty on long window names */
   label = gtk_bin_get_child (GTK_BIN (mi));
-  panel_return_val_if_fail (GTK_IS_LABEL (label), NULL);
+  panel_return_if_fail (GTK_IS_LABEL (label));
+
   /* modify the label font if needed */
   if (wnck_window_is_active (window))
     label_text = g_strdup_printf ("<b><i>%s</i></b>", name);
@@ -1075,15 +1199,19 @@ window_menu_plugin_menu_window_item_new (WnckWindow           *window,
       gtk_label_set_markup (GTK_LABEL (label), label_text);
       g_free (label_text);
     }
+  else
+    {
+      gtk_label_set_text (GTK_LABEL (label), name);
+    }
 
   g_free (decorated);
   g_free (utf8);
 
-  gtk_label_set_ellipsize (GTK_LABEL (label), plugin->ellipsize_mode);
-  gtk_label_set_max_width_chars (GTK_LABEL (label), plugin->max_width_chars);
-
   if (plugin->minimized_icon_lucency > 0)
     {
+      if (!gtk_icon_size_lookup (GTK_ICON_SIZE_MENU, &icon_w, &icon_h))
+        icon_w = icon_h = 16;
+
       /* get the window icon */
       pixbuf = wnck_window_get_mini_icon (window);
       scale_factor = gtk_widget_get_scale_factor (GTK_WIDGET (plugin));
@@ -1116,11 +1244,10 @@ window_menu_plugin_menu_window_item_new (WnckWindow           *window,
                 pixbuf = lucent;
             }
 
-          /* set the menu item label */
+          /* set the menu item image */
           surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, scale_factor, NULL);
           image = gtk_image_new_from_surface (surface);
           cairo_surface_destroy (surface);
-          panel_image_menu_item_set_image (mi, image);
           gtk_widget_show (image);
 
           if (lucent != NULL)
@@ -1130,11 +1257,292 @@ window_menu_plugin_menu_window_item_new (WnckWindow           *window,
         }
     }
 
+  panel_image_menu_item_set_image (mi, image);
+}
+
+
+
+static void
+window_menu_plugin_menu_window_item_dirty (WnckWindow       *window,
+                                           WindowMenuPlugin *plugin)
+{
+  GtkWidget *mi;
+
+  panel_return_if_fail (WNCK_IS_WINDOW (window));
+  panel_return_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin));
+
+  if (plugin->menu_items == NULL)
+    return;
+
+  mi = g_hash_table_lookup (plugin->menu_items, window);
+  if (mi == NULL)
+    return;
+
+  /* update the item right away if it is shown, else on the next popup */
+  if (gtk_widget_get_mapped (mi))
+    {
+      window_menu_plugin_menu_window_item_update (mi, plugin);
+    }
+  else
+    {
+      if (g_object_get_qdata (G_OBJECT (mi), dirty_quark) == NULL)
+        {
+          g_object_set_qdata (G_OBJECT (mi), dirty_quark, GINT_TO_POINTER (TRUE));
+          plugin->dirty_items = g_slist_prepend (plugin->dirty_items, mi);
+        }
+      plugin->stats_items_deferred++;
+    }
+}
+
+
+
+static void
+window_menu_plugin_menu_window_item_state_changed (WnckWindow       *window,
+                                                   WnckWindowState   changed_mask,
+                                                   WnckWindowState   new_state,
+                                                   WindowMenuPlugin *plugin)
+{
+  window_menu_plugin_menu_window_item_dirty (window, plugin);
+}
+
+
+
+static GtkWidget *
+window_menu_plugin_menu_window_item (WindowMenuPlugin *plugin,
+                                     WnckWindow       *window)
+{
+  GtkWidget *mi, *label;
+
+  panel_return_val_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin), NULL);
+  panel_return_val_if_fail (WNCK_IS_WINDOW (window), NULL);
+
+  mi = g_hash_table_lookup (plugin->menu_items, window);
+  if (mi != NULL)
+    {
+      if (g_object_get_qdata (G_OBJECT (mi), dirty_quark) != NULL)
+        window_menu_plugin_menu_window_item_update (mi, plugin);
+
+      return mi;
+    }
+
+  /* create the menu item, it is owned by the hash table so it
+   * survives being removed from the menu */
+  mi = panel_image_menu_item_new_with_label (NULL);
+  g_object_ref_sink (G_OBJECT (mi));
+  g_object_set_qdata (G_OBJECT (mi), window_quark, window);
+  g_object_set_data (G_OBJECT (mi), "plugin", plugin);
+  g_signal_connect (G_OBJECT (mi), "button-release-event",
+      G_CALLBACK (window_menu_plugin_menu_window_item_activate), plugin);
+  g_hash_table_insert (plugin->menu_items, window, mi);
+
+  /* make the label pretty on long window names */
+  label = gtk_bin_get_child (GTK_BIN (mi));
+  panel_return_val_if_fail (GTK_IS_LABEL (label), NULL);
+  gtk_label_set_ellipsize (GTK_LABEL (label), plugin->ellipsize_mode);
+  gtk_label_set_max_width_chars (GTK_LABEL (label), plugin->max_width_chars);
+
+  /* keep the item in sync with the window */
+  g_signal_connect (G_OBJECT (window), "name-changed",
+      G_CALLBACK (window_menu_plugin_menu_window_item_dirty), plugin);
+  g_signal_connect (G_OBJECT (window), "icon-changed",
+      G_CALLBACK (window_menu_plugin_menu_window_item_dirty), plugin);
+  g_signal_connect (G_OBJECT (window), "state-changed",
+      G_CALLBACK (window_menu_plugin_menu_window_item_state_changed), plugin);
+
+  window_menu_plugin_menu_window_item_update (mi, plugin);
+
   return mi;
 }
 
 
 
+static void
+window_menu_plugin_menu_items_free (gpointer data)
+{
+  GtkWidget        *mi = GTK_WIDGET (data);
+  WnckWindow       *window;
+  WindowMenuPlugin *plugin;
+
+  window = g_object_get_qdata (G_OBJECT (mi), window_quark);
+  plugin = g_object_get_data (G_OBJECT (mi), "plugin");
+  panel_return_if_fail (WNCK_IS_WINDOW (window));
+
+  plugin->dirty_items = g_slist_remove (plugin->dirty_items, mi);
+
+  g_signal_handlers_disconnect_by_func (G_OBJECT (window),
+      window_menu_plugin_menu_window_item_dirty, plugin);
+  g_signal_handlers_disconnect_by_func (G_OBJECT (window),
+      window_menu_plugin_menu_window_item_state_changed, plugin);
+
+  gtk_widget_destroy (mi);
+  g_object_unref (G_OBJECT (mi));
+}
+
+
+
+static void
+window_menu_plugin_menu_window_closed (WnckScreen       *screen,
+                                       WnckWindow       *window,
+                                       WindowMenuPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin));
+  panel_return_if_fail (WNCK_IS_WINDOW (window));
+  panel_return_if_fail (plugin->screen == screen);
+
+  /* drop the menu item before the window is released */
+  g_hash_table_remove (plugin->menu_items, window);
+  window_menu_plugin_menu_invalidate (plugin);
+}
+
+
+
+static void
+window_menu_plugin_menu_invalidate (WindowMenuPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin));
+
+  /* rebuild the menu on the next popup */
+  plugin->menu_dirty = TRUE;
+}
+
+
+
+static void
+window_menu_plugin_menu_window_state_changed (WnckWindow       *window,
+                                              WnckWindowState   changed_mask,
+                                              WnckWindowState   new_state,
+                                              WindowMenuPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin));
+  panel_return_if_fail (WNCK_IS_WINDOW (window));
+
+  /* only changes that move the window to another section of the menu,
+   * the item itself is updated by its own handler */
+  if (PANEL_HAS_FLAG (changed_mask, SECTION_FLAGS)
+      || (!plugin->all_workspaces && PANEL_HAS_FLAG (changed_mask, URGENT_FLAGS)))
+    window_menu_plugin_menu_invalidate (plugin);
+}
+
+
+
+static void
+window_menu_plugin_menu_window_opened (WnckScreen       *screen,
+                                       WnckWindow       *window,
+                                       WindowMenuPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin));
+  panel_return_if_fail (WNCK_IS_WINDOW (window));
+  panel_return_if_fail (plugin->screen == screen);
+
+  /* watch the properties that decide where the window is listed */
+  g_signal_connect_swapped (G_OBJECT (window), "workspace-changed",
+      G_CALLBACK (window_menu_plugin_menu_invalidate), plugin);
+  g_signal_connect (G_OBJECT (window), "state-changed",
+      G_CALLBACK (window_menu_plugin_menu_window_state_changed), plugin);
+
+  window_menu_plugin_menu_invalidate (plugin);
+}
+
+
+
+static void
+window_menu_plugin_menu_workspace_created (WnckScreen       *screen,
+                                          WnckWorkspace    *workspace,
+                                          WindowMenuPlugin *plugin)
+{
+  panel_return_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin));
+  panel_return_if_fail (WNCK_IS_WORKSPACE (workspace));
+  panel_return_if_fail (plugin->screen == screen);
+
+  /* the name is shown in the header and the remove action */
+  g_signal_connect_swapped (G_OBJECT (workspace), "name-changed",
+      G_CALLBACK (window_menu_plugin_menu_invalidate), plugin);
+
+  window_menu_plugin_menu_invalidate (plugin);
+}
+
+
+
+static void
+window_menu_plugin_menu_disconnect (WindowMenuPlugin *plugin)
+{
+  GList *li;
+
+  panel_return_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin));
+  panel_return_if_fail (WNCK_IS_SCREEN (plugin->screen));
+
+  /* disconnect screen signals */
+  g_signal_handlers_disconnect_by_func (G_OBJECT (plugin->screen),
+      window_menu_plugin_menu_window_opened, plugin);
+  g_signal_handlers_disconnect_by_func (G_OBJECT (plugin->screen),
+      window_menu_plugin_menu_window_closed, plugin);
+  g_signal_handlers_disconnect_by_func (G_OBJECT (plugin->screen),
+      window_menu_plugin_menu_workspace_created, plugin);
+  g_signal_handlers_disconnect_by_func (G_OBJECT (plugin->screen),
+      window_menu_plugin_menu_invalidate, plugin);
+
+  /* disconnect from all window and workspace signals */
+  for (li = wnck_screen_get_windows (plugin->screen); li != NULL; li = li->next)
+    {
+      panel_return_if_fail (WNCK_IS_WINDOW (li->data));
+      g_signal_handlers_disconnect_by_func (G_OBJECT (li->data),
+          window_menu_plugin_menu_invalidate, plugin);
+      g_signal_handlers_disconnect_by_func (G_OBJECT (li->data),
+          window_menu_plugin_menu_window_state_changed, plugin);
+    }
+
+  for (li = wnck_screen_get_workspaces (plugin->screen); li != NULL; li = li->next)
+    {
+      panel_return_if_fail (WNCK_IS_WORKSPACE (li->data));
+      g_signal_handlers_disconnect_by_func (G_OBJECT (li->data),
+          window_menu_plugin_menu_invalidate, plugin);
+    }
+}
+
+
+
+static void
+window_menu_plugin_menu_connect (WindowMenuPlugin *plugin)
+{
+  GList *li;
+
+  panel_return_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin));
+  panel_return_if_fail (WNCK_IS_SCREEN (plugin->screen));
+
+  g_signal_connect (G_OBJECT (plugin->screen), "window-opened",
+      G_CALLBACK (window_menu_plugin_menu_window_opened), plugin);
+  g_signal_connect (G_OBJECT (plugin->screen), "window-closed",
+      G_CALLBACK (window_menu_plugin_menu_window_closed), plugin);
+  g_signal_connect_swapped (G_OBJECT (plugin->screen), "window-stacking-changed",
+      G_CALLBACK (window_menu_plugin_menu_invalidate), plugin);
+  g_signal_connect_swapped (G_OBJECT (plugin->screen), "active-workspace-changed",
+      G_CALLBACK (window_menu_plugin_menu_invalidate), plugin);
+  g_signal_connect (G_OBJECT (plugin->screen), "workspace-created",
+      G_CALLBACK (window_menu_plugin_menu_workspace_created), plugin);
+  g_signal_connect_swapped (G_OBJECT (plugin->screen), "workspace-destroyed",
+      G_CALLBACK (window_menu_plugin_menu_invalidate), plugin);
+
+  for (li = wnck_screen_get_windows (plugin->screen); li != NULL; li = li->next)
+    {
+      panel_return_if_fail (WNCK_IS_WINDOW (li->data));
+      window_menu_plugin_menu_window_opened (plugin->screen,
+                                             WNCK_WINDOW (li->data),
+                                             plugin);
+    }
+
+  for (li = wnck_screen_get_workspaces (plugin->screen); li != NULL; li = li->next)
+    {
+      panel_return_if_fail (WNCK_IS_WORKSPACE (li->data));
+      window_menu_plugin_menu_workspace_created (plugin->screen,
+                                                 WNCK_WORKSPACE (li->data),
+                                                 plugin);
+    }
+
+  window_menu_plugin_menu_invalidate (plugin);
+}
+
+
+
 static void
 window_menu_plugin_menu_deactivate (GtkWidget        *menu,
                                     WindowMenuPlugin *plugin)
@@ -1142,11 +1550,9 @@ window_menu_plugin_menu_deactivate (GtkWidget        *menu,
   panel_return_if_fail (plugin->button == NULL || GTK_IS_TOGGLE_BUTTON (plugin->button));
   panel_return_if_fail (GTK_IS_MENU (menu));
 
+  /* the menu is kept for the next popup */
   if (plugin->button != NULL)
     gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (plugin->button), FALSE);
-
-  /* delay destruction so we can handle the activate event first */
-  panel_utils_destroy_later (GTK_WIDGET (menu));
 }
 
 
@@ -1220,34 +1626,61 @@ window_menu_plugin_menu_key_press_event (GtkWidget        *menu,
 
 
 static GtkWidget *
-window_menu_plugin_menu_new (WindowMenuPlugin *plugin)
+window_menu_plugin_menu_update (WindowMenuPlugin *plugin)
 {
   GtkWidget            *menu, *mi = NULL, *image;
   GList                *workspaces, *lp, fake;
-  GList                *windows, *li;
+  GList                *windows, *li, *children;
+  GSList               *lm;
   WnckWorkspace        *workspace = NULL;
   WnckWorkspace        *active_workspace, *window_workspace;
   WnckWindow           *window;
-  PangoFontDescription *italic, *bold;
   gint                  urgent_windows = 0;
   gboolean              is_empty = TRUE;
   guint                 n_workspaces = 0;
   const gchar          *name = NULL;
   gchar                *utf8 = NULL, *label;
-  gint                  w, h;
 
   panel_return_val_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin), NULL);
   panel_return_val_if_fail (WNCK_IS_SCREEN (plugin->screen), NULL);
 
-  italic = pango_font_description_from_string ("italic");
-  bold = pango_font_description_from_string ("bold");
+  if (G_UNLIKELY (plugin->menu == NULL))
+    {
+      plugin->menu = gtk_menu_new ();
+      g_signal_connect (G_OBJECT (plugin->menu), "key-press-event",
+          G_CALLBACK (window_menu_plugin_menu_key_press_event), plugin);
+      g_signal_connect (G_OBJECT (plugin->menu), "deactivate",
+          G_CALLBACK (window_menu_plugin_menu_deactivate), plugin);
+    }
+
+  menu = plugin->menu;
 
-  if (!gtk_icon_size_lookup (GTK_ICON_SIZE_MENU, &w, &h))
-    w = h = 16;
+  /* bring the items that changed while the menu was hidden up to date */
+  for (lm = plugin->dirty_items; lm != NULL; lm = lm->next)
+    if (g_object_get_qdata (G_OBJECT (lm->data), dirty_quark) != NULL)
+      window_menu_plugin_menu_window_item_update (GTK_WIDGET (lm->data), plugin);
+  g_slist_free (plugin->dirty_items);
+  plugin->dirty_items = NULL;
 
-  menu = gtk_menu_new ();
-  g_signal_connect (G_OBJECT (menu), "key-press-event",
-      G_CALLBACK (window_menu_plugin_menu_key_press_event), plugin);
+  /* nothing else changed since the last popup, so the menu is complete */
+  if (!plugin->menu_dirty)
+    return menu;
+
+  plugin->menu_dirty = FALSE;
+  plugin->stats_menu_rebuilds++;
+
+  /* take out the window items, they are kept in the hash table and
+   * only put back in the current stacking order, the workspace items
+   * and separators are cheap to create again */
+  children = gtk_container_get_children (GTK_CONTAINER (menu));
+  for (li = children; li != NULL; li = li->next)
+    {
+      if (g_object_get_qdata (G_OBJECT (li->data), window_quark) != NULL)
+        gtk_container_remove (GTK_CONTAINER (menu), GTK_WIDGET (li->data));
+      else
+        gtk_widget_destroy (GTK_WIDGET (li->data));
+    }
+  g_list_free (children);
 
   /* get all the windows and the active workspace */
   windows = wnck_screen_get_windows_stacked (plugin->screen);
@@ -1301,8 +1734,8 @@ window_menu_plugin_menu_new (WindowMenuPlugin *plugin)
                    && workspace == active_workspace))
             continue;
 
-          /* create the menu item */
-          mi = window_menu_plugin_menu_window_item_new (window, plugin, italic, bold, w, h);
+          /* add the menu item of the window */
+          mi = window_menu_plugin_menu_window_item (plugin, window);
           gtk_menu_shell_append (GTK_MENU_SHELL (menu), mi);
           gtk_widget_show (mi);
 
@@ -1370,8 +1803,8 @@ window_menu_plugin_menu_new (WindowMenuPlugin *plugin)
               || !wnck_window_needs_attention (window))
             continue;
 
-          /* create the menu item */
-          mi = window_menu_plugin_menu_window_item_new (window, plugin, italic, bold, w, h);
+          /* add the menu item of the window */
+          mi = window_menu_plugin_menu_window_item (plugin, window);
           gtk_menu_shell_append (GTK_MENU_SHELL (menu), mi);
           gtk_widget_show (mi);
         }
@@ -1422,9 +1855,6 @@ window_menu_plugin_menu_new (WindowMenuPlugin *plugin)
       gtk_widget_show (mi);
     }
 
-  pango_font_description_free (italic);
-  pango_font_description_free (bold);
-
   return menu;
 }
 
@@ -1436,6 +1866,7 @@ window_menu_plugin_menu (GtkWidget        *button,
 {
   GtkWidget *menu;
   GdkEvent  *event = NULL;
+  gint64     timestamp;
 
   panel_return_if_fail (XFCE_IS_WINDOW_MENU_PLUGIN (plugin));
   panel_return_if_fail (button == NULL || plugin->button == button);
@@ -1456,9 +1887,11 @@ window_menu_plugin_menu (GtkWidget        *button,
     }
 
   /* popup the menu */
-  menu = window_menu_plugin_menu_new (plugin);
-  g_signal_connect (G_OBJECT (menu), "deactivate",
-      G_CALLBACK (window_menu_plugin_menu_deactivate), plugin);
+  timestamp = g_get_monotonic_time ();
+  menu = window_menu_plugin_menu_update (plugin);
+  plugin->stats_menu_updates++;
+  plugin->stats_max_menu_update = MAX (plugin->stats_max_menu_update,
+                                       g_get_monotonic_time () - timestamp);
 
   /* do not block panel autohide if popup-command at pointer */
   if (button == NULL)
@@ -39,6 +39,8 @@
 #include <gtk/gtk.h>
 #include <common/panel-private.h>
 #include <common/panel-dbus.h>
+#include <common/panel-debug.h>
+#include <common/panel-watchdog.h>
 #include <libxfce4util/libxfce4util.h>
 #include <libxfce4panel/libxfce4panel.h>
 #include <libxfce4panel/xfce-panel-plugin-provider.h>
@@ -301,6 +303,33 @@ wrapper_gproxy_provider_signal (XfcePanelPluginProvider       *provider,
 
 
 
+static void
+wrapper_watchdog_stall (const gchar *name,
+                        gint64       duration,
+                        gpointer     user_data)
+{
+  GDBusProxy *proxy = user_data;
+
+  /* runs in the watchdog thread, forward the stall to the panel's
+   * summary without waiting for a reply */
+  g_dbus_proxy_call (proxy, "StallRecord",
+                     g_variant_new ("(sx)", g_utf8_validate (name, -1, NULL) ? name : "unknown",
+                                    duration),
+                     G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, NULL, NULL, NULL);
+}
+
+
+
+static gboolean
+wrapper_watchdog_start (gpointer user_data)
+{
+  panel_watchdog_start ();
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
 gint
 main (gint argc, gchar **argv)
 {
@@ -360,6 +389,9 @@ main (gint argc, gchar **argv)
       goto leave;
     }
 
+  /* blame stalls of the main loop in this library on the plugin */
+  panel_watchdog_add_module (filename, name);
+
   /* check for a plugin preinit function */
   if (g_module_symbol (library, "xfce_panel_module_preinit", (gpointer) &preinit_func)
       && preinit_func != NULL
@@ -371,6 +403,9 @@ main (gint argc, gchar **argv)
 
   gtk_init (&argc, &argv);
 
+  /* dump the debug flight recorder on SIGUSR2 */
+  panel_debug_recorder_watch_signal ();
+
   /* connect the dbus proxy */
   dbus_gconnection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
   if (G_UNLIKELY (dbus_gconnection == NULL))
@@ -393,6 +428,10 @@ main (gint argc, gchar **argv)
   g_signal_connect (G_OBJECT (dbus_gproxy), "notify::g-name-owner",
       G_CALLBACK (wrapper_gproxy_name_owner_changed), NULL);
 
+  /* report stalls to the panel, the watchdog is stopped before the
+   * proxy is released */
+  panel_watchdog_set_stall_func (wrapper_watchdog_stall, dbus_gproxy);
+
   /* create the type module */
   module = wrapper_module_new (library);
 
@@ -427,6 +466,10 @@ main (gint argc, gchar **argv)
       /* show the plugin */
       gtk_widget_show (GTK_WIDGET (provider));
 
+      /* detect and attribute stalls of the main loop once it runs, the
+       * plugin construction above is not a stall */
+      g_idle_add (wrapper_watchdog_start, NULL);
+
       gtk_main ();
 
       /* destroy the plug and provider */
@@ -442,6 +485,8 @@ main (gint argc, gchar **argv)
     }
 
 leave:
+  panel_watchdog_stop ();
+
   if (G_LIKELY (dbus_gproxy != NULL))
     g_object_unref (G_OBJECT (dbus_gproxy));
 